@@ -8,14 +8,20 @@
 #include "ISensor.h"
 
 #define MAX_DC_SPEED 1000
-class BoatMixer : public IMixer
+
+// TMotor = IActuator gives the dynamic mixer, a concrete final actuator
+// type (e.g. DCMotor) lets the compiler call and inline it directly
+template <typename TMotor = IActuator>
+class BoatMixer final : public IMixer
 {
 private:
-    IActuator *_motorLeft;
-    IActuator *_motorRight;
+    TMotor *_motorLeft;
+    TMotor *_motorRight;
+    int16_t _leftSpeed{0};
+    int16_t _rightSpeed{0};
 
 public:
-    BoatMixer(IActuator* left, IActuator* right) 
+    BoatMixer(TMotor* left, TMotor* right)
         : _motorLeft(left), _motorRight(right) {}
 
     void Init() override
@@ -26,12 +32,15 @@ public:
 
     void Update(DroneControlData *input, SensorsData *sensors) override
     {
+        TRACE_SCOPE("BoatMixer::Update");
         //"Differential Drive"
         int16_t throttle = input->throttle;
         int16_t yaw = input->yaw;
 
         int16_t leftSpeed = constrain(throttle + yaw, 0, MAX_DC_SPEED);
         int16_t rightSpeed = constrain(throttle - yaw, 0, MAX_DC_SPEED);
+        _leftSpeed = leftSpeed;
+        _rightSpeed = rightSpeed;
 
         if(_motorRight)
         {
@@ -46,6 +55,12 @@ public:
         }
     }
 
+    void FillBlackbox(BlackboxRecord &record) const override
+    {
+        record.motorLeft = _leftSpeed;
+        record.motorRight = _rightSpeed;
+    }
+
     void StopAll() override
     {
         _motorLeft->Set(0);
@@ -53,4 +68,4 @@ public:
     }
 };
 
-#endif
\ No newline at end of file
+#endif
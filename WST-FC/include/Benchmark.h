@@ -0,0 +1,42 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+#include "Configuration.h"
+
+#if USE_BENCHMARK
+
+// Average CPU cycles of one call to fn over iterations runs
+template <typename TFunction>
+uint32_t BenchmarkCycles(uint32_t iterations, TFunction fn)
+{
+    // Warm up caches and flash mapping
+    fn();
+    uint32_t start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        fn();
+    }
+    return (ESP.getCycleCount() - start) / iterations;
+}
+
+inline void PrintBenchmark(Print &out, const char *name, uint32_t cycles)
+{
+    out.printf("[bench] %-32s %8lu cycles %8.2f us\n", name, (unsigned long)cycles, (float)cycles / ESP.getCpuFreqMHz());
+}
+
+inline void PrintBenchmarkSaving(Print &out, const char *name, uint32_t baselineCycles, uint32_t cycles)
+{
+    int32_t saved = (int32_t)baselineCycles - (int32_t)cycles;
+    out.printf("[bench] %-32s %8ld cycles saved per iteration (%.1f%%)\n", name, (long)saved,
+        baselineCycles > 0 ? 100.0f * saved / baselineCycles : 0.0f);
+}
+
+// FastMath.h kernels against libm (float and the double calls they replaced)
+void RunMathBenchmarks(Print &out);
+// MatrixMixer against the hand-written BoatMixer/BicopterMixer it can replace
+void RunMixerBenchmarks(Print &out);
+
+#endif
+
+#endif
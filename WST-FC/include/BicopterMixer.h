@@ -4,63 +4,72 @@
 #include "IMixer.h"
 #include "IActuator.h"
 #include <Arduino.h>
-#include <PID_v1.h>
+#include "PidController.h"
 #include "DCMotor.h"
 #include "ISensor.h"
 #include "ESCActuator.h"
 #include "ServoMotor.h"
 
-class BicopterMixer : public IMixer
+// Highest rate the angle loops command, degrees/s
+#define BICOPTER_MAX_RATE 200.0f
+#define BICOPTER_DTERM_CUTOFF_HZ 40.0f
+// Longest tick integrated as one step
+#define BICOPTER_MAX_DT 0.02f
+
+// TMotor/TServo = IActuator gives the dynamic mixer, concrete final
+// actuator types (ESCActuator, ServoMotor) let the compiler inline them
+template <typename TMotor = IActuator, typename TServo = IActuator>
+class BicopterMixer final : public IMixer
 {
 private:
-    IActuator *_motorLeft;
-    IActuator *_motorRight;
-    IActuator *_servoLeft;
-    IActuator *_servoRight;
-
-    // PITCH
-    double _pitchSetpoint;
-    double _pitchInput;
-    double _pitchOutput;
-    double _kpPitch = 1.5;
-    double _kiPitch = 0.0;
-    double _kdPitch = 0.0;
-
-    // ROLL
-    double _rollSetpoint;
-    double _rollInput;
-    double _rollOutput;
-    double _kpRoll = 1.5; 
-    double _kiRoll = 0.0;
-    double _kdRoll = 0.1;
-    
-    double _pitchFilterState = 0.0;
-    const double _pitchFilterAlpha = 0.7;
-
-    PID *_pitchPID;
-    PID *_rollPID;
+    TMotor *_motorLeft;
+    TMotor *_motorRight;
+    TServo *_servoLeft;
+    TServo *_servoRight;
+
+    // Pitch - servos (us around 1500), roll - differential motor speed.
+    // Angles in degrees, rates in degrees/s
+    CascadedPid<float> _pitchController;
+    CascadedPid<float> _rollController;
+    unsigned long _lastUpdateUs{0};
+    // Last commands: motor left/right, servo left/right
+    int16_t _commands[4]{0, 0, 1500, 1500};
+
+    static void FillPid(const CascadedPid<float> &controller, BlackboxPid &pid)
+    {
+        const PidTerms<float> &terms = controller.GetRateTerms();
+        pid.rateSetpoint = (int16_t)(controller.GetRateSetpoint() * 10.0f);
+        pid.p = (int16_t)(terms.p * 10.0f);
+        pid.i = (int16_t)(terms.i * 10.0f);
+        pid.d = (int16_t)(terms.d * 10.0f);
+        pid.output = (int16_t)(terms.output * 10.0f);
+    }
 
 public:
-    BicopterMixer()
+    BicopterMixer(TMotor *motorLeft, TMotor *motorRight, TServo *servoLeft, TServo *servoRight)
+        : _motorLeft(motorLeft), _motorRight(motorRight), _servoLeft(servoLeft), _servoRight(servoRight)
     {
-        //pin, center angle
-        _servoLeft = new ServoMotor(32,90); 
-        _servoRight = new ServoMotor(33,90);
-
-        //pin, minPulse, maxPulse
-        _motorLeft = new ESCActuator(25,700,1500);
-        _motorRight = new ESCActuator(26,700,1500); 
-
-        _pitchSetpoint = 0;
-        _pitchInput = 0;
-        _pitchOutput = 0;
-
-        _rollSetpoint = 0;
-        _rollInput = 0;
-        _rollOutput = 0;
-
-        _pitchPID = new PID(&_pitchInput, &_pitchOutput, &_pitchSetpoint, _kpPitch, _kiPitch, _kdPitch, DIRECT);
-        _rollPID = new PID(&_rollInput, &_rollOutput, &_rollSetpoint, _kpRoll, _kiRoll, _kdRoll, DIRECT);
+        PidGains<float> angle;
+        angle.kp = 4.0f;
+        angle.outputLimit = BICOPTER_MAX_RATE;
+
+        PidGains<float> pitchRate;
+        pitchRate.kp = 1.5f;
+        pitchRate.ki = 1.0f;
+        pitchRate.kd = 0.02f;
+        pitchRate.outputLimit = 500.0f;
+        pitchRate.integratorLimit = 200.0f;
+        pitchRate.dTermCutoffHz = BICOPTER_DTERM_CUTOFF_HZ;
+        _pitchController = CascadedPid<float>(angle, pitchRate);
+
+        PidGains<float> rollRate;
+        rollRate.kp = 1.0f;
+        rollRate.ki = 0.5f;
+        rollRate.kd = 0.03f;
+        rollRate.outputLimit = 300.0f;
+        rollRate.integratorLimit = 150.0f;
+        rollRate.dTermCutoffHz = BICOPTER_DTERM_CUTOFF_HZ;
+        _rollController = CascadedPid<float>(angle, rollRate);
     }
 
     void Init() override
@@ -73,59 +82,71 @@ public:
         if(_motorLeft) _motorLeft->Set(0);
         if(_motorRight) _motorRight->Set(0);
 
-        if(_pitchPID)
-        {
-            _pitchPID->SetMode(AUTOMATIC);
-            _pitchPID->SetSampleTime(20); 
-            _pitchPID->SetOutputLimits(-500, 500);
-        }
-
-        if(_rollPID)
-        {
-            _rollPID->SetMode(AUTOMATIC);
-            _rollPID->SetSampleTime(20); 
-            _rollPID->SetOutputLimits(-300, 300); 
-        }
+        _pitchController.Reset();
+        _rollController.Reset();
+        _lastUpdateUs = micros();
     }
 
     void Update(DroneControlData *input, SensorsData *sensors) override 
     {
+        TRACE_SCOPE("BicopterMixer::Update");
         if(sensors == nullptr || input == nullptr) return;
-        
-        // PITCH - Serwa
-        _pitchFilterState = (_pitchFilterState * (1.0 - _pitchFilterAlpha)) + ((double)(sensors->pitch) * _pitchFilterAlpha);
-        _pitchInput = _pitchFilterState;
-        _pitchSetpoint = input->pitch;
 
-        if (_pitchPID->Compute()) 
+        // Measured tick length, clamped so a stall does not dump into the integrators
+        unsigned long now = micros();
+        float dt = (now - _lastUpdateUs) * 1e-6f;
+        _lastUpdateUs = now;
+        if (dt > BICOPTER_MAX_DT) dt = BICOPTER_MAX_DT;
+
+        // PITCH - Serwa. Setpoints and angles are centidegrees, gyro decidegrees/s
+        float pitchOutput;
         {
-            int16_t controlSignal = _pitchOutput;
-            
-            // Przywracamy środek wychylenia (1500 us)
-            int16_t servoLeftVal = 1500 + controlSignal;
-            int16_t servoRightVal = 1500 - controlSignal;
-
-            if(_servoLeft) _servoLeft->Set(servoLeftVal);
-            if(_servoRight) _servoRight->Set(servoRightVal); 
+            TRACE_SCOPE("BicopterMixer::PitchPID");
+            pitchOutput = _pitchController.Update(input->pitch * 0.01f, sensors->pitch * 0.01f, sensors->gyroX * 0.1f, dt);
         }
+        int16_t controlSignal = (int16_t)pitchOutput;
+
+        // Przywracamy środek wychylenia (1500 us)
+        int16_t servoLeftVal = 1500 + controlSignal;
+        int16_t servoRightVal = 1500 - controlSignal;
+
+        if(_servoLeft) _servoLeft->Set(servoLeftVal);
+        if(_servoRight) _servoRight->Set(servoRightVal); 
 
         // ROLL - Silniki
-        _rollInput = (double)(sensors->roll);
-        _rollSetpoint = (double)input->roll; 
-        
-        if(_rollPID->Compute())
+        float rollOutput;
         {
-            int16_t mappedThrottle = map(input->throttle, -1000, 1000, 0, 1000);
-
-            int16_t correction = _rollOutput;
-            int16_t motorLeftSpeed = mappedThrottle + correction;
-            int16_t motorRightSpeed = mappedThrottle - correction;
-            
-            if(_motorLeft) _motorLeft->Set(motorLeftSpeed);
-            if(_motorRight) _motorRight->Set(motorRightSpeed);
+            TRACE_SCOPE("BicopterMixer::RollPID");
+            rollOutput = _rollController.Update(input->roll * 0.01f, sensors->roll * 0.01f, sensors->gyroY * 0.1f, dt);
         }
+        int16_t mappedThrottle = map(input->throttle, -1000, 1000, 0, 1000);
+
+        int16_t correction = (int16_t)rollOutput;
+        int16_t motorLeftSpeed = mappedThrottle + correction;
+        int16_t motorRightSpeed = mappedThrottle - correction;
+        
+        if(_motorLeft) _motorLeft->Set(motorLeftSpeed);
+        if(_motorRight) _motorRight->Set(motorRightSpeed);
+
+        _commands[0] = motorLeftSpeed;
+        _commands[1] = motorRightSpeed;
+        _commands[2] = servoLeftVal;
+        _commands[3] = servoRightVal;
+    }
+
+    void FillBlackbox(BlackboxRecord &record) const override
+    {
+        FillPid(_pitchController, record.pitchPid);
+        FillPid(_rollController, record.rollPid);
+        record.motorLeft = _commands[0];
+        record.motorRight = _commands[1];
+        record.servoLeft = _commands[2];
+        record.servoRight = _commands[3];
     }
 
+    CascadedPid<float> &GetPitchController() { return _pitchController; }
+    CascadedPid<float> &GetRollController() { return _rollController; }
+
     void StopAll(){};
 };
 
@@ -0,0 +1,114 @@
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "Configuration.h"
+#include "DroneData.h"
+#include "SensorsData.h"
+#include "BlackboxFormat.h"
+#include "BlackboxStorage.h"
+#include "Trace.h"
+
+#define BLACKBOX_TASK_STACK 4096
+
+struct BlackboxStats
+{
+    uint32_t records{0};
+    // Both buffers waiting for the writer, or the storage is full
+    uint32_t dropped{0};
+    uint32_t blocks{0};
+    uint32_t writeErrors{0};
+    // Sectors erased while running to make room for new blocks
+    uint32_t recycled{0};
+};
+
+// Flight recorder. The control task encodes a record per tick into one of
+// two block buffers; a full buffer goes to the writer task, which stores it
+// (BlackboxStorage.h) while the control task fills the other one. Log()
+// never waits: if the writer still holds both buffers the record is
+// dropped and counted in the next block header. The block being filled is
+// lost on power-off, about 200 ms at 500 Hz. Inputs neutral for
+// BLACKBOX_QUIET_MS let the writer erase room for the next run. Format:
+// BlackboxFormat.h, decoder: tools/blackbox_decode.cpp.
+class Blackbox
+{
+private:
+    BlackboxStorage _storage;
+    uint8_t _buffers[2][BLACKBOX_BLOCK_SIZE];
+    // Set by the control task when a buffer is sealed, cleared by the writer
+    std::atomic<bool> _full[2];
+    // Inputs neutral for BLACKBOX_QUIET_MS, the writer may erase
+    std::atomic<bool> _quiet{true};
+    BlackboxBlockWriter _writer;
+    TaskHandle_t _task{nullptr};
+    bool _initiated{false};
+
+    // Owned by the control task
+    uint8_t _active{0};
+    bool _open{false};
+    bool _recording{!BLACKBOX_START_ON_INPUT};
+    uint32_t _session{0};
+    uint32_t _sequence{0};
+    uint16_t _droppedSinceBlock{0};
+    uint8_t _tick{0};
+    uint32_t _activeUs{0};
+
+    // Owned by the writer task
+    uint8_t _nextWrite{0};
+
+    BlackboxStats _stats;
+
+    static void TaskBody(void *arg);
+    void Append(const BlackboxRecord &record, uint32_t timeUs);
+    void Seal();
+
+public:
+    Blackbox();
+
+    // Before the scheduler starts, the flash storage erases its space here
+    bool Init();
+
+    // Control task, after the mixer ran. TMixer is the concrete mixer of
+    // the static Vehicle or IMixer.
+    template <typename TMixer>
+    void Log(const DroneControlData &control, const SensorsData &sensors, const TMixer &mixer, uint32_t timeUs)
+    {
+        TRACE_SCOPE("Blackbox::Log");
+        if (!_initiated) return;
+        bool neutral = control.throttle == 0 && control.yaw == 0 && control.pitch == 0 && control.roll == 0;
+        if (!neutral) _activeUs = timeUs;
+        bool quiet = neutral && timeUs - _activeUs >= BLACKBOX_QUIET_MS * 1000UL;
+        if (quiet != _quiet.load(std::memory_order_relaxed)) _quiet.store(quiet, std::memory_order_relaxed);
+
+        if (_storage.IsFull()) return;
+        if (!_recording)
+        {
+            if (neutral) return;
+            _recording = true;
+        }
+        if (++_tick < BLACKBOX_RATE_DIVIDER) return;
+        _tick = 0;
+
+        BlackboxRecord record = {};
+        record.throttle = control.throttle;
+        record.yaw = control.yaw;
+        record.pitchSetpoint = control.pitch;
+        record.rollSetpoint = control.roll;
+        record.pitch = sensors.pitch;
+        record.roll = sensors.roll;
+        record.gyroX = sensors.gyroX;
+        record.gyroY = sensors.gyroY;
+        record.gyroZ = sensors.gyroZ;
+        record.linearAccelX = sensors.linearAccelX;
+        record.linearAccelY = sensors.linearAccelY;
+        record.linearAccelZ = sensors.linearAccelZ;
+        mixer.FillBlackbox(record);
+        Append(record, timeUs);
+    }
+
+    const BlackboxStats &GetStats() const { return _stats; }
+    void PrintStats(Print &out) const;
+};
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef BLACKBOXFORMAT_H
+#define BLACKBOXFORMAT_H
+
+// Flight recorder storage format, shared by the vehicle (Blackbox.h) and
+// tools/blackbox_decode.cpp. Plain C++, builds on the host as well.
+//
+// Storage is a sequence of BLACKBOX_BLOCK_SIZE blocks (one flash sector):
+//   | BlackboxBlockHeader | record | record | ... | unused |
+// and a record is
+//   | payload length u8 | us since the previous record, varint | TelemetryCodec payload |
+//
+// Records are BlackboxRecord rows through the TelemetryEncoder, every block
+// starts with a keyframe, so each block decodes on its own and a torn or
+// overwritten block costs only itself. The CRC covers header and records.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "LinkProtocol.h"
+#include "TelemetryCodec.h"
+
+#define BLACKBOX_MAGIC 0x42425357 // "WSBB"
+#define BLACKBOX_VERSION 1
+#define BLACKBOX_BLOCK_SIZE 4096
+// Frames between keyframes inside a block
+#define BLACKBOX_KEYFRAME_INTERVAL 64
+
+#pragma pack(push, 1)
+// Rate loop of one CascadedPid, tenths of the mixer output units
+struct BlackboxPid
+{
+    // Output of the angle loop, deci-degrees/s
+    int16_t rateSetpoint;
+    int16_t p;
+    int16_t i;
+    int16_t d;
+    int16_t output;
+};
+
+// One control tick
+struct BlackboxRecord
+{
+    // DroneControlData, setpoints in centidegrees
+    int16_t throttle;
+    int16_t yaw;
+    int16_t pitchSetpoint;
+    int16_t rollSetpoint;
+
+    // Estimator output as in SensorsData: centidegrees, decidegrees/s, cm/s^2
+    int16_t pitch;
+    int16_t roll;
+    int16_t gyroX;
+    int16_t gyroY;
+    int16_t gyroZ;
+    int16_t linearAccelX;
+    int16_t linearAccelY;
+    int16_t linearAccelZ;
+
+    // BicopterMixer, zero for mixers without PIDs
+    BlackboxPid pitchPid;
+    BlackboxPid rollPid;
+
+    // Commands as passed to the actuators' Set()
+    int16_t motorLeft;
+    int16_t motorRight;
+    int16_t servoLeft;
+    int16_t servoRight;
+};
+
+struct BlackboxBlockHeader
+{
+    uint32_t magic;
+    uint8_t version;
+    // Fields per record, sizeof(BlackboxRecord) / 2 when it was written
+    uint8_t fields;
+    // Record bytes after the header
+    uint16_t used;
+    // Counts boots (flash) or log files (SD)
+    uint32_t session;
+    // Block number inside the session
+    uint32_t sequence;
+    // micros() of the first record
+    uint32_t firstUs;
+    // Records the writer had to drop since the previous block
+    uint16_t dropped;
+    // CRC-16/CCITT-FALSE over header (with crc = 0) and records
+    uint16_t crc;
+};
+#pragma pack(pop)
+
+#define BLACKBOX_FIELDS (sizeof(BlackboxRecord) / sizeof(int16_t))
+// Largest record: length byte, 5 byte varint, worst case payload
+#define BLACKBOX_MAX_RECORD_SIZE (1 + 5 + TELEMETRY_PAYLOAD_SIZE(BLACKBOX_FIELDS))
+
+// Column names and the factor to engineering units, in BlackboxRecord order
+static const char *const BLACKBOX_FIELD_NAMES[] = {
+    "throttle", "yaw", "pitchSetpoint", "rollSetpoint",
+    "pitch", "roll", "gyroX", "gyroY", "gyroZ", "linearAccelX", "linearAccelY", "linearAccelZ",
+    "pitchRateSetpoint", "pitchP", "pitchI", "pitchD", "pitchOutput",
+    "rollRateSetpoint", "rollP", "rollI", "rollD", "rollOutput",
+    "motorLeft", "motorRight", "servoLeft", "servoRight"};
+static const float BLACKBOX_FIELD_SCALES[] = {
+    1.0f, 1.0f, 0.01f, 0.01f,
+    0.01f, 0.01f, 0.1f, 0.1f, 0.1f, 0.01f, 0.01f, 0.01f,
+    0.1f, 0.1f, 0.1f, 0.1f, 0.1f,
+    0.1f, 0.1f, 0.1f, 0.1f, 0.1f,
+    1.0f, 1.0f, 1.0f, 1.0f};
+static_assert(sizeof(BLACKBOX_FIELD_NAMES) / sizeof(BLACKBOX_FIELD_NAMES[0]) == BLACKBOX_FIELDS, "BLACKBOX_FIELD_NAMES must list every BlackboxRecord field");
+static_assert(sizeof(BLACKBOX_FIELD_SCALES) / sizeof(BLACKBOX_FIELD_SCALES[0]) == BLACKBOX_FIELDS, "BLACKBOX_FIELD_SCALES must list every BlackboxRecord field");
+
+inline uint16_t BlackboxBlockCrc(const uint8_t *block)
+{
+    BlackboxBlockHeader header;
+    memcpy(&header, block, sizeof(header));
+    header.crc = 0;
+    uint16_t crc = LinkCrc16((const uint8_t *)&header, sizeof(header));
+    return LinkCrc16(block + sizeof(header), header.used, crc);
+}
+
+// Fills one block. Every field is looked at on every record.
+class BlackboxBlockWriter
+{
+private:
+    uint8_t _dividers[BLACKBOX_FIELDS] = {};
+    TelemetryEncoder _encoder;
+    uint8_t *_block{nullptr};
+    size_t _used{0};
+    uint32_t _lastUs{0};
+    bool _empty{true};
+
+public:
+    BlackboxBlockWriter() : _encoder(_dividers, BLACKBOX_FIELDS, BLACKBOX_KEYFRAME_INTERVAL) {}
+
+    void Begin(uint8_t *block, uint32_t session, uint32_t sequence, uint16_t dropped)
+    {
+        BlackboxBlockHeader header = {};
+        header.magic = BLACKBOX_MAGIC;
+        header.version = BLACKBOX_VERSION;
+        header.fields = BLACKBOX_FIELDS;
+        header.session = session;
+        header.sequence = sequence;
+        header.dropped = dropped;
+        memcpy(block, &header, sizeof(header));
+        _block = block;
+        _used = sizeof(header);
+        _empty = true;
+        _encoder.ForceKeyframe();
+    }
+
+    // False when the block has no room left, the record is not written then
+    bool Append(const BlackboxRecord &record, uint32_t timeUs)
+    {
+        if (BLACKBOX_BLOCK_SIZE - _used < BLACKBOX_MAX_RECORD_SIZE) return false;
+        if (_empty)
+        {
+            memcpy(_block + offsetof(BlackboxBlockHeader, firstUs), &timeUs, sizeof(timeUs));
+            _lastUs = timeUs;
+            _empty = false;
+        }
+        size_t offset = _used + 1;
+        offset += VarintWrite(_block + offset, timeUs - _lastUs);
+        uint16_t values[BLACKBOX_FIELDS];
+        memcpy(values, &record, sizeof(record));
+        size_t length = _encoder.Encode(values, _block + offset, BLACKBOX_BLOCK_SIZE - offset);
+        _block[_used] = length;
+        _used = offset + length;
+        _lastUs = timeUs;
+        return true;
+    }
+
+    // Seals the block, the rest of it stays as it was
+    void Finish()
+    {
+        uint16_t used = _used - sizeof(BlackboxBlockHeader);
+        memcpy(_block + offsetof(BlackboxBlockHeader, used), &used, sizeof(used));
+        uint16_t crc = BlackboxBlockCrc(_block);
+        memcpy(_block + offsetof(BlackboxBlockHeader, crc), &crc, sizeof(crc));
+    }
+
+    bool IsEmpty() const { return _empty; }
+};
+
+// Walks the records of one block
+class BlackboxBlockReader
+{
+private:
+    const uint8_t *_block;
+    BlackboxBlockHeader _header;
+    TelemetryDecoder _decoder;
+    size_t _offset{sizeof(BlackboxBlockHeader)};
+    uint32_t _timeUs{0};
+
+public:
+    explicit BlackboxBlockReader(const uint8_t *block) : _block(block)
+    {
+        memcpy(&_header, block, sizeof(_header));
+        _timeUs = _header.firstUs;
+    }
+
+    // Magic, version, layout and CRC. Erased flash fails on the magic.
+    bool IsValid() const
+    {
+        return _header.magic == BLACKBOX_MAGIC && _header.version == BLACKBOX_VERSION &&
+               _header.fields == BLACKBOX_FIELDS &&
+               _header.used <= BLACKBOX_BLOCK_SIZE - sizeof(BlackboxBlockHeader) &&
+               BlackboxBlockCrc(_block) == _header.crc;
+    }
+
+    const BlackboxBlockHeader &GetHeader() const { return _header; }
+
+    // False at the end of the block or on a broken record
+    bool Next(BlackboxRecord &record, uint32_t &timeUs)
+    {
+        size_t end = sizeof(BlackboxBlockHeader) + _header.used;
+        if (_offset >= end) return false;
+        size_t length = _block[_offset];
+        uint32_t delta;
+        size_t read = VarintRead(_block + _offset + 1, end - _offset - 1, delta);
+        size_t payload = _offset + 1 + read;
+        if (read == 0 || payload + length > end) return false;
+        if (!_decoder.Decode(_block + payload, length) || !_decoder.Get(record)) return false;
+        _offset = payload + length;
+        _timeUs += delta;
+        timeUs = _timeUs;
+        return true;
+    }
+
+    // Every record was read, false if Next() stopped at a broken one
+    bool AtEnd() const { return _offset == sizeof(BlackboxBlockHeader) + _header.used; }
+};
+
+#endif
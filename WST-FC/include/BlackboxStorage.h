@@ -0,0 +1,93 @@
+#ifndef BLACKBOXSTORAGE_H
+#define BLACKBOXSTORAGE_H
+
+#include <Arduino.h>
+#include "Configuration.h"
+#include "BlackboxFormat.h"
+
+// Begin() runs from setup() and picks the session number, WriteBlock()
+// stores one sealed BLACKBOX_BLOCK_SIZE block from the writer task and
+// Recycle() makes room for more from there.
+
+// Average record size, measured by tools/blackbox_decode --selftest
+#define BLACKBOX_RECORD_BYTES 39
+#define BLACKBOX_BYTES_PER_SECOND (CONTROL_LOOP_HZ / BLACKBOX_RATE_DIVIDER * BLACKBOX_RECORD_BYTES)
+
+#if BLACKBOX_STORAGE == 1
+
+#include <FS.h>
+#include <SD_MMC.h>
+
+#define BLACKBOX_SD_MOUNT "/sdcard"
+// One file per session, /blackbox_<session>.bbx
+#define BLACKBOX_SD_MAX_FILES 999
+// Blocks between flushes, a crash loses at most this much
+#define BLACKBOX_SD_FLUSH_BLOCKS 8
+
+// Appends to a new file on the SD card (SD_MMC, 1-bit mode keeps GPIO4,
+// the flash LED, out of it). SDMMC transfers run on DMA, the flash cache
+// and the control task are never held up.
+class BlackboxSdStorage
+{
+private:
+    File _file;
+    uint32_t _written{0};
+
+public:
+    bool Begin(uint32_t &session);
+    bool WriteBlock(const uint8_t *block);
+    bool Recycle(bool /*quiet*/) { return false; }
+    bool IsFull() const { return false; }
+};
+
+typedef BlackboxSdStorage BlackboxStorage;
+
+#else
+
+#include <esp_partition.h>
+
+#define BLACKBOX_PARTITION_LABEL "blackbox"
+#define BLACKBOX_PARTITION_SUBTYPE 0x40
+// Flash program page, written one at a time
+#define BLACKBOX_FLASH_PAGE 256
+// Blocks kept erased ahead of the writer in motion, BLACKBOX_RECYCLE_IN_MOTION
+#define BLACKBOX_FLASH_MIN_FREE 2
+
+// Ring of blocks in a data partition, the newest data is kept. Erasing a
+// sector holds the flash cache of both cores for tens of ms, which stalls
+// the control task, so Begin() erases before the scheduler starts: the
+// whole partition but the newest blocks of the previous session, at most
+// half of it. A vehicle that rebooted in the field keeps its last flight
+// until the new session records over it. Later the writer task recycles
+// the oldest blocks, one sector per Recycle(), back to half of the
+// partition erased ahead, but only while the inputs are neutral. In
+// motion it only erases with BLACKBOX_RECYCLE_IN_MOTION, otherwise the
+// session stops when the erased space runs out. Page programs hold the
+// cache for well under a millisecond each, the writer sleeps a tick
+// between pages.
+class BlackboxFlashStorage
+{
+private:
+    const esp_partition_t *_partition{nullptr};
+    uint32_t _blocks{0};
+    uint32_t _next{0};
+    // Erased blocks left for this session
+    uint32_t _free{0};
+
+    bool ReadHeader(uint32_t block, BlackboxBlockHeader &header) const;
+    bool IsBlank(uint32_t block) const;
+    bool Erase(uint32_t first, uint32_t count);
+
+public:
+    bool Begin(uint32_t &session);
+    bool WriteBlock(const uint8_t *block);
+    // Erases the oldest block if more should be free, true if it did
+    bool Recycle(bool quiet);
+    bool IsFull() const { return _free == 0; }
+};
+
+typedef BlackboxFlashStorage BlackboxStorage;
+
+#endif
+
+#endif
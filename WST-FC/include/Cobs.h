@@ -0,0 +1,112 @@
+#ifndef COBS_H
+#define COBS_H
+
+// Consistent Overhead Byte Stuffing for byte streams (serial links). The
+// encoded frame has no zero bytes, so 0x00 marks frame boundaries and a
+// receiver resyncs at the next zero after any error. Overhead is one byte
+// per 254 plus the delimiter. Plain C++, builds on the host as well.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Worst case size of an encoded frame, delimiter included
+#define COBS_ENCODED_SIZE(length) ((length) + (length) / 254 + 2)
+
+// Encodes length bytes and appends the 0x00 delimiter. out must hold
+// COBS_ENCODED_SIZE(length) bytes. Returns the bytes written.
+inline size_t CobsEncode(const uint8_t *data, size_t length, uint8_t *out)
+{
+    size_t codeIndex = 0;
+    size_t written = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (data[i] != 0)
+        {
+            out[written++] = data[i];
+            code++;
+        }
+        if (data[i] == 0 || code == 0xFF)
+        {
+            out[codeIndex] = code;
+            codeIndex = written++;
+            code = 1;
+        }
+    }
+    out[codeIndex] = code;
+    out[written++] = 0;
+    return written;
+}
+
+// Decodes a stream byte by byte into a fixed buffer, nothing is allocated.
+// Push() returns the decoded length when a delimiter closes a valid frame,
+// 0 otherwise. Frames that overflow the buffer or break the encoding are
+// counted and skipped up to the next delimiter.
+template <size_t Capacity>
+class CobsDecoder
+{
+private:
+    uint8_t _buffer[Capacity];
+    size_t _length{0};
+    // Bytes left in the current block, 0 - next byte is a code
+    uint8_t _remaining{0};
+    // The current block ends in an implied zero
+    bool _zeroPending{false};
+    bool _discarding{false};
+    uint32_t _errors{0};
+
+    void Drop()
+    {
+        _errors++;
+        _discarding = true;
+    }
+
+public:
+    size_t Push(uint8_t byte)
+    {
+        if (byte == 0)
+        {
+            size_t length = _length;
+            bool valid = !_discarding && _remaining == 0 && length > 0;
+            if (!_discarding && _remaining != 0) _errors++;
+            _length = 0;
+            _remaining = 0;
+            _zeroPending = false;
+            _discarding = false;
+            return valid ? length : 0;
+        }
+        if (_discarding) return 0;
+
+        if (_remaining == 0)
+        {
+            // The implied zero of the previous block, never after the last one
+            if (_zeroPending)
+            {
+                if (_length >= Capacity)
+                {
+                    Drop();
+                    return 0;
+                }
+                _buffer[_length++] = 0;
+            }
+            _remaining = byte - 1;
+            _zeroPending = byte != 0xFF;
+            return 0;
+        }
+
+        if (_length >= Capacity)
+        {
+            Drop();
+            return 0;
+        }
+        _buffer[_length++] = byte;
+        _remaining--;
+        return 0;
+    }
+
+    const uint8_t *GetFrame() const { return _buffer; }
+    // Frames dropped for overflow or a truncated block
+    uint32_t GetErrors() const { return _errors; }
+};
+
+#endif
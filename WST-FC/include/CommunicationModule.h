@@ -4,6 +4,7 @@
 #include <WiFi.h>
 #include <WiFiUdp.h>
 #include "DroneData.h"
+#include "SeqLock.h"
 #include "Configuration.h"
 #include "communicationModules\ICommunicationInterface.h"
 #include "communicationModules\CommunicationWiFiUDPModule.h"
@@ -14,18 +15,25 @@
 class CommunicationModule
 {
 private:
-    DroneControlData *sharedData;
-    ICommunicationInterface *communicationInterface;
+    SeqLock<DroneControlData> *sharedData;
+    SeqLock<SensorsData> *telemetryData;
+    ICommunicationInterface *communicationInterface{nullptr};
     wl_status_t connectionStatus{WL_IDLE_STATUS};
     DroneStatus *droneStatus;
 
 public:
-    CommunicationModule(DroneControlData *dataPtr, DroneStatus *status);
+    // telemetry: links that stream telemetry on their own read it from here
+    CommunicationModule(SeqLock<DroneControlData> *dataPtr, DroneStatus *status, SeqLock<SensorsData> *telemetry = nullptr);
+    // Wraps an interface created and initialized elsewhere (e.g. a static Link)
+    CommunicationModule(ICommunicationInterface *interface, DroneStatus *status);
 
     void Init();
     void Loop();
     void SendData(SensorsData* data);
     void SendData(DroneControlData* data);
+    void PrintStats(Print &out);
+    // nullptr before Init()
+    ICommunicationInterface *GetInterface() { return communicationInterface; }
 };
 
 #endif
\ No newline at end of file
@@ -11,6 +11,132 @@
 #define COMMUNICATION_METHOD 3
 #define TELEMETRY_TIME 1000
 
+// 1 - keyframe + delta stream (TelemetryStream.h), 0 - full SensorsData every TELEMETRY_TIME
+#define TELEMETRY_STREAM 1
+// Starts at MIN, the link quality sets the ceiling
+#define TELEMETRY_MIN_HZ 5
+#define TELEMETRY_MAX_HZ 100
+#define TELEMETRY_RATE_STEP_HZ 0.5f
+// Frames between keyframes, also the longest a lost keyframe leaves the receiver without samples
+#define TELEMETRY_KEYFRAME_INTERVAL 50
+// Slower field rate classes, sent every Nth frame: distance sensors / battery and DHT
+#define TELEMETRY_MEDIUM_DIVIDER 4
+#define TELEMETRY_SLOW_DIVIDER 20
+
+// WiFi UDP link (COMMUNICATION_METHOD 0). 1 - own task drains the socket and
+// keeps the newest control frame, 0 - one datagram per comms loop (WiFiUDP)
+#define UDP_RECEIVE_TASK 1
+// Above the comms task (3), it only wakes up for datagrams
+#define UDP_RECEIVE_PRIORITY 4
+
+// Serial link (COMMUNICATION_METHOD 2). UART 0 is the USB port and shares it
+// with the log; 1/2 need pins. ESP32 UARTs run up to 5 Mbaud, USB bridges
+// usually to 2-3 Mbaud (CP2102N, CH343).
+#define SERIAL_LINK_UART 0
+#define SERIAL_LINK_BAUD 921600
+#define SERIAL_LINK_RX_PIN -1
+#define SERIAL_LINK_TX_PIN -1
+// Driver ring buffers, filled and drained by the UART interrupt
+#define SERIAL_LINK_RX_BUFFER 1024
+#define SERIAL_LINK_TX_BUFFER 1024
+// Telemetry streamed back over the link, 0 falls back to TELEMETRY_TIME
+#define SERIAL_TELEMETRY_HZ 50
+
+// ESP-NOW telemetry (COMMUNICATION_METHOD 1). The rate climbs by STEP per
+// delivered sample up to MAX and halves on every failed frame.
+#define ESPNOW_TELEMETRY_MAX_HZ 50
+#define ESPNOW_TELEMETRY_MIN_HZ 2
+#define ESPNOW_TELEMETRY_STEP_HZ 1.0f
+// Frames normally complete within a few ms, retries included
+#define ESPNOW_SEND_TIMEOUT_MS 50
+
+// Scheduler (rates in Hz)
+#define CONTROL_LOOP_HZ 500
+#define CONTROL_LOOP_CORE 1
+#define COMMS_LOOP_HZ 200
+#define MODULES_LOOP_HZ 50
+#define SYSTEM_CORE 0
+#define SCHEDULER_STATS_TIME 5000
+
+// I2C bus manager (I2CBus.h), -1 pins use the board default SDA/SCL.
+// 1000000 (fast-mode plus) only if every device on the bus supports it.
+#define I2C_SDA_PIN -1
+#define I2C_SCL_PIN -1
+#define I2C_CLOCK_HZ 400000
+#define I2C_QUEUE_LENGTH 16
+#define I2C_DEFAULT_TIMEOUT_MS 5
+// Above the control task on the same core, it sleeps while the transfer runs
+#define I2C_BUS_PRIORITY 6
+
+// RMT channels. ESP32: 0-7, RX or TX. ESP32-C3: 0-1 TX, 2-3 RX.
+#define DHT_RMT_CHANNEL 2
+#define ULTRASONIC_RMT_CHANNEL 0
+// Motor i: TX DSHOT_RMT_CHANNEL + i, RX (bidirectional) DSHOT_RMT_RX_CHANNEL + i
+#define DSHOT_RMT_CHANNEL 4
+#define DSHOT_RMT_RX_CHANNEL 6
+
+// Battery monitor (BatteryAdcSensor.h). ADC1 channels only, ADC2 is taken by WiFi.
+// ESP32: channel 6 = GPIO34, 7 = GPIO35. -1 disables the current channel.
+#define BATTERY_VOLTAGE_ADC_CHANNEL 6
+#define BATTERY_CURRENT_ADC_CHANNEL -1
+// Battery volts per ADC volt, (R1 + R2) / R2 of the divider
+#define BATTERY_DIVIDER_RATIO 8.0f
+// Current sense output, e.g. 40 mV/A and 0 mV offset for a unidirectional ACS758-50U
+#define BATTERY_CURRENT_MV_PER_AMP 40.0f
+#define BATTERY_CURRENT_OFFSET_MV 0.0f
+// Conversions per second over all channels (ESP32 minimum is 20 kHz)
+#define BATTERY_ADC_SAMPLE_HZ 20000
+// Low-pass cutoff on the averaged frames, high enough to see sag under a throttle step
+#define BATTERY_FILTER_HZ 20.0f
+
+// DC motors (DCMotor.h). 20 kHz is above hearing, most small H-bridges take up to 50-100 kHz
+#define DC_MOTOR_PWM_HZ 20000
+// 0 - coast (fast decay), 1 - brake (slow decay)
+#define DC_MOTOR_DECAY 0
+// Half-bridge wiring only, 100 ns steps
+#define DC_MOTOR_DEADTIME_NS 500
+
+// ESCs. 0 - servo PWM (ESCActuator), 1 - DShot (DShotActuator.h)
+#define ESC_PROTOCOL 0
+// 150, 300 or 600 kbit/s
+#define DSHOT_SPEED 600
+// eRPM replies on the signal wire, the ESC firmware has to support it (BLHeli_32, Bluejay)
+#define DSHOT_BIDIRECTIONAL 0
+#define DSHOT_MOTOR_POLES 14
+
+// Servos. 1 - synchronized MCPWM outputs (ServoBank.h), 0 - ESP32Servo (ServoMotor.h, ESP32-C3)
+#define SERVO_BANK 1
+// 50 for analog servos, digital ones take 200/333, narrow pulse ones 560
+#define SERVO_RATE_HZ 50
+// DCMotor takes unit 0 for pwmChannel 0-2
+#define SERVO_MCPWM_UNIT 1
+
+// Time SensorsModule or Sensors<> may spend per control tick, critical sensors included
+#define SENSORS_TICK_BUDGET_US 1000
+
+// 1 - vehicle wired at compile time (Vehicle.h), 0 - runtime IMixer/ISensor setup
+#define STATIC_VEHICLE 1
+
+// Prints cycle benchmarks from setup(), see Benchmark.h
+#define USE_BENCHMARK 0
+#define BENCHMARK_ITERATIONS 1000
+
+// 0 - complementary filter, 1 - Madgwick, 2 - Mahony
+#define ATTITUDE_ESTIMATOR 1
+// 1 - native MPU6050 driver (hardware FIFO + data-ready INT), 0 - Adafruit library
+#define MPU_NATIVE_DRIVER 1
+#define MPU_SAMPLE_RATE_HZ 1000
+#define MPU_DLPF_CFG 2 // 94 Hz accel / 98 Hz gyro bandwidth
+#define MPU_INT_PIN 27 // -1 polls the FIFO without INT timestamps
+// Prints raw IMU samples as CSV for tools/estimator_replay.cpp
+#define LOG_IMU_SAMPLES 0
+
+// ADXL345 attitude and gravity compensation in integers, for boards without
+// FPU (set for the esp32-c3-super-mini env). The MPU estimators stay float.
+#ifndef USE_FIXED_POINT_MATH
+    #define USE_FIXED_POINT_MATH 0
+#endif
+
 enum DroneStatus
 {
     WORKS,
@@ -18,6 +144,34 @@ enum DroneStatus
     BROKEN
 };
 
+// Flight recorder, see Blackbox.h. Control input, estimator, PID terms and
+// actuator commands of every control tick, about 20 kB/s at 500 Hz.
+#define USE_BLACKBOX 1
+// 0 - "blackbox" flash partition (partitions_blackbox.csv), 1 - SD card (esp32cam env sets it)
+#ifndef BLACKBOX_STORAGE
+    #define BLACKBOX_STORAGE 0
+#endif
+// Records every Nth control tick. About 39 B a record: at 4 (125 Hz, ~5 kB/s)
+// the 0x160000 flash partition holds about 290 s, a run gets at least half of
+// it (~145 s) and pauses with neutral inputs erase the oldest data to give the
+// next run as much again. 1 records every tick, 74 s / 37 s.
+#define BLACKBOX_RATE_DIVIDER 4
+// 1 - recording starts at the first non-neutral control input, 0 - at boot
+#define BLACKBOX_START_ON_INPUT 1
+// Neutral inputs for this long count as a pause, the flash storage erases then
+#define BLACKBOX_QUIET_MS 500
+#define BLACKBOX_RECYCLE_CHECK_MS 100
+// 1 - also erase in motion when the flash is full, the newest data is always
+// kept but every sector erase stalls the control task for ~45 ms
+#define BLACKBOX_RECYCLE_IN_MOTION 0
+// Writer task on SYSTEM_CORE, it sleeps while blocks are written
+#define BLACKBOX_TASK_PRIORITY 4
+
+// Hot-path spans, see Trace.h. Compiled out when 0
+#define USE_TRACE 0
+#define TRACE_BUFFER_SIZE 1024
+#define TRACE_REQUEST_BYTE 0x54 // 'T'
+
 #define USE_WIREGUARD 0
 
 #if USE_WIREGUARD
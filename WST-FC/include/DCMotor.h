@@ -2,113 +2,120 @@
 #define DCMOTOR_H
 
 #include "IActuator.h"
+#include "Configuration.h"
+#include <soc/soc_caps.h>
+#if SOC_MCPWM_SUPPORTED
+    #include <driver/mcpwm.h>
+#endif
 
-class DCMotor : public IActuator
+enum DCMotorWiring
+{
+    // IN1/IN2 set the direction, EN carries the PWM (L298N)
+    DC_WIRING_DIR_EN,
+    // PWM on IN1 or IN2 (DRV8833, MX1508, TB6612 with PWM tied high)
+    DC_WIRING_IN_IN,
+    // Discrete half-bridge, pin1 = high side, pin2 = low side. Complementary
+    // outputs with dead-time, one direction only. MCPWM only.
+    DC_WIRING_HALF_BRIDGE
+};
+
+enum DCMotorDecay
+{
+    // Off phase and stop leave the motor floating, it coasts
+    DC_DECAY_COAST,
+    // Off phase and stop short the motor, it brakes. Speed follows duty more linearly.
+    DC_DECAY_BRAKE
+};
+
+struct DCMotorConfig
+{
+    int pin1{-1};
+    int pin2{-1};
+    // DC_WIRING_DIR_EN only
+    int enablePin{-1};
+    // MCPWM: 0-5 = unit (channel / 3), timer (channel % 3). LEDC: channel.
+    int pwmChannel{0};
+    bool reversed{false};
+    DCMotorWiring wiring{DC_WIRING_IN_IN};
+    DCMotorDecay decay{(DCMotorDecay)DC_MOTOR_DECAY};
+    uint32_t frequencyHz{DC_MOTOR_PWM_HZ};
+    uint32_t deadTimeNs{DC_MOTOR_DEADTIME_NS};
+};
+
+// Brushed motor on an H-bridge. Driven by MCPWM where the chip has it
+// (LEDC otherwise). Set() returns early when the command did not change,
+// and a new duty on the same direction is a single compare register write;
+// only a direction change reconfigures the outputs.
+class DCMotor final : public IActuator
 {
 private:
-    int _pinIN1, _pinIN2, _pinEN;
-    int _pwmChannel;
-    bool _revDir;
-    bool _hasENPin;
+    enum Leg {LEG_LOW, LEG_HIGH, LEG_PWM};
+
+    DCMotorConfig _config;
+    bool _initiated{false};
+    int16_t _speed{0};
+    // Last state written to the hardware, 0 = stopped, 1 / -1 = direction
+    int8_t _direction{0};
+    uint32_t _duty{0};
+    uint32_t _writes{0};
+
+#if SOC_MCPWM_SUPPORTED
+    mcpwm_unit_t _unit;
+    mcpwm_timer_t _timer;
+    bool _legPwm[2] = {false, false};
+#else
+    // Pin the LEDC channel is attached to, -1 none
+    int _ledcPin{-1};
+#endif
+
+    void Apply(int8_t direction, uint32_t duty);
+    void SetLeg(uint8_t leg, Leg state, uint32_t duty);
 
 public:
+    explicit DCMotor(const DCMotorConfig &config) : _config(config) {}
+
+    // 3 pin: IN1, IN2, EN
     DCMotor(int pinIN1, int pinIN2, int pinEN, int pwmChannel, bool revDir = false)
     {
-        _pinIN1 = pinIN1;
-        _pinIN2 = pinIN2;
-        _pinEN = pinEN;
-        _pwmChannel = pwmChannel;
-        _revDir = revDir;
-        _hasENPin = true;
+        _config.pin1 = pinIN1;
+        _config.pin2 = pinIN2;
+        _config.enablePin = pinEN;
+        _config.pwmChannel = pwmChannel;
+        _config.reversed = revDir;
+        _config.wiring = DC_WIRING_DIR_EN;
     }
 
+    // 2 pin: IN1, IN2
     DCMotor(int pinIN1, int pinIN2, int pwmChannel, bool revDir = false)
     {
-        _pinIN1 = pinIN1;
-        _pinIN2 = pinIN2;
-        _pinEN = -1;
-        _pwmChannel = pwmChannel;
-        _revDir = revDir;
-        _hasENPin = false;
+        _config.pin1 = pinIN1;
+        _config.pin2 = pinIN2;
+        _config.pwmChannel = pwmChannel;
+        _config.reversed = revDir;
+        _config.wiring = DC_WIRING_IN_IN;
     }
 
-    void Init() override
-    {
-        ledcSetup(_pwmChannel, 1000, 8); // 1kHz, 8 bit (0-255)
-        pinMode(_pinIN1, OUTPUT);
-        pinMode(_pinIN2, OUTPUT);
-        if(_hasENPin)
-        {
-            ledcAttachPin(_pinEN, _pwmChannel);
-        }
-        else
-        {
-            digitalWrite(_pinIN1, LOW);
-            digitalWrite(_pinIN2, LOW);
-        }
-    }
+    void Init() override;
 
     void Set(int16_t speed) override
     {
-        int pwmValue = map(abs(speed), 0, 1000, 0, 255);
-        if (pwmValue > 255) pwmValue = 255;
-        
-        if(_revDir == true) speed = -speed;
-
-        if (_hasENPin)
-        {
-            // 3PIN
-            if (speed > 0)
-            {
-                digitalWrite(_pinIN1, HIGH);
-                digitalWrite(_pinIN2, LOW);
-            }
-            else if (speed < 0)
-            {
-                digitalWrite(_pinIN1, LOW);
-                digitalWrite(_pinIN2, HIGH);
-            }
-            else
-            {
-                digitalWrite(_pinIN1, LOW);
-                digitalWrite(_pinIN2, LOW);
-            }
-            ledcWrite(_pwmChannel, pwmValue);
-        }
-        else
-        {
-            // 2 PIN
-            if (speed > 0)
-            {
-                ledcDetachPin(_pinIN2); 
-                pinMode(_pinIN2, OUTPUT);
-                digitalWrite(_pinIN2, LOW);
-                
-                ledcAttachPin(_pinIN1, _pwmChannel);
-                ledcWrite(_pwmChannel, pwmValue);
-            }
-            else if (speed < 0)
-            {
-                ledcDetachPin(_pinIN1);
-                pinMode(_pinIN1, OUTPUT);
-                digitalWrite(_pinIN1, LOW);
-
-                ledcAttachPin(_pinIN2, _pwmChannel);
-                ledcWrite(_pwmChannel, pwmValue);
-            }
-            else
-            {
-                ledcDetachPin(_pinIN1);
-                ledcDetachPin(_pinIN2);
-                pinMode(_pinIN1, OUTPUT);
-                pinMode(_pinIN2, OUTPUT);
-                digitalWrite(_pinIN1, LOW);
-                digitalWrite(_pinIN2, LOW);
-            }
-        }
+        TRACE_SCOPE("DCMotor::Set");
+        if (speed > 1000) speed = 1000;
+        if (speed < -1000) speed = -1000;
+        if (!_initiated || speed == _speed) return;
+        _speed = speed;
+
+        if (_config.reversed) speed = -speed;
+        if (_config.wiring == DC_WIRING_HALF_BRIDGE && speed < 0) speed = 0;
+        int8_t direction = speed > 0 ? 1 : (speed < 0 ? -1 : 0);
+        uint32_t duty = speed < 0 ? -speed : speed;
+        if (direction != _direction || duty != _duty) Apply(direction, duty);
     }
 
     void Loop() override {}
+
+    // Hardware updates since Init(), for checking the change-only path
+    uint32_t GetWrites() const { return _writes; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,78 @@
+#ifndef DSHOTACTUATOR_H
+#define DSHOTACTUATOR_H
+
+#include "IActuator.h"
+#include "ISensor.h"
+#include "Configuration.h"
+#include <driver/rmt.h>
+
+// 16 bits + a closing zero length item
+#define DSHOT_FRAME_ITEMS 17
+// Below this the ESC treats the value as a command, 0 stops the motor
+#define DSHOT_THROTTLE_MIN 48
+#define DSHOT_THROTTLE_MAX 2047
+
+// One ESC on an RMT TX channel, DShot150/300/600 (DSHOT_SPEED). Set() encodes
+// the frame and starts the channel without waiting for it, so every motor the
+// mixer sets goes out within the same control tick, tens of microseconds
+// apart instead of a 20 ms servo period.
+//
+// Bidirectional DShot (rxChannel >= 0): the signal is inverted and the ESC
+// answers every frame on the same wire with its eRPM, GCR coded at 5/4 of
+// the bit rate. An RMT RX channel on the same pin records it and the next
+// Set() decodes it.
+class DShotActuator final : public IActuator
+{
+private:
+    int _pin;
+    rmt_channel_t _txChannel;
+    int _rxChannel;
+    uint8_t _poles;
+    bool _initiated{false};
+
+    rmt_item32_t _frame[DSHOT_FRAME_ITEMS];
+    uint16_t _bitTicks;
+    uint16_t _oneHighTicks;
+    uint16_t _zeroHighTicks;
+    RingbufHandle_t _ringbuf{nullptr};
+
+    uint32_t _erpm{0};
+    uint32_t _telemetryFrames{0};
+    uint32_t _telemetryErrors{0};
+
+    void Encode(uint16_t value);
+    void ReadTelemetry();
+    // 1 - eRPM decoded, 0 - not a reply (our own frame seen by the RX), -1 - corrupt reply
+    int8_t DecodeTelemetry(const rmt_item32_t *items, size_t count, uint32_t &erpm) const;
+
+public:
+    // pin, TX channel, RX channel for bidirectional DShot or -1
+    DShotActuator(int pin, int txChannel, int rxChannel = -1, uint8_t motorPoles = DSHOT_MOTOR_POLES);
+
+    void Init() override;
+    // 0 - stop, 1..1000 - throttle
+    void Set(int16_t speed) override;
+    void Loop() override {}
+
+    bool IsBidirectional() const { return _rxChannel >= 0; }
+    uint32_t GetErpm() const { return _erpm; }
+    uint32_t GetRpm() const { return _erpm * 2 / _poles; }
+    uint32_t GetTelemetryFrames() const { return _telemetryFrames; }
+    // Replies with a bad GCR code, length or checksum
+    uint32_t GetTelemetryErrors() const { return _telemetryErrors; }
+};
+
+// Copies the RPM of up to 4 bidirectional DShot motors into SensorsData
+class DShotTelemetry final : public ISensor
+{
+private:
+    DShotActuator *_motors[4];
+    uint8_t _count;
+
+public:
+    DShotTelemetry(DShotActuator *const *motors, uint8_t count);
+    void Init() override {}
+    void Update(SensorsData *data) override;
+};
+
+#endif
@@ -4,7 +4,7 @@
 #include "IActuator.h"
 #include <ESP32Servo.h>
 
-class ESCActuator : public IActuator {
+class ESCActuator final : public IActuator {
 private:
     Servo _esc;
     int _pin;
@@ -28,6 +28,7 @@ public:
 
 
     void Set(int16_t speed) override {
+        TRACE_SCOPE("ESCActuator::Set");
         if (speed < 0) speed = 0;
         if (speed > 1000) speed = 1000;
 
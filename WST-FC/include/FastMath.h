@@ -0,0 +1,161 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <stdint.h>
+
+// Approximate trigonometry for the estimator hot path. Everything is float
+// (never double) or integer, so it stays cheap on the ESP32-C3 which has no FPU.
+// Error bounds are checked by tools/fastmath_bench.cpp.
+
+#define FAST_PI 3.14159265f
+#define FAST_HALF_PI 1.57079633f
+#define FAST_TWO_PI 6.28318531f
+#define FAST_RAD_TO_DEG 57.2957795f
+#define FAST_DEG_TO_RAD 0.0174532925f
+#define GRAVITY 9.81f
+
+// Q15: 1.0 == 32768
+#define Q15_ONE 32768
+// Angles in fixed point are centidegrees, the same unit as SensorsData
+#define CENTIDEG_90 9000
+#define CENTIDEG_180 18000
+#define CENTIDEG_360 36000
+
+// atan(z) for |z| <= 1, |error| < 1.5e-5 rad
+inline float FastAtanUnit(float z)
+{
+    float z2 = z * z;
+    return z * (0.9998660f + z2 * (-0.3302995f + z2 * (0.1801410f + z2 * (-0.0851330f + z2 * 0.0208351f))));
+}
+
+// |error| < 1.5e-5 rad, FastAtan2(0, 0) == 0
+inline float FastAtan2(float y, float x)
+{
+    float absX = x < 0 ? -x : x;
+    float absY = y < 0 ? -y : y;
+    if (absX == 0.0f && absY == 0.0f) return 0.0f;
+
+    float angle;
+    if (absX >= absY)
+    {
+        angle = FastAtanUnit(absY / absX);
+    }
+    else
+    {
+        angle = FAST_HALF_PI - FastAtanUnit(absX / absY);
+    }
+
+    if (x < 0) angle = FAST_PI - angle;
+    return y < 0 ? -angle : angle;
+}
+
+// |error| < 5e-6 for |x| < 4 pi, range reduction loses precision beyond that
+inline float FastSin(float x)
+{
+    // Reduce to [-pi, pi]
+    float turns = x * (1.0f / FAST_TWO_PI);
+    int32_t whole = (int32_t)(turns + (turns >= 0 ? 0.5f : -0.5f));
+    x -= whole * FAST_TWO_PI;
+
+    // Fold to [-pi/2, pi/2] using sin(pi - x) == sin(x)
+    if (x > FAST_HALF_PI) x = FAST_PI - x;
+    else if (x < -FAST_HALF_PI) x = -FAST_PI - x;
+
+    float x2 = x * x;
+    return x * (1.0f + x2 * (-0.16666667f + x2 * (0.0083333310f + x2 * (-0.00019840874f + x2 * 2.7525562e-6f))));
+}
+
+inline float FastCos(float x)
+{
+    return FastSin(x + FAST_HALF_PI);
+}
+
+// Integer atan2 in centidegrees, |error| < 2 centidegrees.
+// |x| and |y| must fit in 16 bits (raw sensor counts), so all math stays 32 bit.
+inline int32_t FixedAtan2(int32_t y, int32_t x)
+{
+    uint32_t absX = x < 0 ? -x : x;
+    uint32_t absY = y < 0 ? -y : y;
+    if (absX == 0 && absY == 0) return 0;
+
+    bool swapped = absY > absX;
+    uint32_t num = swapped ? absX : absY;
+    uint32_t den = swapped ? absY : absX;
+    // z in Q15, 0..1
+    int32_t z = (int32_t)((num << 15) / den);
+    int32_t z2 = (z * z) >> 15;
+
+    // Same polynomial as FastAtanUnit, coefficients in Q15
+    int32_t poly = 683;                     //  0.0208351
+    poly = -2790 + ((poly * z2) >> 15);     // -0.0851330
+    poly = 5903 + ((poly * z2) >> 15);      //  0.1801410
+    poly = -10823 + ((poly * z2) >> 15);    // -0.3302995
+    poly = 32764 + ((poly * z2) >> 15);     //  0.9998660
+    int32_t radQ15 = (poly * z) >> 15;
+
+    // rad (Q15) -> centidegrees: 18000 / pi / 2^15 == 11459 / 2^16
+    int32_t angle = (radQ15 * 11459 + (1 << 15)) >> 16;
+    if (swapped) angle = CENTIDEG_90 - angle;
+    if (x < 0) angle = CENTIDEG_180 - angle;
+    return y < 0 ? -angle : angle;
+}
+
+// Integer sine of centidegrees, result in Q15, |error| < 8 LSB (2.5e-4)
+inline int32_t FixedSin(int32_t centideg)
+{
+    centideg %= CENTIDEG_360;
+    if (centideg < 0) centideg += CENTIDEG_360;
+
+    bool negative = centideg >= CENTIDEG_180;
+    if (negative) centideg -= CENTIDEG_180;
+    if (centideg > CENTIDEG_90) centideg = CENTIDEG_180 - centideg;
+
+    // t: fraction of a quarter turn in Q15
+    int32_t t = (centideg * Q15_ONE) / CENTIDEG_90;
+    int32_t t2 = (t * t) >> 15;
+
+    // sin(pi/2 * t) = t * (1.5707963 - t2 * (0.6459640 - t2 * (0.0796926 - t2 * 0.0046817)))
+    int32_t poly = 153;                     // 0.0046817
+    poly = 2611 - ((poly * t2) >> 15);      // 0.0796926
+    poly = 21167 - ((poly * t2) >> 15);     // 0.6459640
+    poly = 51472 - ((poly * t2) >> 15);     // 1.5707963
+    int32_t result = (poly * t) >> 15;
+
+    if (result > Q15_ONE) result = Q15_ONE;
+    return negative ? -result : result;
+}
+
+inline int32_t FixedCos(int32_t centideg)
+{
+    return FixedSin(centideg + CENTIDEG_90);
+}
+
+// Removes gravity for the given attitude (degrees, pitch about X, roll about Y),
+// accel in m/s^2. Gravity in the sensor frame is (-sin r, cos r sin p, cos r cos p).
+inline void RemoveGravity(float pitchDeg, float rollDeg, float accel[3])
+{
+    float radPitch = pitchDeg * FAST_DEG_TO_RAD;
+    float radRoll = rollDeg * FAST_DEG_TO_RAD;
+    float cosRoll = FastCos(radRoll);
+    accel[0] += FastSin(radRoll) * GRAVITY;
+    accel[1] -= cosRoll * FastSin(radPitch) * GRAVITY;
+    accel[2] -= cosRoll * FastCos(radPitch) * GRAVITY;
+}
+
+// Integer RemoveGravity: attitude in centidegrees, accel in cm/s^2 (x100 m/s^2)
+inline void RemoveGravityFixed(int32_t pitchCdeg, int32_t rollCdeg, int32_t accel[3])
+{
+    const int32_t gravity = 981;
+    int32_t cosRoll = FixedCos(rollCdeg);
+    accel[0] += (FixedSin(rollCdeg) * gravity) >> 15;
+    accel[1] -= (((cosRoll * FixedSin(pitchCdeg)) >> 15) * gravity) >> 15;
+    accel[2] -= (((cosRoll * FixedCos(pitchCdeg)) >> 15) * gravity) >> 15;
+}
+
+// Round trip echo time -> distance in cm (0.034 cm/us / 2), 0.017 * 2^16 = 1114
+inline uint32_t EchoMicrosToCm(uint32_t durationUs)
+{
+    return (durationUs * 1114UL) >> 16;
+}
+
+#endif
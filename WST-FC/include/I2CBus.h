@@ -0,0 +1,92 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "Configuration.h"
+
+// Callback runs on the bus task, keep it short and copy data out under a lock
+typedef void (*I2CCallback)(void *context, bool ok);
+
+struct I2CTransaction
+{
+    uint8_t address{0};
+    uint8_t reg{0};
+    // Read destination / write source, owned by the caller until the callback
+    uint8_t *buffer{nullptr};
+    uint8_t length{0};
+    // Single byte register writes carry the value here instead of buffer
+    uint8_t value{0};
+    bool write{false};
+    uint16_t timeoutMs{I2C_DEFAULT_TIMEOUT_MS};
+    I2CCallback callback{nullptr};
+    void *context{nullptr};
+    int64_t queuedUs{0};
+};
+
+struct I2CBusStats
+{
+    uint32_t transactions{0};
+    uint32_t bytes{0};
+    // Device did not acknowledge, bus is fine
+    uint32_t nacks{0};
+    // Expired in the queue or clock stretched past the timeout
+    uint32_t timeouts{0};
+    uint32_t errors{0};
+    uint32_t recoveries{0};
+    // Rejected because the queue was full
+    uint32_t dropped{0};
+    uint32_t maxQueueDepth{0};
+    uint32_t maxLatencyUs{0};
+    uint64_t latencySumUs{0};
+    // Time spent on the wire, for utilization
+    uint64_t busyUs{0};
+    int64_t sinceUs{0};
+};
+
+// Owns the I2C peripheral. Sensors enqueue transactions from the control task
+// and a core-pinned bus task performs them, so a slow or missing device costs
+// the caller nothing but a late callback. A stuck bus is recovered by clocking
+// SCL until the slave releases SDA.
+class I2CBus
+{
+private:
+    int _sda{-1};
+    int _scl{-1};
+    uint32_t _clockHz{I2C_CLOCK_HZ};
+    uint16_t _currentTimeoutMs{0};
+
+    QueueHandle_t _queue{nullptr};
+    // Serializes the bus task with synchronous callers
+    SemaphoreHandle_t _mutex{nullptr};
+    TaskHandle_t _task{nullptr};
+    I2CBusStats _stats;
+
+    static void TaskBody(void *arg);
+    bool Enqueue(I2CTransaction &transaction);
+    // Caller holds _mutex
+    bool Transfer(I2CTransaction &transaction);
+    void Recover();
+
+public:
+    // sda/scl < 0 use the board defaults
+    bool Begin(int sda, int scl, uint32_t clockHz, UBaseType_t priority = I2C_BUS_PRIORITY, BaseType_t core = CONTROL_LOOP_CORE);
+
+    // Non-blocking, false when the queue is full
+    bool Read(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t length, I2CCallback callback, void *context, uint16_t timeoutMs = I2C_DEFAULT_TIMEOUT_MS);
+    bool Write(uint8_t address, uint8_t reg, uint8_t value, I2CCallback callback = nullptr, void *context = nullptr, uint16_t timeoutMs = I2C_DEFAULT_TIMEOUT_MS);
+
+    // Blocking, for Init() code
+    bool ReadSync(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t length, uint16_t timeoutMs = I2C_DEFAULT_TIMEOUT_MS);
+    bool WriteSync(uint8_t address, uint8_t reg, uint8_t value, uint16_t timeoutMs = I2C_DEFAULT_TIMEOUT_MS);
+
+    // Exclusive access for drivers that talk to Wire directly
+    void Lock();
+    void Unlock();
+
+    I2CBusStats GetStats() const { return _stats; }
+    void ResetStats();
+    void PrintStats(Print &out) const;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef IMOTOR_H
 #define IMOTOR_H
 #include <Arduino.h>
+#include "Trace.h"
 class IActuator
 {
 public:
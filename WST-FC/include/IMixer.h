@@ -2,6 +2,9 @@
 #define IMIXER_H
 
 #include "DroneData.h"
+#include "SensorsData.h"
+#include "BlackboxFormat.h"
+#include "Trace.h"
 
 class IMixer
 {
@@ -10,6 +13,8 @@ public:
     virtual void Init() = 0;
     virtual void Update(DroneControlData *input, SensorsData *sensors) = 0;
     virtual void StopAll() = 0;
+    // PID terms and actuator commands of the last Update(), for the blackbox
+    virtual void FillBlackbox(BlackboxRecord &record) const {}
 };
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define ISENSOR_H
 
 #include "SensorsData.h"
+#include "Trace.h"
 
 class ISensor
 {
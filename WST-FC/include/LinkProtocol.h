@@ -0,0 +1,348 @@
+#ifndef LINKPROTOCOL_H
+#define LINKPROTOCOL_H
+
+// Frame format shared by every link (UDP, ESP-NOW, Serial) and the ground
+// station. Plain C++, no Arduino includes, so host tools build it as is.
+//
+//   | magic | version | type | length | sequence | timestampUs | payload | crc |
+//   |  u8   |   u8    |  u8  |  u16   |   u16    |    u32      | length  | u16 |
+//
+// Little endian, the CRC (CRC-16/CCITT-FALSE) covers header and payload.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LINK_MAGIC 0xA5
+#define LINK_VERSION 1
+// Packets this far behind the newest one are taken as a restarted sender
+#define LINK_SEQUENCE_RESYNC 1024
+// Late packets inside this window are told apart from duplicates
+#define LINK_SEQUENCE_WINDOW 32
+// Fragments a LinkReassembler tracks per message
+#define LINK_MAX_FRAGMENTS 64
+
+enum LinkMessageType : uint8_t
+{
+    LINK_MSG_CONTROL = 1,
+    LINK_MSG_TELEMETRY = 2,
+    // Part of a message too large for one datagram, see LinkFragmentHeader
+    LINK_MSG_FRAGMENT = 3,
+    // Keyframe or delta of the telemetry stream, see TelemetryCodec.h
+    LINK_MSG_TELEMETRY_DELTA = 4,
+};
+
+enum LinkDecodeResult : uint8_t
+{
+    LINK_DECODE_OK = 0,
+    LINK_DECODE_SHORT,
+    LINK_DECODE_MAGIC,
+    LINK_DECODE_VERSION,
+    LINK_DECODE_LENGTH,
+    LINK_DECODE_CRC,
+};
+
+#pragma pack(push, 1)
+struct LinkHeader
+{
+    uint8_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint16_t length;
+    uint16_t sequence;
+    // Sender clock, micros() on the vehicle
+    uint32_t timestampUs;
+};
+
+// Starts the payload of a LINK_MSG_FRAGMENT frame, the chunk follows it.
+// Every fragment of a message has its own frame sequence number.
+struct LinkFragmentHeader
+{
+    // Type of the whole message
+    uint8_t type;
+    // Same for all fragments of one message
+    uint16_t message;
+    uint16_t offset;
+    uint16_t total;
+};
+#pragma pack(pop)
+
+#define LINK_CRC_SIZE 2
+#define LINK_OVERHEAD (sizeof(LinkHeader) + LINK_CRC_SIZE)
+
+struct LinkFrame
+{
+    LinkHeader header;
+    // Points into the decoded buffer
+    const uint8_t *payload;
+};
+
+// Nibble table, small enough for IRAM and a few cycles per byte
+inline uint16_t LinkCrc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF)
+{
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = (crc << 4) ^ table[((crc >> 12) ^ (data[i] >> 4)) & 0x0F];
+        crc = (crc << 4) ^ table[((crc >> 12) ^ data[i]) & 0x0F];
+    }
+    return crc;
+}
+
+// Writes a whole frame into out, returns its size or 0 if it does not fit
+inline size_t LinkEncode(uint8_t *out, size_t capacity, uint8_t type, uint16_t sequence, uint32_t timestampUs, const void *payload, uint16_t length)
+{
+    size_t size = LINK_OVERHEAD + length;
+    if (size > capacity) return 0;
+
+    LinkHeader header;
+    header.magic = LINK_MAGIC;
+    header.version = LINK_VERSION;
+    header.type = type;
+    header.length = length;
+    header.sequence = sequence;
+    header.timestampUs = timestampUs;
+    memcpy(out, &header, sizeof(LinkHeader));
+    // The payload may already sit in place (LinkEncodeFragment)
+    if (length > 0 && payload != out + sizeof(LinkHeader)) memcpy(out + sizeof(LinkHeader), payload, length);
+
+    uint16_t crc = LinkCrc16(out, sizeof(LinkHeader) + length);
+    out[size - 2] = crc & 0xFF;
+    out[size - 1] = crc >> 8;
+    return size;
+}
+
+// Checks one complete frame. Extra bytes after it are an error, a datagram
+// carries exactly one frame.
+inline LinkDecodeResult LinkDecode(const uint8_t *data, size_t size, LinkFrame &frame)
+{
+    if (size < LINK_OVERHEAD) return LINK_DECODE_SHORT;
+    memcpy(&frame.header, data, sizeof(LinkHeader));
+    if (frame.header.magic != LINK_MAGIC) return LINK_DECODE_MAGIC;
+    if (frame.header.version != LINK_VERSION) return LINK_DECODE_VERSION;
+    if (LINK_OVERHEAD + frame.header.length != size) return LINK_DECODE_LENGTH;
+
+    uint16_t crc = data[size - 2] | (data[size - 1] << 8);
+    if (LinkCrc16(data, size - LINK_CRC_SIZE) != crc) return LINK_DECODE_CRC;
+    frame.payload = data + sizeof(LinkHeader);
+    return LINK_DECODE_OK;
+}
+
+// Payload of the expected type and size, false for anything else
+template <typename T>
+inline bool LinkPayload(const LinkFrame &frame, uint8_t type, T &out)
+{
+    if (frame.header.type != type || frame.header.length != sizeof(T)) return false;
+    memcpy(&out, frame.payload, sizeof(T));
+    return true;
+}
+
+// Frame size for a fragment carrying chunk bytes
+#define LINK_FRAGMENT_FRAME_SIZE(chunk) (LINK_OVERHEAD + sizeof(LinkFragmentHeader) + (chunk))
+
+// Writes fragment frame number index of a length byte message split into
+// chunk byte pieces. Returns the frame size, 0 past the last fragment.
+inline size_t LinkEncodeFragment(uint8_t *out, size_t capacity, uint8_t type, uint16_t message, uint16_t index, uint16_t chunk,
+                                 uint16_t sequence, uint32_t timestampUs, const void *data, uint16_t length)
+{
+    uint32_t offset = (uint32_t)index * chunk;
+    if (offset >= length) return 0;
+    uint16_t size = length - offset < chunk ? length - offset : chunk;
+    if (LINK_FRAGMENT_FRAME_SIZE(size) > capacity) return 0;
+
+    LinkFragmentHeader fragment;
+    fragment.type = type;
+    fragment.message = message;
+    fragment.offset = offset;
+    fragment.total = length;
+    // Payload is assembled in place behind the link header, then framed
+    uint8_t *payload = out + sizeof(LinkHeader);
+    memcpy(payload, &fragment, sizeof(LinkFragmentHeader));
+    memcpy(payload + sizeof(LinkFragmentHeader), (const uint8_t *)data + offset, size);
+    return LinkEncode(out, capacity, LINK_MSG_FRAGMENT, sequence, timestampUs, payload, sizeof(LinkFragmentHeader) + size);
+}
+
+// Rebuilds one fragmented message at a time. A fragment of a newer message
+// abandons the one in progress, fragments are never waited for. Every
+// fragment but the last is chunk bytes long (LinkEncodeFragment), so its
+// index is offset / chunk; a bitmap of those drops repeated fragments.
+template <size_t Capacity>
+class LinkReassembler
+{
+private:
+    uint8_t _buffer[Capacity];
+    uint64_t _received{0};
+    uint16_t _message{0};
+    uint16_t _total{0};
+    uint16_t _chunk{0};
+    uint16_t _count{0};
+    uint16_t _lastOffset{0};
+    uint8_t _type{0};
+    bool _haveLast{false};
+    bool _active{false};
+    // _message was completed, its repeated fragments are ignored
+    bool _done{false};
+    uint32_t _incomplete{0};
+
+public:
+    // Returns the message length once its last fragment arrived, 0 otherwise
+    size_t Push(const LinkFrame &frame)
+    {
+        if (frame.header.type != LINK_MSG_FRAGMENT || frame.header.length <= sizeof(LinkFragmentHeader)) return 0;
+        LinkFragmentHeader fragment;
+        memcpy(&fragment, frame.payload, sizeof(LinkFragmentHeader));
+        uint16_t size = frame.header.length - sizeof(LinkFragmentHeader);
+        if (fragment.total > Capacity || (uint32_t)fragment.offset + size > fragment.total) return 0;
+
+        if (!_active || fragment.message != _message)
+        {
+            if (_done && fragment.message == _message) return 0;
+            if (_active) _incomplete++;
+            _active = true;
+            _done = false;
+            _message = fragment.message;
+            _total = fragment.total;
+            _type = fragment.type;
+            _received = 0;
+            _chunk = 0;
+            _count = 0;
+            _haveLast = false;
+        }
+        else if (fragment.total != _total || fragment.type != _type)
+        {
+            return 0;
+        }
+
+        if ((uint32_t)fragment.offset + size == _total)
+        {
+            if (_haveLast) return 0;
+            _haveLast = true;
+            _lastOffset = fragment.offset;
+        }
+        else
+        {
+            if (_chunk == 0) _chunk = size;
+            if (size != _chunk || fragment.offset % _chunk != 0) return 0;
+            uint16_t index = fragment.offset / _chunk;
+            if (index >= LINK_MAX_FRAGMENTS || (_received & (1ULL << index))) return 0;
+            _received |= 1ULL << index;
+            _count++;
+        }
+        memcpy(_buffer + fragment.offset, frame.payload + sizeof(LinkFragmentHeader), size);
+
+        // Complete once the last fragment and every one before it arrived
+        if (!_haveLast) return 0;
+        if (_lastOffset > 0 && (_chunk == 0 || _lastOffset % _chunk != 0 || _count != _lastOffset / _chunk)) return 0;
+        _active = false;
+        _done = true;
+        return _total;
+    }
+
+    const uint8_t *GetMessage() const { return _buffer; }
+    uint8_t GetType() const { return _type; }
+    // Messages abandoned with fragments missing
+    uint32_t GetIncomplete() const { return _incomplete; }
+};
+
+struct LinkStats
+{
+    uint32_t received{0};
+    // Sequence gaps, corrected when a late packet fills one
+    uint32_t lost{0};
+    // Arrived after a newer packet and dropped
+    uint32_t reordered{0};
+    uint32_t duplicates{0};
+    // Bad magic, version, length or CRC
+    uint32_t corrupt{0};
+    uint32_t resyncs{0};
+};
+
+// Receive side of one link. Accept() passes only packets newer than every
+// packet seen so far, so a late or repeated command never overrides a newer
+// one. A bitmap of the last LINK_SEQUENCE_WINDOW sequence numbers tells late
+// packets (counted as reordered, not lost) from duplicates.
+class LinkSequencer
+{
+private:
+    LinkStats _stats;
+    uint16_t _newest{0};
+    uint32_t _seen{0};
+    bool _started{false};
+
+    void Restart(uint16_t sequence)
+    {
+        _started = true;
+        _newest = sequence;
+        _seen = 1;
+        _stats.received++;
+    }
+
+public:
+    bool Accept(uint16_t sequence)
+    {
+        if (!_started)
+        {
+            Restart(sequence);
+            return true;
+        }
+
+        int16_t delta = (int16_t)(sequence - _newest);
+        if (delta > 0)
+        {
+            _stats.lost += delta - 1;
+            _seen = delta < LINK_SEQUENCE_WINDOW ? (_seen << delta) | 1 : 1;
+            _newest = sequence;
+            _stats.received++;
+            return true;
+        }
+        if (delta <= -LINK_SEQUENCE_RESYNC)
+        {
+            _stats.resyncs++;
+            Restart(sequence);
+            return true;
+        }
+
+        uint16_t age = -delta;
+        if (age < LINK_SEQUENCE_WINDOW)
+        {
+            uint32_t bit = 1UL << age;
+            if (_seen & bit)
+            {
+                _stats.duplicates++;
+                return false;
+            }
+            _seen |= bit;
+            if (_stats.lost > 0) _stats.lost--;
+        }
+        _stats.reordered++;
+        return false;
+    }
+
+    // Next packet starts a new stream, e.g. after the link timed out
+    void Reset() { _started = false; }
+    void CountCorrupt() { _stats.corrupt++; }
+
+    const LinkStats &GetStats() const { return _stats; }
+    void ResetStats() { _stats = LinkStats{}; }
+
+    // Works with Arduino's Print and anything else that has printf()
+    template <typename TPrint>
+    void PrintStats(TPrint &out, const char *name) const
+    {
+        LinkStats stats = _stats;
+        uint32_t expected = stats.received + stats.lost;
+        out.printf("[%s] received:%lu lost:%lu (%.1f%%) reordered:%lu duplicates:%lu corrupt:%lu resyncs:%lu\n",
+            name,
+            (unsigned long)stats.received,
+            (unsigned long)stats.lost,
+            expected > 0 ? 100.0f * stats.lost / expected : 0.0f,
+            (unsigned long)stats.reordered,
+            (unsigned long)stats.duplicates,
+            (unsigned long)stats.corrupt,
+            (unsigned long)stats.resyncs);
+    }
+};
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef MATRIXMIXER_H
+#define MATRIXMIXER_H
+
+#include "IMixer.h"
+#include "IActuator.h"
+#include "PidController.h"
+#include <Arduino.h>
+
+// Columns of the mixing matrix
+enum MixerInput : uint8_t
+{
+    // Raw sticks, -1000..1000
+    MIX_THROTTLE,
+    MIX_YAW,
+    MIX_PITCH,
+    MIX_ROLL,
+    // Stabilization loops, in their output units
+    MIX_PITCH_PID,
+    MIX_ROLL_PID,
+    MIX_YAW_PID,
+    // Constant 1, the weight is an offset (servo center, throttle idle)
+    MIX_BIAS,
+    MIXER_INPUTS
+};
+
+// Yaw stick at full deflection, degrees/s, setpoint of the yaw rate loop
+#define MIXER_MAX_YAW_RATE 200.0f
+#define MIXER_MAX_DT 0.02f
+
+// One output of the matrix
+struct MixerRow
+{
+    float weights[MIXER_INPUTS];
+    int16_t min;
+    int16_t max;
+    // Written by Init() and StopAll()
+    int16_t idle;
+    // Thrust outputs are desaturated together, the rest only clamped
+    bool desaturate;
+};
+
+// Differential drive: left, right
+constexpr MixerRow MIXER_DIFFERENTIAL[2] = {
+    {{1, 1, 0, 0, 0, 0, 0, 0}, 0, 1000, 0, true},
+    {{1, -1, 0, 0, 0, 0, 0, 0}, 0, 1000, 0, true},
+};
+
+// Same layout as BicopterMixer: motor left, motor right, servo left, servo right.
+// The pitch and roll loops start with zero gains, see BicopterMixer for a set.
+constexpr MixerRow MIXER_BICOPTER[4] = {
+    {{0.5f, 0, 0, 0, 0, 1, 0, 500}, 0, 1000, 0, true},
+    {{0.5f, 0, 0, 0, 0, -1, 0, 500}, 0, 1000, 0, true},
+    {{0, 0, 0, 0, 1, 0, 0, 1500}, 1000, 2000, 1500, false},
+    {{0, 0, 0, 0, -1, 0, 0, 1500}, 1000, 2000, 1500, false},
+};
+
+// Quad X, Betaflight motor order: rear right, front right, rear left, front left.
+// Attitude comes only from the loops, set their gains before flying.
+constexpr MixerRow MIXER_QUAD_X[4] = {
+    {{0.5f, 0, 0, 0, 1, -1, -1, 500}, 0, 1000, 0, true},
+    {{0.5f, 0, 0, 0, -1, -1, 1, 500}, 0, 1000, 0, true},
+    {{0.5f, 0, 0, 0, 1, 1, 1, 500}, 0, 1000, 0, true},
+    {{0.5f, 0, 0, 0, -1, 1, -1, 500}, 0, 1000, 0, true},
+};
+
+// outputs = matrix x [throttle, yaw, pitch, roll, PIDs, 1]. A new airframe is
+// a new table, not a new class. TActuator = IActuator drives any mix of
+// actuator types, a concrete final type lets the compiler inline Set().
+//
+// Desaturation: when a thrust output would leave its range, the collective
+// part (throttle and bias) is shifted first, and only when the attitude
+// spread alone does not fit it is scaled down. Differential thrust, and with
+// it attitude authority, is kept at the cost of throttle.
+template <size_t N, typename TActuator = IActuator>
+class MatrixMixer final : public IMixer
+{
+private:
+    TActuator *_actuators[N];
+    MixerRow _rows[N];
+    bool _usesPid[3] = {false, false, false};
+
+    CascadedPid<float> _pitchController;
+    CascadedPid<float> _rollController;
+    Pid<float> _yawController;
+    unsigned long _lastUpdateUs{0};
+
+    int16_t _outputs[N];
+    uint32_t _saturatedTicks{0};
+
+    // Pairwise sums, independent multiplies for the FPU pipeline
+    static inline float Dot(const float *w, const float *x)
+    {
+        return ((w[0] * x[0] + w[1] * x[1]) + (w[2] * x[2] + w[3] * x[3])) +
+               ((w[4] * x[4] + w[5] * x[5]) + (w[6] * x[6] + w[7] * x[7]));
+    }
+
+    void UpdateUsage()
+    {
+        for (uint8_t pid = 0; pid < 3; pid++)
+        {
+            _usesPid[pid] = false;
+            for (size_t i = 0; i < N; i++)
+            {
+                if (_rows[i].weights[MIX_PITCH_PID + pid] != 0.0f) _usesPid[pid] = true;
+            }
+        }
+    }
+
+public:
+    static_assert(MIXER_INPUTS == 8, "Dot() is unrolled for 8 inputs");
+
+    MatrixMixer(TActuator *const *actuators, const MixerRow *rows)
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            _actuators[i] = actuators[i];
+            _rows[i] = rows[i];
+            _outputs[i] = rows[i].idle;
+        }
+        UpdateUsage();
+    }
+
+    // Replaces one row, e.g. with a table loaded at runtime
+    void Load(size_t output, const MixerRow &row)
+    {
+        if (output >= N) return;
+        _rows[output] = row;
+        UpdateUsage();
+    }
+
+    void Init() override
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            if (_actuators[i]) _actuators[i]->Init();
+        }
+        StopAll();
+        _pitchController.Reset();
+        _rollController.Reset();
+        _yawController.Reset();
+        _lastUpdateUs = micros();
+    }
+
+    // Computes the outputs without touching the actuators
+    void Mix(const DroneControlData *input, const SensorsData *sensors, float dt)
+    {
+        alignas(16) float x[MIXER_INPUTS] = {
+            (float)input->throttle, (float)input->yaw, (float)input->pitch, (float)input->roll, 0, 0, 0, 1};
+
+        // Setpoints and angles are centidegrees, gyro decidegrees/s
+        if (sensors != nullptr)
+        {
+            if (_usesPid[0])
+                x[MIX_PITCH_PID] = _pitchController.Update(input->pitch * 0.01f, sensors->pitch * 0.01f, sensors->gyroX * 0.1f, dt);
+            if (_usesPid[1])
+                x[MIX_ROLL_PID] = _rollController.Update(input->roll * 0.01f, sensors->roll * 0.01f, sensors->gyroY * 0.1f, dt);
+            if (_usesPid[2])
+                x[MIX_YAW_PID] = _yawController.Update(input->yaw * (MIXER_MAX_YAW_RATE / 1000.0f), sensors->gyroZ * 0.1f, dt);
+        }
+
+        float collective[N];
+        float attitude[N];
+        for (size_t i = 0; i < N; i++)
+        {
+            const float *w = _rows[i].weights;
+            collective[i] = w[MIX_THROTTLE] * x[MIX_THROTTLE] + w[MIX_BIAS];
+            attitude[i] = Dot(w, x) - collective[i];
+        }
+
+        // Attitude spread wider than the narrowest thrust range: scale it down
+        float spreadMin = 0, spreadMax = 0, range = 0;
+        bool any = false;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (!_rows[i].desaturate) continue;
+            float outputRange = (float)(_rows[i].max - _rows[i].min);
+            if (!any || attitude[i] < spreadMin) spreadMin = attitude[i];
+            if (!any || attitude[i] > spreadMax) spreadMax = attitude[i];
+            if (!any || outputRange < range) range = outputRange;
+            any = true;
+        }
+        float scale = (any && spreadMax - spreadMin > range) ? range / (spreadMax - spreadMin) : 1.0f;
+
+        // Smallest collective shift that brings every thrust output in range
+        float shiftLow = -1e9f, shiftHigh = 1e9f;
+        for (size_t i = 0; i < N; i++)
+        {
+            if (!_rows[i].desaturate) continue;
+            float value = collective[i] + attitude[i] * scale;
+            float low = _rows[i].min - value;
+            float high = _rows[i].max - value;
+            if (low > shiftLow) shiftLow = low;
+            if (high < shiftHigh) shiftHigh = high;
+        }
+        float shift = 0.0f;
+        if (any)
+        {
+            if (shiftLow > 0.0f) shift = shiftLow;
+            else if (shiftHigh < 0.0f) shift = shiftHigh;
+        }
+        if (scale < 1.0f || shift != 0.0f) _saturatedTicks++;
+
+        for (size_t i = 0; i < N; i++)
+        {
+            const MixerRow &row = _rows[i];
+            float value = row.desaturate ? collective[i] + shift + attitude[i] * scale : collective[i] + attitude[i];
+            if (value < row.min) value = row.min;
+            if (value > row.max) value = row.max;
+            _outputs[i] = (int16_t)value;
+        }
+    }
+
+    void Update(DroneControlData *input, SensorsData *sensors) override
+    {
+        TRACE_SCOPE("MatrixMixer::Update");
+        if (input == nullptr) return;
+
+        unsigned long now = micros();
+        float dt = (now - _lastUpdateUs) * 1e-6f;
+        _lastUpdateUs = now;
+        if (dt > MIXER_MAX_DT) dt = MIXER_MAX_DT;
+
+        Mix(input, sensors, dt);
+        for (size_t i = 0; i < N; i++)
+        {
+            if (_actuators[i]) _actuators[i]->Set(_outputs[i]);
+        }
+    }
+
+    void StopAll() override
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            _outputs[i] = _rows[i].idle;
+            if (_actuators[i]) _actuators[i]->Set(_outputs[i]);
+        }
+    }
+
+    int16_t GetOutput(size_t output) const { return output < N ? _outputs[output] : 0; }
+    // Ticks where desaturation had to shift throttle or scale attitude
+    uint32_t GetSaturatedTicks() const { return _saturatedTicks; }
+
+    CascadedPid<float> &GetPitchController() { return _pitchController; }
+    CascadedPid<float> &GetRollController() { return _rollController; }
+    Pid<float> &GetYawController() { return _yawController; }
+};
+
+#endif
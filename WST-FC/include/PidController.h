@@ -0,0 +1,141 @@
+#ifndef PIDCONTROLLER_H
+#define PIDCONTROLLER_H
+
+// PID and cascaded angle/rate controllers. Header-only, no heap, no clock:
+// the caller runs Update() from the control tick and passes dt in seconds,
+// so the loop rate is whatever the tick runs at. T is float on the ESP32
+// (hardware single precision), double works for host-side tuning tools.
+
+template <typename T = float>
+struct PidGains
+{
+    T kp{0};
+    T ki{0};
+    T kd{0};
+    // Setpoint passed straight to the output
+    T kff{0};
+    // Output is clamped to +-outputLimit, the integrator to +-integratorLimit
+    T outputLimit{0};
+    T integratorLimit{0};
+    // D-term first order low-pass, 0 disables it
+    T dTermCutoffHz{0};
+};
+
+// Contributions to the last output, before the output clamp
+template <typename T = float>
+struct PidTerms
+{
+    T p{0};
+    T i{0};
+    T d{0};
+    T ff{0};
+    T output{0};
+};
+
+template <typename T = float>
+class Pid
+{
+private:
+    PidGains<T> _gains;
+    T _integrator{0};
+    T _lastMeasurement{0};
+    T _dTerm{0};
+    PidTerms<T> _terms;
+    bool _primed{false};
+
+    static T Clamp(T value, T limit)
+    {
+        return value > limit ? limit : (value < -limit ? -limit : value);
+    }
+
+public:
+    Pid() = default;
+    explicit Pid(const PidGains<T> &gains) : _gains(gains) {}
+
+    void SetGains(const PidGains<T> &gains) { _gains = gains; }
+    const PidGains<T> &GetGains() const { return _gains; }
+
+    void Reset()
+    {
+        _integrator = 0;
+        _dTerm = 0;
+        _terms = PidTerms<T>();
+        _primed = false;
+    }
+
+    T Update(T setpoint, T measurement, T dt)
+    {
+        if (dt <= 0) dt = T(1e-3);
+        T error = setpoint - measurement;
+
+        // D on measurement, a setpoint step does not kick the output
+        T derivative = _primed ? -(measurement - _lastMeasurement) / dt : T(0);
+        _lastMeasurement = measurement;
+        _primed = true;
+        if (_gains.dTermCutoffHz > 0)
+        {
+            T rc = T(1) / (T(6.28318531) * _gains.dTermCutoffHz);
+            _dTerm += dt / (rc + dt) * (derivative - _dTerm);
+        }
+        else
+        {
+            _dTerm = derivative;
+        }
+
+        _terms.p = _gains.kp * error;
+        _terms.i = _integrator;
+        _terms.d = _gains.kd * _dTerm;
+        _terms.ff = _gains.kff * setpoint;
+        T unclamped = _terms.p + _terms.i + _terms.d + _terms.ff;
+        T output = Clamp(unclamped, _gains.outputLimit);
+        _terms.output = output;
+
+        // Anti-windup: stop integrating while the output is saturated in the
+        // direction the error pushes it
+        bool saturated = unclamped != output;
+        if (!saturated || (error > 0) != (unclamped > 0))
+        {
+            _integrator = Clamp(_integrator + _gains.ki * error * dt, _gains.integratorLimit);
+        }
+        return output;
+    }
+
+    T GetIntegrator() const { return _integrator; }
+    const PidTerms<T> &GetTerms() const { return _terms; }
+};
+
+// Outer angle loop feeding an inner rate loop. The angle loop output is
+// the rate setpoint, so its outputLimit is the highest commanded rate.
+template <typename T = float>
+class CascadedPid
+{
+private:
+    Pid<T> _angle;
+    Pid<T> _rate;
+    T _rateSetpoint{0};
+
+public:
+    CascadedPid() = default;
+    CascadedPid(const PidGains<T> &angleGains, const PidGains<T> &rateGains)
+        : _angle(angleGains), _rate(rateGains) {}
+
+    void Reset()
+    {
+        _angle.Reset();
+        _rate.Reset();
+        _rateSetpoint = 0;
+    }
+
+    T Update(T angleSetpoint, T angle, T rate, T dt)
+    {
+        _rateSetpoint = _angle.Update(angleSetpoint, angle, dt);
+        return _rate.Update(_rateSetpoint, rate, dt);
+    }
+
+    T GetRateSetpoint() const { return _rateSetpoint; }
+    const PidTerms<T> &GetRateTerms() const { return _rate.GetTerms(); }
+    Pid<T> &GetAngleLoop() { return _angle; }
+    Pid<T> &GetRateLoop() { return _rate; }
+};
+
+#endif
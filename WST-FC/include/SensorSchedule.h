@@ -0,0 +1,99 @@
+#ifndef SENSORSCHEDULE_H
+#define SENSORSCHEDULE_H
+
+#include <stdint.h>
+#include <esp_timer.h>
+#include "Configuration.h"
+
+// Rate, priority and budget gating shared by SensorsModule and the
+// compile-time Sensors<> (Vehicle.h)
+
+// Runs on every tick, never deferred by the budget (the IMU)
+#define SENSOR_PRIORITY_CRITICAL 255
+
+// Period of a sensor rate, 0 (every tick) at or above the control loop rate
+constexpr uint32_t SensorPeriodUs(float rateHz)
+{
+    return (rateHz <= 0.0f || rateHz >= CONTROL_LOOP_HZ) ? 0 : (uint32_t)(1000000.0f / rateHz);
+}
+
+struct SensorStats
+{
+    uint32_t runs{0};
+    // Runs that started a whole period or more after they were due
+    uint32_t missedDeadlines{0};
+    // Ticks a due sensor waited because the budget was spent
+    uint32_t deferred{0};
+    uint32_t lastExecUs{0};
+    uint32_t maxExecUs{0};
+    uint64_t execSumUs{0};
+};
+
+// One control tick, sensors are admitted highest priority first
+struct SensorTick
+{
+    int64_t startUs;
+    uint32_t budgetUs;
+    bool optionalRan{false};
+
+    SensorTick(int64_t start, uint32_t budget) : startUs(start), budgetUs(budget) {}
+};
+
+struct SensorSchedule
+{
+    // 0 - every tick
+    uint32_t periodUs{0};
+    uint8_t priority{0};
+    // Declared worst case, raised to the measured maximum
+    uint32_t costUs{0};
+    int64_t nextDueUs{0};
+    SensorStats stats;
+
+    SensorSchedule() {}
+    SensorSchedule(uint32_t period, uint8_t prio, uint32_t cost) : periodUs(period), priority(prio), costUs(cost) {}
+
+    // Periodic sensors start phaseUs apart, so slow sensors registered
+    // together do not all come due on the same tick
+    void Start(int64_t now, uint32_t &phaseUs)
+    {
+        if (periodUs == 0) return;
+        nextDueUs = now + phaseUs;
+        phaseUs += 1000000UL / CONTROL_LOOP_HZ;
+    }
+
+    // Due, and critical or its cost fits in what is left of the budget. A
+    // sensor costlier than the whole budget gets a tick of its own.
+    bool Admit(SensorTick &tick, int64_t now)
+    {
+        if (now < nextDueUs) return false;
+        if (priority != SENSOR_PRIORITY_CRITICAL && tick.optionalRan && (uint32_t)(now - tick.startUs) + costUs > tick.budgetUs)
+        {
+            stats.deferred++;
+            return false;
+        }
+        return true;
+    }
+
+    // After an admitted run from startUs to endUs
+    void Ran(SensorTick &tick, int64_t startUs, int64_t endUs)
+    {
+        uint32_t exec = (uint32_t)(endUs - startUs);
+        if (priority != SENSOR_PRIORITY_CRITICAL) tick.optionalRan = true;
+
+        stats.runs++;
+        stats.lastExecUs = exec;
+        stats.execSumUs += exec;
+        if (exec > stats.maxExecUs) stats.maxExecUs = exec;
+        if (exec > costUs) costUs = exec;
+
+        if (periodUs > 0)
+        {
+            int64_t late = startUs - nextDueUs;
+            if (late >= periodUs) stats.missedDeadlines += late / periodUs;
+            nextDueUs += periodUs;
+            if (nextDueUs <= startUs) nextDueUs = startUs + periodUs;
+        }
+    }
+};
+
+#endif
@@ -7,14 +7,25 @@ struct SensorsData
     int16_t pitch{0};
     int16_t roll{0};
 
+    // Body rates, decidegrees/s
+    int16_t gyroX{0};
+    int16_t gyroY{0};
+    int16_t gyroZ{0};
+
     int16_t linearAccelX{0};
     int16_t linearAccelY{0};
     int16_t linearAccelZ{0};
 
+    // Battery, centivolts / centiamps
     int16_t voltage{0};
+    int16_t current{0};
+    uint16_t consumedMah{0};
 
     uint16_t distanceSensors[6];
     int16_t other[5];
+
+    // Bidirectional DShot, 0 when not reported
+    uint16_t motorRpm[4];
 };
 #pragma pack(pop)
 #endif
\ No newline at end of file
@@ -2,22 +2,51 @@
 #define SENSORSMODULE_H
 
 #include <vector>
-#include <Wire.h>
 #include "DroneData.h"
 #include "SensorsData.h"
 #include "ISensor.h"
+#include "SeqLock.h"
+#include "SensorSchedule.h"
+#include "Configuration.h"
+
+struct ScheduledSensor
+{
+    ISensor *sensor{nullptr};
+    const char *name{nullptr};
+    SensorSchedule schedule;
+};
 
 class SensorsModule
 {
 private:
     SensorsData *sensorData;
-    std::vector<ISensor *> _sensors;
+    SeqLock<SensorsData> *sensorChannel;
+    // Highest priority first
+    std::vector<ScheduledSensor> _sensors;
+    uint32_t _budgetUs;
+    uint32_t _ticks{0};
+    uint32_t _overBudgetTicks{0};
+    int64_t _statsSinceUs{0};
 
 public:
-    SensorsModule(SensorsData *data);
-    void AddSensor(ISensor *sensor);
+    // data is the working copy owned by the control task, every Loop
+    // publishes it to channel for readers on other tasks
+    SensorsModule(SensorsData *data, SeqLock<SensorsData> *channel = nullptr, uint32_t budgetUs = SENSORS_TICK_BUDGET_US);
+
+    // rateHz at or above the tick rate runs every tick. Non-critical sensors
+    // run in priority order while their cost fits in what is left of the tick
+    // budget, a sensor costlier than the whole budget gets a tick of its own.
+    void AddSensor(ISensor *sensor, const char *name, float rateHz, uint8_t priority, uint32_t costUs);
     void Init();
     void Loop();
+
+    uint8_t GetSensorCount() const { return _sensors.size(); }
+    const char *GetSensorName(uint8_t index) const;
+    SensorStats GetStats(uint8_t index) const;
+    // Runs per second since the last ResetStats
+    float GetRate(uint8_t index) const;
+    void ResetStats();
+    void PrintStats(Print &out) const;
 };
 
-#endif
\ No newline at end of file
+#endif
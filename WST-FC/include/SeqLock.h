@@ -0,0 +1,81 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+#define SEQLOCK_MAX_RETRIES 8
+
+template <typename T>
+struct Snapshot
+{
+    T data{};
+    // Number of the published sample, 0 means nothing was published yet
+    uint32_t sequence{0};
+    uint32_t timestampUs{0};
+};
+
+// Single writer / multiple readers handoff without a mutex.
+// The writer never blocks. A reader retries while a write is in progress
+// and gives up after SEQLOCK_MAX_RETRIES, so a reader that preempted the
+// writer on the same core keeps its previous snapshot instead of spinning.
+template <typename T>
+class SeqLock
+{
+private:
+    std::atomic<uint32_t> _version{0};
+    Snapshot<T> _snapshot;
+
+public:
+    void Publish(const T &value, uint32_t timestampUs)
+    {
+        uint32_t version = _version.load(std::memory_order_relaxed);
+        _version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        memcpy(&_snapshot.data, &value, sizeof(T));
+        _snapshot.sequence++;
+        _snapshot.timestampUs = timestampUs;
+
+        _version.store(version + 2, std::memory_order_release);
+    }
+
+    // Copies the latest sample into out. Returns false if no consistent copy
+    // could be taken, out is left untouched in that case.
+    bool Read(Snapshot<T> &out) const
+    {
+        Snapshot<T> copy;
+        for (uint8_t i = 0; i < SEQLOCK_MAX_RETRIES; i++)
+        {
+            uint32_t before = _version.load(std::memory_order_acquire);
+            if (before & 1) continue;
+
+            memcpy(&copy, &_snapshot, sizeof(Snapshot<T>));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (_version.load(std::memory_order_relaxed) == before)
+            {
+                out = copy;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Like Read, but only succeeds when there is a sample newer than out
+    bool ReadIfNewer(Snapshot<T> &out) const
+    {
+        Snapshot<T> copy;
+        if (!Read(copy) || copy.sequence == out.sequence) return false;
+        out = copy;
+        return true;
+    }
+
+    uint32_t GetSequence() const
+    {
+        return _version.load(std::memory_order_acquire) >> 1;
+    }
+};
+
+#endif
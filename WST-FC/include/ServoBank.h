@@ -0,0 +1,104 @@
+#ifndef SERVOBANK_H
+#define SERVOBANK_H
+
+#include "IActuator.h"
+#include "Configuration.h"
+#include <soc/soc_caps.h>
+#if SOC_MCPWM_SUPPORTED
+    #include <driver/mcpwm.h>
+
+// 3 timers x 2 generators of one MCPWM unit
+#define SERVO_BANK_MAX_CHANNELS 6
+// Nominal center of a Set() command, the channel's own center replaces it
+#define SERVO_COMMAND_CENTER_US 1500.0f
+
+struct ServoChannelConfig
+{
+    int pin{-1};
+    // Added to every pulse, e.g. for a horn that sits a spline tooth off
+    float trimUs{0.0f};
+    // Endpoints, the output never leaves [minUs, maxUs]. 560 Hz servos use
+    // narrow pulses (760 us center), a 1000-2000 us range does not fit.
+    float minUs{1000.0f};
+    float centerUs{1500.0f};
+    float maxUs{2000.0f};
+    bool reversed{false};
+};
+
+// Servo outputs on one MCPWM unit at 50/200/333/560 Hz. Two channels share a
+// timer and the timers are synced to timer 0, so every channel's period
+// starts at the same moment. Compare registers are shadowed and latch at
+// that boundary: pulses staged by SetPulse() are written together by
+// Commit() and all change in the same frame. Commit() runs by itself once
+// every channel got a new value. Timer resolution is the finest that fits
+// the period, 0.3 us at 50 Hz down to 0.04 us at 560 Hz.
+class ServoBank
+{
+private:
+    mcpwm_unit_t _unit;
+    uint32_t _rateHz;
+    ServoChannelConfig _channels[SERVO_BANK_MAX_CHANNELS];
+    float _staged[SERVO_BANK_MAX_CHANNELS];
+    uint8_t _count{0};
+    uint8_t _pending{0};
+    bool _initiated{false};
+    uint32_t _commits{0};
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+
+    float Clamp(uint8_t channel, float pulseUs) const;
+
+public:
+    ServoBank(int unit = SERVO_MCPWM_UNIT, uint32_t rateHz = SERVO_RATE_HZ);
+
+    // Before Init(), returns the channel or -1 when the bank is full
+    int AddChannel(const ServoChannelConfig &config);
+    // Safe to call once per channel, only the first call sets the unit up
+    bool Init();
+
+    // Command in us around 1500, trim, direction and endpoints applied
+    void SetPulse(uint8_t channel, float commandUs);
+    // -1..1 mapped to min..center..max
+    void SetNormalized(uint8_t channel, float value);
+    // Writes the staged pulses, they latch at the next period boundary
+    void Commit();
+
+    float GetPulse(uint8_t channel) const { return channel < _count ? _staged[channel] : 0.0f; }
+    uint32_t GetRate() const { return _rateHz; }
+    uint32_t GetCommits() const { return _commits; }
+};
+
+// One ServoBank channel as an actuator, Set() takes microseconds like ServoMotor
+class BankServo final : public IActuator
+{
+private:
+    ServoBank *_bank;
+    int _channel;
+
+public:
+    BankServo(ServoBank *bank, const ServoChannelConfig &config) : _bank(bank), _channel(bank->AddChannel(config)) {}
+
+    BankServo(ServoBank *bank, int pin, float trimUs = 0.0f) : _bank(bank)
+    {
+        ServoChannelConfig config;
+        config.pin = pin;
+        config.trimUs = trimUs;
+        _channel = bank->AddChannel(config);
+    }
+
+    void Init() override
+    {
+        if (_channel < 0) Serial.println("Servo bank full!");
+        _bank->Init();
+    }
+
+    void Set(int16_t value) override
+    {
+        TRACE_SCOPE("BankServo::Set");
+        if (_channel >= 0) _bank->SetPulse(_channel, value);
+    }
+
+    void Loop() override {}
+};
+
+#endif
+#endif
@@ -5,7 +5,7 @@
 #include <Arduino.h>
 #include <ESP32Servo.h>
 
-class ServoMotor : public IActuator
+class ServoMotor final : public IActuator
 {
 private:
     Servo _servo;
@@ -35,6 +35,7 @@ public:
 
     void Set(int16_t value) override
     {
+        TRACE_SCOPE("ServoMotor::Set");
         int pulse = constrain(value, _minPulse, _maxPulse);
         _servo.writeMicroseconds(pulse);
     }
@@ -0,0 +1,66 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#define MAX_SCHEDULED_TASKS 6
+#define SCHEDULER_TASK_STACK 4096
+
+typedef void (*TaskCallback)(void *arg);
+
+struct TaskStats
+{
+    uint32_t runs{0};
+    // Runs that took longer than the task period
+    uint32_t overruns{0};
+    // Releases skipped because the previous run was still busy
+    uint32_t missedReleases{0};
+    uint32_t lastJitterUs{0};
+    uint32_t maxJitterUs{0};
+    uint32_t lastExecUs{0};
+    uint32_t maxExecUs{0};
+    uint64_t jitterSumUs{0};
+    uint64_t execSumUs{0};
+};
+
+struct ScheduledTask
+{
+    const char *name{nullptr};
+    TaskCallback callback{nullptr};
+    void *arg{nullptr};
+    uint32_t periodUs{0};
+    BaseType_t core{0};
+    UBaseType_t priority{1};
+
+    TaskHandle_t handle{nullptr};
+    esp_timer_handle_t timer{nullptr};
+    int64_t nextReleaseUs{0};
+    TaskStats stats;
+};
+
+// Runs core-pinned FreeRTOS tasks at a fixed rate.
+// Tasks are released by esp_timer, so the period is not bound to the RTOS tick.
+class TaskScheduler
+{
+private:
+    ScheduledTask _tasks[MAX_SCHEDULED_TASKS];
+    uint8_t _taskCount{0};
+    bool _started{false};
+
+    static void TimerCallback(void *arg);
+    static void TaskBody(void *arg);
+
+public:
+    // Returns task index or -1 when the table is full
+    int AddTask(const char *name, TaskCallback callback, void *arg, uint32_t rateHz, BaseType_t core, UBaseType_t priority);
+    void Start();
+
+    uint8_t GetTaskCount() const { return _taskCount; }
+    const char *GetTaskName(uint8_t index) const;
+    TaskStats GetStats(uint8_t index) const;
+    void ResetStats();
+    void PrintStats(Print &out) const;
+};
+
+#endif
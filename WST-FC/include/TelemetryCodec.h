@@ -0,0 +1,225 @@
+#ifndef TELEMETRYCODEC_H
+#define TELEMETRYCODEC_H
+
+// Compact telemetry: a sample is a row of 16 bit fields (SensorsData is one).
+// Keyframes carry every field. Delta frames carry, as zigzag varints, the
+// difference to the last keyframe of every field that moved since that
+// keyframe, even if it went back to its keyframe value. Each field has a
+// divider (its rate class): it is only looked at every divider-th frame, so
+// slow values like the battery cost nothing in between.
+//
+// Payload of a LINK_MSG_TELEMETRY_DELTA frame:
+//   keyframe: | kind=0 | counter | fields | value u16 x fields |
+//   delta:    | kind=1 | counter | fields | keyframe counter | changed bitmap | varint x changed |
+//
+// Deltas only depend on their keyframe, a lost delta costs that one sample
+// (a slow field, until its next due frame). After a lost keyframe the
+// decoder skips deltas until the next one. Plain C++, the ground station and host tools use the
+// same header.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TELEMETRY_MAX_FIELDS 64
+// Worst case payload, every field changed by more than 14 bits
+#define TELEMETRY_PAYLOAD_SIZE(fields) (4 + ((size_t)(fields) + 7) / 8 + 3 * (size_t)(fields))
+
+enum TelemetryFrameKind : uint8_t
+{
+    TELEMETRY_KEYFRAME = 0,
+    TELEMETRY_DELTA = 1,
+};
+
+inline size_t VarintWrite(uint8_t *out, uint32_t value)
+{
+    size_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+// Returns the bytes read, 0 if the varint runs past size
+inline size_t VarintRead(const uint8_t *in, size_t size, uint32_t &value)
+{
+    value = 0;
+    for (size_t i = 0; i < size && i < 5; i++)
+    {
+        value |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80)) return i + 1;
+    }
+    return 0;
+}
+
+inline uint32_t ZigZagEncode(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+inline int32_t ZigZagDecode(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+class TelemetryEncoder
+{
+private:
+    const uint8_t *_dividers;
+    uint8_t _fields;
+    uint16_t _keyframeInterval;
+    uint16_t _keyframe[TELEMETRY_MAX_FIELDS];
+    // Field was off its keyframe value since the keyframe
+    bool _moved[TELEMETRY_MAX_FIELDS];
+    uint8_t _counter{0};
+    uint8_t _keyframeCounter{0};
+    uint16_t _sinceKeyframe{0};
+    bool _keyframeDue{true};
+
+public:
+    // dividers: one per field, 1 - every frame, 0 is taken as 1
+    TelemetryEncoder(const uint8_t *dividers, uint8_t fields, uint16_t keyframeInterval)
+        : _dividers(dividers),
+          _fields(fields < TELEMETRY_MAX_FIELDS ? fields : TELEMETRY_MAX_FIELDS),
+          _keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1)
+    {
+        memset(_keyframe, 0, sizeof(_keyframe));
+        memset(_moved, 0, sizeof(_moved));
+    }
+
+    // Next frame is a keyframe, e.g. after the link dropped one
+    void ForceKeyframe() { _keyframeDue = true; }
+
+    // values: the fields of one sample. Returns the payload length, 0 if
+    // capacity is below TELEMETRY_PAYLOAD_SIZE(fields).
+    size_t Encode(const uint16_t *values, uint8_t *out, size_t capacity)
+    {
+        if (capacity < TELEMETRY_PAYLOAD_SIZE(_fields)) return 0;
+        _counter++;
+        out[1] = _counter;
+        out[2] = _fields;
+
+        if (_keyframeDue || ++_sinceKeyframe >= _keyframeInterval)
+        {
+            out[0] = TELEMETRY_KEYFRAME;
+            for (uint8_t i = 0; i < _fields; i++)
+            {
+                out[3 + 2 * i] = values[i] & 0xFF;
+                out[4 + 2 * i] = values[i] >> 8;
+            }
+            memcpy(_keyframe, values, _fields * sizeof(uint16_t));
+            memset(_moved, 0, sizeof(_moved));
+            _keyframeCounter = _counter;
+            _keyframeDue = false;
+            _sinceKeyframe = 0;
+            return 3 + 2 * _fields;
+        }
+
+        out[0] = TELEMETRY_DELTA;
+        out[3] = _keyframeCounter;
+        uint8_t *bitmap = out + 4;
+        size_t bitmapSize = (_fields + 7) / 8;
+        memset(bitmap, 0, bitmapSize);
+        size_t length = 4 + bitmapSize;
+        for (uint8_t i = 0; i < _fields; i++)
+        {
+            uint8_t divider = _dividers[i] > 0 ? _dividers[i] : 1;
+            if (_counter % divider != 0) continue;
+            // Sent in every due frame once it moved, so no delta depends on
+            // an earlier one
+            if (values[i] != _keyframe[i]) _moved[i] = true;
+            if (!_moved[i]) continue;
+            bitmap[i / 8] |= 1 << (i % 8);
+            length += VarintWrite(out + length, ZigZagEncode((int16_t)(values[i] - _keyframe[i])));
+        }
+        return length;
+    }
+};
+
+class TelemetryDecoder
+{
+private:
+    uint16_t _keyframe[TELEMETRY_MAX_FIELDS];
+    uint16_t _values[TELEMETRY_MAX_FIELDS];
+    uint8_t _fields{0};
+    uint8_t _keyframeCounter{0};
+    bool _synced{false};
+    uint32_t _keyframes{0};
+    uint32_t _deltas{0};
+    // Deltas of a keyframe that never arrived
+    uint32_t _skipped{0};
+    uint32_t _errors{0};
+
+    bool Fail()
+    {
+        _errors++;
+        return false;
+    }
+
+public:
+    // Returns true when GetValues() holds the sample of this frame. Frames
+    // are expected in order, drop late ones first (LinkSequencer).
+    bool Decode(const uint8_t *payload, size_t length)
+    {
+        if (length < 3 || payload[2] > TELEMETRY_MAX_FIELDS) return Fail();
+        uint8_t kind = payload[0];
+        uint8_t fields = payload[2];
+
+        if (kind == TELEMETRY_KEYFRAME)
+        {
+            if (length != 3 + 2u * fields) return Fail();
+            for (uint8_t i = 0; i < fields; i++)
+            {
+                _keyframe[i] = payload[3 + 2 * i] | (payload[4 + 2 * i] << 8);
+            }
+            memcpy(_values, _keyframe, fields * sizeof(uint16_t));
+            _fields = fields;
+            _keyframeCounter = payload[1];
+            _synced = true;
+            _keyframes++;
+            return true;
+        }
+        if (kind != TELEMETRY_DELTA || length < 4) return Fail();
+        if (!_synced || fields != _fields || payload[3] != _keyframeCounter)
+        {
+            _skipped++;
+            return false;
+        }
+
+        // Decoded aside first, a truncated frame must not half apply
+        uint16_t values[TELEMETRY_MAX_FIELDS];
+        memcpy(values, _values, fields * sizeof(uint16_t));
+        const uint8_t *bitmap = payload + 4;
+        size_t offset = 4 + (fields + 7) / 8;
+        if (offset > length) return Fail();
+        for (uint8_t i = 0; i < fields; i++)
+        {
+            if (!(bitmap[i / 8] & (1 << (i % 8)))) continue;
+            uint32_t encoded;
+            size_t read = VarintRead(payload + offset, length - offset, encoded);
+            if (read == 0) return Fail();
+            offset += read;
+            values[i] = _keyframe[i] + (uint16_t)ZigZagDecode(encoded);
+        }
+        if (offset != length) return Fail();
+        memcpy(_values, values, fields * sizeof(uint16_t));
+        _deltas++;
+        return true;
+    }
+
+    bool IsSynced() const { return _synced; }
+    uint8_t GetFieldCount() const { return _fields; }
+    const uint16_t *GetValues() const { return _values; }
+
+    // Copies the sample into a struct of 16 bit fields, false if the sizes differ
+    template <typename T>
+    bool Get(T &out) const
+    {
+        if (_fields * sizeof(uint16_t) != sizeof(T)) return false;
+        memcpy(&out, _values, sizeof(T));
+        return true;
+    }
+
+    uint32_t GetKeyframes() const { return _keyframes; }
+    uint32_t GetDeltas() const { return _deltas; }
+    uint32_t GetSkipped() const { return _skipped; }
+    uint32_t GetErrors() const { return _errors; }
+};
+
+#endif
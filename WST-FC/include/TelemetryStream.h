@@ -0,0 +1,52 @@
+#ifndef TELEMETRYSTREAM_H
+#define TELEMETRYSTREAM_H
+
+#include <Arduino.h>
+#include "Configuration.h"
+#include "SensorsData.h"
+#include "SeqLock.h"
+#include "TelemetryCodec.h"
+#include "LinkProtocol.h"
+#include "communicationModules/ICommunicationInterface.h"
+
+#define TELEMETRY_FIELDS (sizeof(SensorsData) / sizeof(uint16_t))
+
+struct TelemetryStreamStats
+{
+    uint32_t frames{0};
+    uint32_t keyframes{0};
+    uint32_t bytes{0};
+    // Frames the link did not take, a keyframe among them is resent
+    uint32_t failed{0};
+};
+
+// Streams SensorsData as keyframes + deltas (TelemetryCodec.h) in
+// LINK_MSG_TELEMETRY_DELTA frames. Runs in the comms task. The rate moves
+// between TELEMETRY_MIN_HZ and a ceiling set by the link quality: every
+// frame the link took adds TELEMETRY_RATE_STEP_HZ, every refused one halves
+// it. Field rate classes are in TelemetryStream.cpp.
+class TelemetryStream
+{
+private:
+    SeqLock<SensorsData> *_source;
+    ICommunicationInterface *_link{nullptr};
+    TelemetryEncoder _encoder;
+    Snapshot<SensorsData> _sample;
+    uint8_t _payload[TELEMETRY_PAYLOAD_SIZE(TELEMETRY_FIELDS)];
+    float _rateHz{TELEMETRY_MIN_HZ};
+    uint32_t _lastSendUs{0};
+    TelemetryStreamStats _stats;
+
+public:
+    explicit TelemetryStream(SeqLock<SensorsData> *source);
+
+    // The link exists only after CommunicationModule::Init()
+    void SetLink(ICommunicationInterface *link) { _link = link; }
+    void Loop();
+
+    float GetRate() const { return _rateHz; }
+    const TelemetryStreamStats &GetStats() const { return _stats; }
+    void PrintStats(Print &out) const;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "Configuration.h"
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#if USE_TRACE
+
+struct TraceEvent
+{
+    // Must point to a string literal, only the pointer is stored
+    const char *name;
+    uint32_t startCycles;
+    uint32_t durationCycles;
+    uint8_t core;
+};
+
+// Lock-free ring of spans shared by both cores. Old events are overwritten.
+// Dump format (one event per line, cycles of the core that recorded it):
+//   #TRACE cpu_mhz=<mhz> events=<count>
+//   <name>,<core>,<startCycles>,<durationCycles>
+class Tracer
+{
+private:
+    static TraceEvent _events[TRACE_BUFFER_SIZE];
+    static volatile uint32_t _head;
+
+public:
+    static inline void Record(const char *name, uint32_t startCycles, uint32_t durationCycles)
+    {
+        uint32_t index = __atomic_fetch_add(&_head, 1, __ATOMIC_RELAXED) % TRACE_BUFFER_SIZE;
+        TraceEvent &event = _events[index];
+        event.name = name;
+        event.startCycles = startCycles;
+        event.durationCycles = durationCycles;
+        event.core = (uint8_t)xPortGetCoreID();
+    }
+
+    static uint16_t GetEventCount();
+    // Prints count events starting at first (0 = oldest still in the buffer)
+    static void Dump(Print &out, uint16_t first = 0, uint16_t count = TRACE_BUFFER_SIZE);
+    // Per-span count/min/avg/p99/max in microseconds
+    static void PrintStats(Print &out);
+    static void Clear();
+};
+
+class TraceSpan
+{
+private:
+    const char *_name;
+    uint32_t _start;
+
+public:
+    inline explicit TraceSpan(const char *name) : _name(name), _start(ESP.getCycleCount()) {}
+    inline ~TraceSpan() { Tracer::Record(_name, _start, ESP.getCycleCount() - _start); }
+};
+
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(_traceSpan, __LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+
+#endif
+
+#endif
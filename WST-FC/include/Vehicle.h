@@ -0,0 +1,144 @@
+#ifndef VEHICLE_H
+#define VEHICLE_H
+
+#include <tuple>
+#include "DroneData.h"
+#include "SensorsData.h"
+#include "SensorSchedule.h"
+#include "Trace.h"
+
+// Compile-time counterpart of SensorsModule/IMixer/CommunicationModule.
+// Components are concrete final types living in static storage, so every
+// call in the sensor -> mixer -> actuator chain is resolved at compile time.
+//
+//   Vehicle<Sensors<SensorSlot<MpuSensor>>, BicopterMixer<ESCActuator, ServoMotor>, Link<CommunicationWiFiUDPModule>>
+
+// A sensor of Sensors<> with what SensorsModule::AddSensor takes. The
+// defaults run it on every tick (the IMU), the DHT has no throttle of its own
+// and needs a period:
+//   SensorSlot<DHT11Sensor, SensorPeriodUs(DHT_RATE_HZ), 10, 50>
+template <typename TSensor, uint32_t PeriodUs = 0, uint8_t Priority = SENSOR_PRIORITY_CRITICAL, uint32_t CostUs = 0>
+class SensorSlot
+{
+private:
+    TSensor *_sensor;
+    SensorSchedule _schedule;
+
+public:
+    using Sensor = TSensor;
+    static constexpr uint8_t PRIORITY = Priority;
+    // Nothing to gate, skips the timestamps
+    static constexpr bool EVERY_TICK = PeriodUs == 0 && Priority == SENSOR_PRIORITY_CRITICAL;
+
+    explicit SensorSlot(TSensor *sensor) : _sensor(sensor), _schedule(PeriodUs, Priority, CostUs) {}
+
+    void Init() { _sensor->Init(); }
+    void Start(int64_t now, uint32_t &phaseUs) { _schedule.Start(now, phaseUs); }
+
+    inline void Update(SensorTick &tick, SensorsData *data)
+    {
+        if constexpr (EVERY_TICK)
+        {
+            _sensor->Update(data);
+        }
+        else
+        {
+            int64_t now = esp_timer_get_time();
+            if (!_schedule.Admit(tick, now)) return;
+            _sensor->Update(data);
+            _schedule.Ran(tick, now, esp_timer_get_time());
+        }
+    }
+
+    const SensorStats &GetStats() const { return _schedule.stats; }
+};
+
+template <typename... TSlots>
+constexpr bool SlotsByPriority()
+{
+    const uint8_t priorities[] = {TSlots::PRIORITY..., 0};
+    for (size_t i = 1; i < sizeof...(TSlots); i++)
+    {
+        if (priorities[i] > priorities[i - 1]) return false;
+    }
+    return true;
+}
+
+// SensorsModule's rate, priority and budget gating over SensorSlots, in the
+// order they are listed
+template <typename... TSlots>
+class Sensors
+{
+private:
+    static_assert(SlotsByPriority<TSlots...>(), "list sensor slots highest priority first");
+    static constexpr bool GATED = (!TSlots::EVERY_TICK || ...);
+
+    std::tuple<TSlots...> _slots;
+
+public:
+    explicit Sensors(typename TSlots::Sensor *... sensors) : _slots(TSlots(sensors)...) {}
+
+    void Init()
+    {
+        std::apply([](auto &... slot) { (slot.Init(), ...); }, _slots);
+        int64_t now = esp_timer_get_time();
+        uint32_t phase = 0;
+        std::apply([now, &phase](auto &... slot) { (slot.Start(now, phase), ...); }, _slots);
+    }
+
+    void Update(SensorsData *data)
+    {
+        SensorTick tick(GATED ? esp_timer_get_time() : 0, SENSORS_TICK_BUDGET_US);
+        std::apply([&tick, data](auto &... slot) { (slot.Update(tick, data), ...); }, _slots);
+    }
+};
+
+template <typename TInterface>
+class Link
+{
+private:
+    TInterface *_interface;
+
+public:
+    explicit Link(TInterface *interface) : _interface(interface) {}
+
+    void Init() { _interface->Init(); }
+    void Loop() { _interface->Loop(); }
+    void SendData(SensorsData *data) { _interface->SendData(data); }
+    TInterface *GetInterface() { return _interface; }
+};
+
+template <typename TSensors, typename TMixer, typename TLink>
+class Vehicle
+{
+private:
+    TSensors &_sensors;
+    TMixer &_mixer;
+    TLink &_link;
+
+public:
+    Vehicle(TSensors &sensors, TMixer &mixer, TLink &link)
+        : _sensors(sensors), _mixer(mixer), _link(link) {}
+
+    void Init()
+    {
+        _link.Init();
+        _sensors.Init();
+        _mixer.Init();
+    }
+
+    // Control task: sensors -> mixer -> actuators
+    inline void ControlTick(DroneControlData *input, SensorsData *data)
+    {
+        TRACE_SCOPE("Vehicle::ControlTick");
+        _sensors.Update(data);
+        _mixer.Update(input, data);
+    }
+
+    inline void CommsTick() { _link.Loop(); }
+    inline void SendTelemetry(SensorsData *data) { _link.SendData(data); }
+
+    TMixer &GetMixer() { return _mixer; }
+};
+
+#endif
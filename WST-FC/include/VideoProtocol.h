@@ -0,0 +1,207 @@
+#ifndef VIDEOPROTOCOL_H
+#define VIDEOPROTOCOL_H
+
+// Camera frames over UDP, shared by the vehicle (CameraModule.h), the
+// ground station viewer and tools/video_receiver.cpp. Plain C++, builds on
+// the host as well.
+//
+// A viewer sends VideoSubscribe to VIDEO_PORT every
+// VIDEO_SUBSCRIBE_INTERVAL_MS and the vehicle answers each one with
+// VideoSync. While subscribed it gets every JPEG it is sent as datagrams of
+//   | VideoFragmentHeader | up to VIDEO_CHUNK bytes of the JPEG |
+// Nothing is retransmitted: a frame with a missing fragment is dropped as
+// soon as a fragment of a newer frame arrives. The UDP checksum covers the
+// datagrams, there is no CRC of our own. Little endian.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define VIDEO_MAGIC 0x56 // 'V'
+#define VIDEO_VERSION 1
+#define VIDEO_PORT 4211
+// Fits the WiFi MTU with IP and UDP headers, no IP fragmentation
+#define VIDEO_DATAGRAM_SIZE 1400
+#define VIDEO_MAX_FRAME_SIZE (128 * 1024)
+#define VIDEO_SUBSCRIBE_INTERVAL_MS 1000
+// Missed subscribes before the vehicle stops sending
+#define VIDEO_SUBSCRIBE_TIMEOUT_MS 3000
+
+enum VideoMessageType : uint8_t
+{
+    VIDEO_MSG_FRAGMENT = 1,
+    VIDEO_MSG_SUBSCRIBE = 2,
+    VIDEO_MSG_SYNC = 3,
+};
+
+#pragma pack(push, 1)
+struct VideoFragmentHeader
+{
+    uint8_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t reserved;
+    // Counts every captured frame, gaps are frames this viewer was not sent
+    uint32_t frameId;
+    // End of the capture, vehicle clock (esp_timer, low 32 bits)
+    uint32_t captureUs;
+    uint32_t frameSize;
+    uint32_t offset;
+};
+
+// Viewer to vehicle, starts or keeps up a subscription
+struct VideoSubscribe
+{
+    uint8_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t reserved;
+    // Viewer clock, echoed in VideoSync
+    uint32_t viewerUs;
+    // Totals since the viewer started, the vehicle adapts to the loss
+    uint32_t framesComplete;
+    uint32_t framesIncomplete;
+};
+
+// Vehicle to viewer, answers a subscribe. With the round trip the viewer
+// maps captureUs to its own clock (offset = vehicleUs - (sent + rtt / 2)).
+struct VideoSync
+{
+    uint8_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t viewerUs;
+    uint32_t vehicleUs;
+};
+#pragma pack(pop)
+
+#define VIDEO_CHUNK (VIDEO_DATAGRAM_SIZE - sizeof(VideoFragmentHeader))
+#define VIDEO_MAX_FRAGMENTS ((VIDEO_MAX_FRAME_SIZE + VIDEO_CHUNK - 1) / VIDEO_CHUNK)
+
+// Type of a received datagram, 0 if it is not one of ours
+inline uint8_t VideoMessageTypeOf(const uint8_t *data, size_t size)
+{
+    if (size < 4 || data[0] != VIDEO_MAGIC || data[1] != VIDEO_VERSION) return 0;
+    return data[2];
+}
+
+template <typename T>
+inline void VideoFillHeader(T &message, uint8_t type)
+{
+    memset(&message, 0, sizeof(T));
+    message.magic = VIDEO_MAGIC;
+    message.version = VIDEO_VERSION;
+    message.type = type;
+}
+
+// Writes fragment number index of a frame into out (VIDEO_DATAGRAM_SIZE
+// bytes). Returns the datagram size, 0 past the last fragment.
+inline size_t VideoEncodeFragment(uint8_t *out, uint32_t frameId, uint32_t captureUs, const uint8_t *data, uint32_t size, uint32_t index)
+{
+    uint32_t offset = index * VIDEO_CHUNK;
+    if (offset >= size) return 0;
+    uint32_t chunk = size - offset < VIDEO_CHUNK ? size - offset : VIDEO_CHUNK;
+
+    VideoFragmentHeader header;
+    VideoFillHeader(header, VIDEO_MSG_FRAGMENT);
+    header.frameId = frameId;
+    header.captureUs = captureUs;
+    header.frameSize = size;
+    header.offset = offset;
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), data + offset, chunk);
+    return sizeof(header) + chunk;
+}
+
+struct VideoReceiverStats
+{
+    uint32_t complete{0};
+    // Dropped with fragments missing
+    uint32_t incomplete{0};
+    // Frame ids never seen, sender side drops and frames lost whole
+    uint32_t skipped{0};
+    // Fragments of a frame already given up or finished
+    uint32_t late{0};
+    uint32_t malformed{0};
+};
+
+// Rebuilds one frame at a time. A fragment of a newer frame abandons the
+// frame in progress, fragments are never waited for.
+template <size_t Capacity>
+class VideoReassembler
+{
+private:
+    static constexpr size_t FRAGMENTS = (Capacity + VIDEO_CHUNK - 1) / VIDEO_CHUNK;
+
+    uint8_t _buffer[Capacity];
+    uint32_t _received[(FRAGMENTS + 31) / 32];
+    uint32_t _frameId{0};
+    uint32_t _captureUs{0};
+    uint32_t _size{0};
+    uint32_t _missing{0};
+    bool _active{false};
+    bool _started{false};
+    VideoReceiverStats _stats;
+
+public:
+    // Returns the frame size once its last fragment arrived, 0 otherwise
+    size_t Push(const uint8_t *data, size_t size)
+    {
+        VideoFragmentHeader header;
+        if (VideoMessageTypeOf(data, size) != VIDEO_MSG_FRAGMENT || size <= sizeof(header))
+        {
+            _stats.malformed++;
+            return 0;
+        }
+        memcpy(&header, data, sizeof(header));
+        size_t chunk = size - sizeof(header);
+        if (header.frameSize > Capacity || header.offset % VIDEO_CHUNK != 0 || header.offset + chunk > header.frameSize ||
+            (chunk != VIDEO_CHUNK && header.offset + chunk != header.frameSize))
+        {
+            _stats.malformed++;
+            return 0;
+        }
+
+        int32_t age = (int32_t)(header.frameId - _frameId);
+        if (_started && (age < 0 || (age == 0 && !_active)))
+        {
+            _stats.late++;
+            return 0;
+        }
+        if (!_started || age > 0)
+        {
+            if (_active) _stats.incomplete++;
+            if (_started && age > 1) _stats.skipped += age - 1;
+            _started = true;
+            _active = true;
+            _frameId = header.frameId;
+            _captureUs = header.captureUs;
+            _size = header.frameSize;
+            _missing = (header.frameSize + VIDEO_CHUNK - 1) / VIDEO_CHUNK;
+            memset(_received, 0, sizeof(_received));
+        }
+        else if (header.frameSize != _size)
+        {
+            _stats.malformed++;
+            return 0;
+        }
+
+        uint32_t index = header.offset / VIDEO_CHUNK;
+        uint32_t bit = 1UL << (index % 32);
+        if (_received[index / 32] & bit) return 0;
+        _received[index / 32] |= bit;
+        memcpy(_buffer + header.offset, data + sizeof(header), chunk);
+        if (--_missing > 0) return 0;
+        _active = false;
+        _stats.complete++;
+        return _size;
+    }
+
+    const uint8_t *GetFrame() const { return _buffer; }
+    uint32_t GetFrameId() const { return _frameId; }
+    uint32_t GetCaptureUs() const { return _captureUs; }
+    const VideoReceiverStats &GetStats() const { return _stats; }
+};
+
+#endif
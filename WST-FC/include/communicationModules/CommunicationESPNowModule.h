@@ -2,28 +2,94 @@
 #define COMMUNICATIONESPNOWMODULE_H
 
 #include <WiFi.h>
+#include <atomic>
 #include "DroneData.h"
+#include "SensorsData.h"
+#include "SeqLock.h"
 #include "Configuration.h"
 #include "ICommunicationInterface.h"
+#include "LinkProtocol.h"
 #include <esp_now.h>
 
+// Telemetry bytes per fragment when SensorsData outgrows one ESP-NOW frame
+#define ESPNOW_FRAGMENT_CHUNK (ESP_NOW_MAX_DATA_LEN - LINK_FRAGMENT_FRAME_SIZE(0))
 
-class CommunicationESPNowModule : public ICommunicationInterface{
+struct ESPNowLinkStats
+{
+    uint32_t telemetrySent{0};
+    uint32_t fragmentsSent{0};
+    // esp_now_send() refused the frame
+    uint32_t sendErrors{0};
+    // No send callback within ESPNOW_SEND_TIMEOUT_MS
+    uint32_t timeouts{0};
+};
+
+// Control from the peer, telemetry back to it. One frame is in the air at a
+// time: the next telemetry frame waits for the send callback of the
+// previous one, so frames are never queued faster than the radio delivers
+// them. Telemetry larger than a frame goes out as LINK_MSG_FRAGMENT pieces.
+// The telemetry rate follows delivery (AIMD): every delivered sample adds
+// ESPNOW_TELEMETRY_STEP_HZ, a failed frame halves it, which leaves airtime
+// to the control uplink when the channel gets busy.
+class CommunicationESPNowModule final : public ICommunicationInterface{
     private:
     static CommunicationESPNowModule* instance;
-    DroneControlData *sharedData;
-    unsigned long lastUpdate{0};
+    SeqLock<DroneControlData> *sharedData;
+    SeqLock<SensorsData> *telemetryData;
     DroneStatus *droneStatus;
     ulong lastDataTime = 0;
     uint8_t broadcastAddress[6] {0xEC,0x64,0xC9,0xC4,0xA2,0x1A};
+    // Written only from the WiFi task receive callback
+    LinkSequencer sequencer;
+    uint16_t txSequence{0};
+
+    // Send callback -> comms task. Callbacks come in send order, the n-th
+    // callback answers send generation n.
+    std::atomic<uint32_t> sendGeneration{0};
+    std::atomic<uint32_t> callbackGeneration{0};
+    // Sends up to here are counted, by their callback or by the timeout. A
+    // callback arriving after its send timed out is not counted again.
+    std::atomic<uint32_t> settledGeneration{0};
+    std::atomic<uint32_t> delivered{0};
+    std::atomic<uint32_t> failed{0};
+    uint32_t seenDelivered{0};
+    uint32_t seenFailed{0};
+    uint32_t sendStartMs{0};
+
+    // Sample being sent and how far it got
+    Snapshot<SensorsData> telemetry;
+    bool telemetryPending{false};
+    uint16_t telemetryMessage{0};
+    uint16_t nextFragment{0};
+    uint32_t lastTelemetryUs{0};
+    float telemetryRateHz{ESPNOW_TELEMETRY_MAX_HZ};
+    // Share of frames acknowledged, smoothed
+    float deliveryRatio{1.0f};
+    ESPNowLinkStats stats;
+
+    bool InFlight();
+    bool Send(const uint8_t *frame, size_t size);
+    void SendTelemetry();
+    void AdaptRate();
     public:
-    CommunicationESPNowModule(DroneControlData *dataPtr, DroneStatus *status);
+    // telemetry: streamed at the adaptive rate when set, SendData() then only
+    // matters without it
+    CommunicationESPNowModule(SeqLock<DroneControlData> *dataPtr, DroneStatus *status, SeqLock<SensorsData> *telemetry = nullptr);
     
     void Init() override;
     void Loop() override;
     void SendData(SensorsData* data) override;
     void SendData(DroneControlData* data);
+    void PrintStats(Print &out) override;
+    // Refused while a frame is in flight, the caller backs off
+    bool SendFrame(uint8_t type, const void *payload, uint16_t length) override;
+    // Smoothed share of acknowledged frames
+    uint8_t GetLinkQuality() override { return 100.0f * deliveryRatio; }
     static void OnDataReceived(const uint8_t *mac, const uint8_t *incomingData, int len);
+    static void OnDataSent(const uint8_t *mac, esp_now_send_status_t status);
+
+    float GetTelemetryRate() const { return telemetryRateHz; }
+    const ESPNowLinkStats &GetStats() const { return stats; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,21 +2,22 @@
 #define COMMUNICATIONGAMEPADMODULE_H
 
 #include "DroneData.h"
+#include "SeqLock.h"
 #include "ICommunicationInterface.h"
 #include "Configuration.h"
 #include <Bluepad32.h>
 
 
-class CommunicationGamepadModule : public ICommunicationInterface {
+class CommunicationGamepadModule final : public ICommunicationInterface {
     private:
-        DroneControlData *sharedData;
+        SeqLock<DroneControlData> *sharedData;
         DroneStatus *droneStatus;
         GamepadPtr myGamepad = nullptr;
 
     public:
         static CommunicationGamepadModule* instance;
 
-        CommunicationGamepadModule(DroneControlData *dataPtr, DroneStatus *status);
+        CommunicationGamepadModule(SeqLock<DroneControlData> *dataPtr, DroneStatus *status);
         
         void Init() override;
         void Loop() override;
@@ -21,6 +21,16 @@ class CommunicationRouter:public ICommunicationInterface{
     void SendData(DroneControlData* data)override{
         communicationInterfaceOne->SendData(data);
     }
+    bool SendFrame(uint8_t type, const void *payload, uint16_t length)override{
+        return communicationInterfaceTwo->SendFrame(type, payload, length);
+    }
+    uint8_t GetLinkQuality()override{
+        return communicationInterfaceTwo->GetLinkQuality();
+    }
+    void PrintStats(Print &out)override{
+        if(communicationInterfaceOne != nullptr) communicationInterfaceOne->PrintStats(out);
+        if(communicationInterfaceTwo != nullptr) communicationInterfaceTwo->PrintStats(out);
+    }
 };
 
 #endif
\ No newline at end of file
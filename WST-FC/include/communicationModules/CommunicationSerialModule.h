@@ -3,23 +3,63 @@
 
 #include <Arduino.h>
 #include "DroneData.h"
+#include "SensorsData.h"
+#include "SeqLock.h"
 #include "Configuration.h"
 #include "ICommunicationInterface.h"
+#include "LinkProtocol.h"
+#include "Cobs.h"
+#include "TelemetryCodec.h"
 
-class CommunicationSerialModule : public ICommunicationInterface{
+// Largest link frame the serial module handles, a full telemetry stream frame
+#define SERIAL_LINK_MAX_FRAME (LINK_OVERHEAD + TELEMETRY_PAYLOAD_SIZE(sizeof(SensorsData) / 2))
+
+struct SerialLinkStats
+{
+    uint32_t rxBytes{0};
+    uint32_t txBytes{0};
+    uint32_t txFrames{0};
+    // Frames skipped because the TX buffer had no room for them
+    uint32_t txDropped{0};
+    // Decoded frames that are not a link control frame
+    uint32_t rejected{0};
+};
+
+// Link frames (LinkProtocol.h) COBS framed over a UART, e.g. to a companion
+// computer. The UART driver fills its RX ring from the interrupt; Loop()
+// drains whatever arrived without waiting and feeds it to a streaming COBS
+// decoder, which resyncs at the next 0x00 after any corrupted byte. Sends
+// go to the driver's TX ring and are skipped rather than blocking when it
+// is full. Given the sensors channel, telemetry streams back at
+// SERIAL_TELEMETRY_HZ.
+class CommunicationSerialModule final : public ICommunicationInterface{
     private:
-        DroneControlData *sharedData;
+        SeqLock<DroneControlData> *sharedData;
+        SeqLock<SensorsData> *telemetryData;
+        HardwareSerial *port{nullptr};
         unsigned long lastUpdate{0};
         DroneStatus *droneStatus;
-        long lastDataTime = 0;
-        uint8_t inputBuffer[sizeof(DroneControlData)];
 
-        const uint8_t HEADER_BYTE_1 = 0x44; // 'D'
-        const uint8_t HEADER_BYTE_2 = 0x43; // 'C'
+        CobsDecoder<SERIAL_LINK_MAX_FRAME> decoder;
+        LinkSequencer sequencer;
+        SerialLinkStats stats;
+        uint8_t readBuffer[64];
+        uint8_t frameBuffer[SERIAL_LINK_MAX_FRAME];
+        uint8_t encodedBuffer[COBS_ENCODED_SIZE(SERIAL_LINK_MAX_FRAME)];
+        uint16_t txSequence{0};
+        uint32_t lastTelemetryUs{0};
+        Snapshot<SensorsData> telemetry;
+
+        void HandleFrame(const uint8_t *data, size_t length);
     public:
-    CommunicationSerialModule(DroneControlData *dataPtr, DroneStatus *status);
+    // telemetry: streamed at SERIAL_TELEMETRY_HZ when set, SendData() is then ignored
+    CommunicationSerialModule(SeqLock<DroneControlData> *dataPtr, DroneStatus *status, SeqLock<SensorsData> *telemetry = nullptr);
     void Init() override;
     void Loop() override;
     void SendData(SensorsData* data) override;
+    void PrintStats(Print &out) override;
+    bool SendFrame(uint8_t type, const void *payload, uint16_t length) override;
+
+    const SerialLinkStats &GetStats() const { return stats; }
 };
-#endif
\ No newline at end of file
+#endif
@@ -4,17 +4,43 @@
 #include <WiFi.h>
 #include <WiFiUdp.h>
 #include "DroneData.h"
+#include "SeqLock.h"
 #include "ICommunicationInterface.h"
 #include "Configuration.h"
+#include "LinkProtocol.h"
 #ifdef USE_WIREGUARD
     #include <WireGuard-ESP32.h>
 #endif
-class CommunicationWiFiUDPModule : public ICommunicationInterface{
+
+struct UdpReceiveStats
+{
+    // Times the receive task woke up with datagrams waiting
+    uint32_t drains{0};
+    uint32_t datagrams{0};
+    // Datagrams found per wake-up, 1 means nothing had queued up
+    uint32_t maxDepth{0};
+    // Valid control frames replaced by a newer one in the same drain
+    uint32_t superseded{0};
+    // Longest gap between two control frames
+    uint32_t maxGapUs{0};
+    uint32_t lastReceiveUs{0};
+};
+
+// Control from the ground station, telemetry back to the last sender.
+// UDP_RECEIVE_TASK 1: a task of its own blocks on a raw lwIP socket and,
+// once woken, drains every queued datagram without waiting. Only the newest
+// valid control frame is published, stamped with its receive time, so a
+// backlog costs one frame of latency instead of piling up.
+// UDP_RECEIVE_TASK 0: Loop() takes one datagram per call through WiFiUDP.
+class CommunicationWiFiUDPModule final : public ICommunicationInterface{
     private:
-    DroneControlData *sharedData;
+    SeqLock<DroneControlData> *sharedData;
     WiFiUDP udp;
     unsigned int localPort{0};
-    char packetBuffer[255];
+    uint8_t packetBuffer[255];
+    uint8_t sendBuffer[LINK_OVERHEAD + 255];
+    LinkSequencer sequencer;
+    uint16_t txSequence{0};
 
     unsigned long lastUpdate{0};
     int8_t rssi{0};
@@ -24,6 +50,20 @@ class CommunicationWiFiUDPModule : public ICommunicationInterface{
     IPAddress remoteIP;
     unsigned int remotePort {0};
 
+    #if UDP_RECEIVE_TASK
+        int sock{-1};
+        TaskHandle_t receiveTask{nullptr};
+        // Guards remoteIP/remotePort, written by the receive task
+        portMUX_TYPE remoteMux = portMUX_INITIALIZER_UNLOCKED;
+        UdpReceiveStats rxStats;
+        uint64_t depthSum{0};
+        volatile bool traceRequested{false};
+
+        static void TaskBody(void *arg);
+        void Drain();
+        bool SendPacket(const uint8_t *data, size_t length);
+    #endif
+
     #ifdef USE_WIREGUARD
         WireGuard wg;
         unsigned long lastKeepaliveTime = 0;
@@ -31,11 +71,23 @@ class CommunicationWiFiUDPModule : public ICommunicationInterface{
         const uint8_t KEEPALIVE_BYTE = 0xFF;
     #endif
 
+    #if USE_TRACE
+        void SendTrace(IPAddress ip, uint16_t port);
+    #endif
+
     public:
-    CommunicationWiFiUDPModule(DroneControlData *dataPtr, unsigned int port, DroneStatus *status);
+    CommunicationWiFiUDPModule(SeqLock<DroneControlData> *dataPtr, unsigned int port, DroneStatus *status);
 
     void Init() override;
     void Loop() override;
     void SendData(SensorsData* data) override;
+    void PrintStats(Print &out) override;
+    bool SendFrame(uint8_t type, const void *payload, uint16_t length) override;
+    // Signal strength, MIN_RSSI and below is 0
+    uint8_t GetLinkQuality() override;
+
+    #if UDP_RECEIVE_TASK
+        const UdpReceiveStats &GetReceiveStats() const { return rxStats; }
+    #endif
 };
 #endif
\ No newline at end of file
@@ -2,11 +2,19 @@
 #define ICOMMUNICATIONINTERFACE
 
 #include "../SensorsData.h"
+#include "../Trace.h"
 class ICommunicationInterface{
 public:
     virtual ~ICommunicationInterface(){}
     virtual void Init();
     virtual void Loop();
     virtual void SendData(SensorsData* data);
+    // Per-link frame stats, links without framing print nothing
+    virtual void PrintStats(Print &out) {}
+    // One link frame (LinkProtocol.h) with the link's own sequence. False if it
+    // was not handed to the link: no peer yet, buffers full, or no framing.
+    virtual bool SendFrame(uint8_t type, const void *payload, uint16_t length) { return false; }
+    // 0-100, how much the link can take right now (signal, delivery ratio)
+    virtual uint8_t GetLinkQuality() { return 100; }
 };
 #endif 
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef COMPLEMENTARYFILTER_H
+#define COMPLEMENTARYFILTER_H
+
+#include "IAttitudeEstimator.h"
+#include "../FastMath.h"
+
+// Euler angle complementary filter MpuSensor used before the quaternion estimators
+class ComplementaryFilter final : public IAttitudeEstimator
+{
+private:
+    float _pitch{0};
+    float _roll{0};
+    float _gyroWeight;
+
+public:
+    explicit ComplementaryFilter(float gyroWeight = 0.96f) : _gyroWeight(gyroWeight) {}
+
+    void Reset(float ax, float ay, float az) override
+    {
+        _pitch = FastAtan2(ay, az) * FAST_RAD_TO_DEG;
+        _roll = FastAtan2(-ax, az) * FAST_RAD_TO_DEG;
+    }
+
+    void Update(float gx, float gy, float /*gz*/, float ax, float ay, float az, float dt) override
+    {
+        float accelPitch = FastAtan2(ay, az) * FAST_RAD_TO_DEG;
+        float accelRoll = FastAtan2(-ax, az) * FAST_RAD_TO_DEG;
+
+        _pitch = _gyroWeight * (_pitch + gx * FAST_RAD_TO_DEG * dt) + (1.0f - _gyroWeight) * accelPitch;
+        _roll = _gyroWeight * (_roll + gy * FAST_RAD_TO_DEG * dt) + (1.0f - _gyroWeight) * accelRoll;
+    }
+
+    float GetPitch() const override { return _pitch; }
+    float GetRoll() const override { return _roll; }
+
+    void GetGravity(float gravity[3]) const override
+    {
+        float radPitch = _pitch * FAST_DEG_TO_RAD;
+        float radRoll = _roll * FAST_DEG_TO_RAD;
+        float cosRoll = FastCos(radRoll);
+        gravity[0] = -FastSin(radRoll);
+        gravity[1] = cosRoll * FastSin(radPitch);
+        gravity[2] = cosRoll * FastCos(radPitch);
+    }
+};
+
+#endif
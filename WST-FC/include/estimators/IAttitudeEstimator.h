@@ -0,0 +1,20 @@
+#ifndef IATTITUDEESTIMATOR_H
+#define IATTITUDEESTIMATOR_H
+
+// Angles follow SensorsData: pitch is the rotation about the sensor X axis,
+// roll about the sensor Y axis, both in degrees.
+// Gyro in rad/s, accel in any consistent unit (only its direction is used).
+class IAttitudeEstimator
+{
+public:
+    virtual ~IAttitudeEstimator() {}
+    // Aligns the estimate with gravity, call with the sensor at rest
+    virtual void Reset(float ax, float ay, float az) = 0;
+    virtual void Update(float gx, float gy, float gz, float ax, float ay, float az, float dt) = 0;
+    virtual float GetPitch() const = 0;
+    virtual float GetRoll() const = 0;
+    // Unit gravity vector in the sensor frame
+    virtual void GetGravity(float gravity[3]) const = 0;
+};
+
+#endif
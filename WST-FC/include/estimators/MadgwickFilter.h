@@ -0,0 +1,80 @@
+#ifndef MADGWICKFILTER_H
+#define MADGWICKFILTER_H
+
+#include "QuaternionEstimator.h"
+
+// Madgwick gradient descent IMU filter with gyro bias drift compensation
+// (S. Madgwick, "An efficient orientation filter for inertial and
+// inertial/magnetic sensor arrays", 2010).
+class MadgwickFilter final : public QuaternionEstimator
+{
+private:
+    // Accelerometer correction gain
+    float _beta;
+    // Gyro bias learning gain, 0 disables bias estimation
+    float _zeta;
+    float _biasX{0}, _biasY{0}, _biasZ{0};
+
+public:
+    explicit MadgwickFilter(float beta = 0.1f, float zeta = 0.004f) : _beta(beta), _zeta(zeta) {}
+
+    void Update(float gx, float gy, float gz, float ax, float ay, float az, float dt) override
+    {
+        float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        bool corrected = NormalizeVector(ax, ay, az);
+
+        if (corrected)
+        {
+            float _2q0 = 2.0f * _q0, _2q1 = 2.0f * _q1, _2q2 = 2.0f * _q2, _2q3 = 2.0f * _q3;
+            float _4q0 = 4.0f * _q0, _4q1 = 4.0f * _q1, _4q2 = 4.0f * _q2;
+            float _8q1 = 8.0f * _q1, _8q2 = 8.0f * _q2;
+            float q0q0 = _q0 * _q0, q1q1 = _q1 * _q1, q2q2 = _q2 * _q2, q3q3 = _q3 * _q3;
+
+            // Gradient of the gravity objective function
+            s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+            s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * _q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+            s2 = 4.0f * q0q0 * _q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+            s3 = 4.0f * q1q1 * _q3 - _2q1 * ax + 4.0f * q2q2 * _q3 - _2q2 * ay;
+
+            float norm = sqrtf(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+            if (norm > 0.0f)
+            {
+                float inv = 1.0f / norm;
+                s0 *= inv; s1 *= inv; s2 *= inv; s3 *= inv;
+            }
+
+            if (_zeta > 0.0f)
+            {
+                // Gyro error is the rate part of 2 * conj(q) * s
+                float errorX = 2.0f * (_q0 * s1 - _q1 * s0 - _q2 * s3 + _q3 * s2);
+                float errorY = 2.0f * (_q0 * s2 + _q1 * s3 - _q2 * s0 - _q3 * s1);
+                float errorZ = 2.0f * (_q0 * s3 - _q1 * s2 + _q2 * s1 - _q3 * s0);
+                _biasX += errorX * _zeta * dt;
+                _biasY += errorY * _zeta * dt;
+                _biasZ += errorZ * _zeta * dt;
+            }
+        }
+
+        gx -= _biasX;
+        gy -= _biasY;
+        gz -= _biasZ;
+
+        float qDot0 = 0.5f * (-_q1 * gx - _q2 * gy - _q3 * gz) - _beta * s0;
+        float qDot1 = 0.5f * (_q0 * gx + _q2 * gz - _q3 * gy) - _beta * s1;
+        float qDot2 = 0.5f * (_q0 * gy - _q1 * gz + _q3 * gx) - _beta * s2;
+        float qDot3 = 0.5f * (_q0 * gz + _q1 * gy - _q2 * gx) - _beta * s3;
+
+        _q0 += qDot0 * dt;
+        _q1 += qDot1 * dt;
+        _q2 += qDot2 * dt;
+        _q3 += qDot3 * dt;
+        Normalize();
+    }
+
+    void GetGyroBias(float bias[3]) const
+    {
+        bias[0] = _biasX; bias[1] = _biasY; bias[2] = _biasZ;
+    }
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef MAHONYFILTER_H
+#define MAHONYFILTER_H
+
+#include "QuaternionEstimator.h"
+
+// Mahony nonlinear complementary filter on SO(3). The integral term is the
+// gyro bias estimate.
+class MahonyFilter final : public QuaternionEstimator
+{
+private:
+    float _kp;
+    float _ki;
+    float _integralX{0}, _integralY{0}, _integralZ{0};
+
+public:
+    explicit MahonyFilter(float kp = 1.0f, float ki = 0.02f) : _kp(kp), _ki(ki) {}
+
+    void Update(float gx, float gy, float gz, float ax, float ay, float az, float dt) override
+    {
+        if (NormalizeVector(ax, ay, az))
+        {
+            // Estimated gravity direction (half of it, saves multiplies)
+            float halfVx = _q1 * _q3 - _q0 * _q2;
+            float halfVy = _q0 * _q1 + _q2 * _q3;
+            float halfVz = _q0 * _q0 - 0.5f + _q3 * _q3;
+
+            // Error is the cross product of measured and estimated gravity
+            float halfEx = ay * halfVz - az * halfVy;
+            float halfEy = az * halfVx - ax * halfVz;
+            float halfEz = ax * halfVy - ay * halfVx;
+
+            if (_ki > 0.0f)
+            {
+                _integralX += 2.0f * _ki * halfEx * dt;
+                _integralY += 2.0f * _ki * halfEy * dt;
+                _integralZ += 2.0f * _ki * halfEz * dt;
+                gx += _integralX;
+                gy += _integralY;
+                gz += _integralZ;
+            }
+
+            gx += 2.0f * _kp * halfEx;
+            gy += 2.0f * _kp * halfEy;
+            gz += 2.0f * _kp * halfEz;
+        }
+
+        gx *= 0.5f * dt;
+        gy *= 0.5f * dt;
+        gz *= 0.5f * dt;
+        float qa = _q0, qb = _q1, qc = _q2;
+        _q0 += -qb * gx - qc * gy - _q3 * gz;
+        _q1 += qa * gx + qc * gz - _q3 * gy;
+        _q2 += qa * gy - qb * gz + _q3 * gx;
+        _q3 += qa * gz + qb * gy - qc * gx;
+        Normalize();
+    }
+
+    void GetGyroBias(float bias[3]) const
+    {
+        bias[0] = -_integralX; bias[1] = -_integralY; bias[2] = -_integralZ;
+    }
+};
+
+#endif
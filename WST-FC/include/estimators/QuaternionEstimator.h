@@ -0,0 +1,82 @@
+#ifndef QUATERNIONESTIMATOR_H
+#define QUATERNIONESTIMATOR_H
+
+#include <math.h>
+#include "IAttitudeEstimator.h"
+#include "../FastMath.h"
+
+// Shared state of the quaternion filters. q rotates the sensor frame into
+// the earth frame, gravity in the sensor frame is its third row.
+class QuaternionEstimator : public IAttitudeEstimator
+{
+protected:
+    float _q0{1.0f};
+    float _q1{0.0f};
+    float _q2{0.0f};
+    float _q3{0.0f};
+
+    void Normalize()
+    {
+        float norm = sqrtf(_q0 * _q0 + _q1 * _q1 + _q2 * _q2 + _q3 * _q3);
+        if (norm <= 0.0f)
+        {
+            _q0 = 1.0f; _q1 = _q2 = _q3 = 0.0f;
+            return;
+        }
+        float inv = 1.0f / norm;
+        _q0 *= inv; _q1 *= inv; _q2 *= inv; _q3 *= inv;
+    }
+
+    // Returns false for a zero vector
+    static bool NormalizeVector(float &x, float &y, float &z)
+    {
+        float norm = sqrtf(x * x + y * y + z * z);
+        if (norm <= 0.0f) return false;
+        float inv = 1.0f / norm;
+        x *= inv; y *= inv; z *= inv;
+        return true;
+    }
+
+public:
+    void Reset(float ax, float ay, float az) override
+    {
+        // Yaw is unobservable without a magnetometer and starts at 0
+        float halfPitch = 0.5f * FastAtan2(ay, az);
+        float halfRoll = 0.5f * FastAtan2(-ax, sqrtf(ay * ay + az * az));
+        float cp = FastCos(halfPitch), sp = FastSin(halfPitch);
+        float cr = FastCos(halfRoll), sr = FastSin(halfRoll);
+        _q0 = cp * cr;
+        _q1 = sp * cr;
+        _q2 = cp * sr;
+        _q3 = -sp * sr;
+        Normalize();
+    }
+
+    float GetPitch() const override
+    {
+        return FastAtan2(_q0 * _q1 + _q2 * _q3, 0.5f - _q1 * _q1 - _q2 * _q2) * FAST_RAD_TO_DEG;
+    }
+
+    float GetRoll() const override
+    {
+        float sinRoll = 2.0f * (_q0 * _q2 - _q1 * _q3);
+        if (sinRoll > 1.0f) sinRoll = 1.0f;
+        if (sinRoll < -1.0f) sinRoll = -1.0f;
+        // asin through atan2 keeps everything on the FastMath kernels
+        return FastAtan2(sinRoll, sqrtf(1.0f - sinRoll * sinRoll)) * FAST_RAD_TO_DEG;
+    }
+
+    void GetGravity(float gravity[3]) const override
+    {
+        gravity[0] = 2.0f * (_q1 * _q3 - _q0 * _q2);
+        gravity[1] = 2.0f * (_q0 * _q1 + _q2 * _q3);
+        gravity[2] = _q0 * _q0 - _q1 * _q1 - _q2 * _q2 + _q3 * _q3;
+    }
+
+    void GetQuaternion(float q[4]) const
+    {
+        q[0] = _q0; q[1] = _q1; q[2] = _q2; q[3] = _q3;
+    }
+};
+
+#endif
@@ -1,13 +1,15 @@
 #ifndef CAMERA_MODULE
 #define CAMERA_MODULE
 #include "IModule.h"
-#include "esp_http_server.h"
 
 #if defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_IDF_TARGET_ESP32S2) || defined(CONFIG_IDF_TARGET_ESP32S3)
     #define CAMERA_SUPPORTED
 #endif
 
 #ifdef CAMERA_SUPPORTED
+    #include <lwip/sockets.h>
+    #include "CameraStreamer.h"
+    #include "../VideoProtocol.h"
 
     // AI-Thinker
     #define PWDN_GPIO_NUM     32
@@ -27,25 +29,84 @@
     #define HREF_GPIO_NUM     23
     #define PCLK_GPIO_NUM     22
     #define XCLK_FREQ_HZ      20000000
+    // Start quality, CameraStreamer::Adapt() moves it
     #define JPEG_QUALITY      25
-    #define FB_COUNT          2
+    // Largest frame size, the buffers are sized for it
+    #define FRAME_SIZE        FRAMESIZE_VGA
     #define PART_BOUNDARY "123456789000000000000987654321"
+    #define STREAM_PORT       80
+    // A viewer that takes longer than this for a write is dropped
+    #define STREAM_SEND_TIMEOUT_MS 1000
+    #define STREAM_SERVER_STACK 3072
+    #define STREAM_SERVER_PRIORITY 1
+    // Frames as datagrams on VIDEO_PORT (VideoProtocol.h) next to MJPEG
+    #define STREAM_UDP        1
+    // Ticks waited for lwIP buffers before the rest of a frame is given up
+    #define STREAM_UDP_RETRIES 5
 
+    // One MJPEG over HTTP viewer
+    class MjpegClient : public ICameraSink{
+        public:
+            // Sends the response headers, false closes the socket
+            bool Open(int socket, const char *address);
+            bool IsOpen() const { return _socket >= 0; }
+            bool Send(const CameraFrame &frame) override;
+            void Close() override;
+            const char *GetName() const override { return _name; }
+        private:
+            volatile int _socket {-1};
+            char _name[32] {};
+    };
+
+    // One subscriber of the datagram stream. Subscribes arrive on the server
+    // task, frames go out from the client's streamer task over the shared
+    // socket; a lost fragment costs the viewer that frame, never a resend.
+    class UdpVideoClient : public ICameraSink{
+        public:
+            void Open(int socket, const sockaddr_in &address, const VideoSubscribe &subscribe);
+            bool IsOpen() const { return _open; }
+            bool IsFrom(const sockaddr_in &address) const;
+            // Keeps the subscription up and takes the viewer's frame counts
+            void Refresh(const VideoSubscribe &subscribe);
+            bool Send(const CameraFrame &frame) override;
+            void Close() override { _open = false; }
+            const char *GetName() const override { return _name; }
+            float GetLoss() const override { return _loss; }
+        private:
+            int _socket {-1};
+            sockaddr_in _address {};
+            volatile bool _open {false};
+            volatile unsigned long _lastSubscribeMs {0};
+            uint32_t _lastComplete {0};
+            uint32_t _lastIncomplete {0};
+            volatile float _loss {0.0f};
+            uint8_t _datagram[VIDEO_DATAGRAM_SIZE];
+            char _name[32] {};
+    };
 
+    // Serves GET / as MJPEG and subscribers of the datagram stream, up to
+    // CAMERA_MAX_CLIENTS viewers together, and GET /stats as text. The server
+    // task only accepts connections and subscribes, every viewer is sent to by
+    // its own CameraStreamer client task.
     class CameraModule : public IModule{
         public:
             CameraModule();
             void Init() override;
             void Loop(CommunicationModule* interface, SensorsData *data) override;
+            void PrintStats(Print &out) override;
         private:
-            static constexpr const char* _STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-            static constexpr const char* _STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-            static constexpr const char* _STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
-            
-            httpd_handle_t stream_httpd {NULL};
-
-            static esp_err_t stream_handler(httpd_req_t *req);
+            CameraStreamer _streamer;
+            MjpegClient _clients[CAMERA_MAX_CLIENTS];
+            int _listenSocket {-1};
+            TaskHandle_t _serverTask {nullptr};
+            #if STREAM_UDP
+                UdpVideoClient _udpClients[CAMERA_MAX_CLIENTS];
+                int _udpSocket {-1};
+                void ReceiveSubscribe();
+            #endif
 
+            static void ServerTaskBody(void *arg);
+            void Accept(int socket, const char *address);
             void startCameraServer();
         };
 #else
@@ -0,0 +1,141 @@
+#ifndef CAMERA_STREAMER
+#define CAMERA_STREAMER
+
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "../Configuration.h"
+#include "../Trace.h"
+
+// Viewers served at once, each one has its own sender task
+#define CAMERA_MAX_CLIENTS 3
+// Every client holds at most the frame it is sending, all pending slots
+// hold the newest frame, and the driver needs one to fill
+#define CAMERA_FB_COUNT (CAMERA_MAX_CLIENTS + 2)
+#define CAMERA_TARGET_FPS 20
+// esp32-camera JPEG quality, lower is better
+#define CAMERA_QUALITY_BEST 10
+#define CAMERA_QUALITY_WORST 40
+#define CAMERA_ADAPT_INTERVAL_MS 1000
+// Frames a datagram viewer reports lost, above it frames get smaller, below
+// the other it may grow them back
+#define CAMERA_LOSS_DEGRADE 0.1f
+#define CAMERA_LOSS_IMPROVE 0.02f
+#define CAMERA_CAPTURE_PRIORITY 3
+#define CAMERA_CLIENT_PRIORITY 2
+
+// One driver frame buffer shared by every client that sends it. Returned
+// to the driver when the last reference is released.
+struct CameraFrame
+{
+    camera_fb_t *fb{nullptr};
+    uint32_t id{0};
+    // esp_timer clock at the end of the capture
+    int64_t captureUs{0};
+    uint8_t refs{0};
+};
+
+// Transport of one viewer (MJPEG over TCP, ...). Send() runs on the
+// client's own task and may block up to the transport's timeout.
+class ICameraSink
+{
+public:
+    virtual ~ICameraSink() {}
+    // false drops the client
+    virtual bool Send(const CameraFrame &frame) = 0;
+    // The client is gone, the sink may be opened for the next one
+    virtual void Close() = 0;
+    virtual const char *GetName() const = 0;
+    // Share of sent frames the viewer did not get, for transports that
+    // report it back
+    virtual float GetLoss() const { return 0.0f; }
+};
+
+struct CameraClientStats
+{
+    uint32_t frames{0};
+    // Replaced by a newer frame before the client got to send them
+    uint32_t dropped{0};
+    uint32_t bytes{0};
+    // Last adapt interval
+    float fps{0.0f};
+    float kBps{0.0f};
+    // Share of the interval spent sending
+    float busy{0.0f};
+    // Capture to sent
+    uint32_t latencyAvgUs{0};
+    uint32_t latencyMaxUs{0};
+};
+
+struct CameraStreamerStats
+{
+    uint32_t captured{0};
+    uint32_t captureErrors{0};
+    // Captures that waited for clients to release a buffer
+    uint32_t starved{0};
+    float fps{0.0f};
+};
+
+// Captures every frame once on its own task and hands it to every client
+// without copying. Each client keeps one pending frame: a newer frame
+// replaces it, so a slow client skips frames instead of holding up the
+// capture or the other clients. Adapt() moves JPEG quality and frame size
+// so the fastest client can send CAMERA_TARGET_FPS frames without loss.
+class CameraStreamer
+{
+private:
+    struct Client
+    {
+        CameraStreamer *streamer{nullptr};
+        ICameraSink *sink{nullptr};
+        CameraFrame *pending{nullptr};
+        TaskHandle_t task{nullptr};
+        CameraClientStats stats;
+        // Since the last Adapt()
+        uint32_t intervalFrames{0};
+        uint32_t intervalBytes{0};
+        int64_t intervalBusyUs{0};
+        uint64_t intervalLatencyUs{0};
+        uint32_t intervalLatencyMaxUs{0};
+    };
+
+    CameraFrame _frames[CAMERA_FB_COUNT];
+    uint8_t _frameCount{CAMERA_FB_COUNT};
+    Client _clients[CAMERA_MAX_CLIENTS];
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    TaskHandle_t _captureTask{nullptr};
+    uint32_t _nextId{0};
+    CameraStreamerStats _stats;
+    uint32_t _intervalCaptured{0};
+    bool _initiated{false};
+
+    // Index into the frame size ladder, and the JPEG quality
+    uint8_t _sizeIndex{0};
+    uint8_t _sizeCount{0};
+    int _quality{CAMERA_QUALITY_BEST};
+    framesize_t _appliedSize;
+    unsigned long _lastAdaptMs{0};
+
+    static void CaptureTaskBody(void *arg);
+    static void ClientTaskBody(void *arg);
+    void Capture();
+    void Serve(Client &client);
+    void Release(CameraFrame *frame);
+    void Apply();
+
+public:
+    // config.frame_size is the largest size used, the buffers are sized for it
+    bool Init(camera_config_t config);
+
+    // false when every client slot is taken
+    bool AddClient(ICameraSink *sink);
+    uint8_t GetClientCount();
+
+    // Modules task
+    void Adapt();
+
+    int GetQuality() const { return _quality; }
+    framesize_t GetFrameSize() const;
+    void PrintStats(Print &out);
+};
+
+#endif
@@ -3,10 +3,12 @@
 
 #include "../SensorsData.h"
 #include "../CommunicationModule.h"
+#include "../Trace.h"
 class IModule{
 public:
     virtual ~IModule(){}
     virtual void Init();
     virtual void Loop(CommunicationModule* interface, SensorsData *data);
+    virtual void PrintStats(Print &out) {}
 };
 #endif 
\ No newline at end of file
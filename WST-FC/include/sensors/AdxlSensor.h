@@ -2,24 +2,46 @@
 #define ADXLSENSOR_H
 
 #include "../ISensor.h" 
-#include <Wire.h>
-#include <Adafruit_Sensor.h>
-#include <Adafruit_ADXL345_U.h>
+#include "../I2CBus.h"
+#include "../Configuration.h"
 
-class AdxlSensor : public ISensor
+#define ADXL345_ADDRESS 0x53
+// Output data rate programmed in Init
+#define ADXL345_RATE_HZ 100.0f
+
+class AdxlSensor final : public ISensor
 {
 private:
-    Adafruit_ADXL345_Unified accel = Adafruit_ADXL345_Unified(12345);
-    
+    I2CBus *bus;
+
+    // Written by the bus task
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    uint8_t readBuffer[6];
+    int16_t raw[3] {0, 0, 0};
+    volatile bool newData {false};
+    volatile bool readPending {false};
+    uint32_t busErrors {0};
+
+    bool sensorInitiated {false};
+#if USE_FIXED_POINT_MATH
+    // Centidegrees in Q8, the filter would stall on whole centidegrees
+    int32_t pitchQ8 {0};
+    int32_t rollQ8 {0};
+#else
     float pitch {0};
     float roll {0};
-    bool sensorInitiated {false};
     const float alpha {0.2f}; 
 
+    void ToAcceleration(const int16_t counts[3], float accel[3]);
+#endif
+
+    static void OnRead(void *context, bool ok);
+    void Reset(const int16_t counts[3]);
+
 public:
-    AdxlSensor();
+    explicit AdxlSensor(I2CBus *bus);
     void Init() override;
     void Update(SensorsData *data) override;
 };
 
-#endif
\ No newline at end of file
+#endif
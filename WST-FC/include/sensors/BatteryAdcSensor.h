@@ -0,0 +1,76 @@
+#ifndef BATTERYADCSENSOR_H
+#define BATTERYADCSENSOR_H
+#include "../ISensor.h"
+#include "../Configuration.h"
+#include "../SeqLock.h"
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+
+// DMA frames per second, each one is averaged into a single reading
+#define BATTERY_ADC_FRAME_HZ 500
+#define BATTERY_ADC_TASK_PRIORITY 4
+// Update() only copies the latest state, it can run every tick
+#define BATTERY_RATE_HZ CONTROL_LOOP_HZ
+
+struct BatteryState
+{
+    float voltage{0.0f};
+    float current{0.0f};
+    float consumedMah{0.0f};
+};
+
+struct BatteryAdcStats
+{
+    uint32_t frames{0};
+    // Conversions that went into the readings
+    uint32_t samples{0};
+    // Frames without a single sample of the voltage channel
+    uint32_t emptyFrames{0};
+    uint32_t readErrors{0};
+};
+
+// Battery voltage and optional current sense on the ADC continuous (DMA)
+// mode. The ADC converts the channels back to back at BATTERY_ADC_SAMPLE_HZ,
+// a background task averages every DMA frame, converts it with the eFuse
+// calibration, low-pass filters it and integrates the consumed mAh. Update()
+// only copies the last published state into SensorsData.
+class BatteryAdcSensor final : public ISensor
+{
+private:
+    int _voltageChannel;
+    int _currentChannel;
+    float _dividerRatio;
+    float _mvPerAmp;
+    float _offsetMv;
+
+    esp_adc_cal_characteristics_t _calibration;
+    TaskHandle_t _task{nullptr};
+    bool _initiated{false};
+
+    // Owned by the task
+    BatteryState _filtered;
+    double _consumedMah{0.0};
+    bool _primed{false};
+    int64_t _lastFrameUs{0};
+    BatteryAdcStats _stats;
+
+    SeqLock<BatteryState> _state;
+
+    static void TaskBody(void *arg);
+    void ProcessFrame(const uint8_t *buffer, uint32_t length);
+
+public:
+    // currentChannel -1 measures voltage only
+    BatteryAdcSensor(int voltageChannel = BATTERY_VOLTAGE_ADC_CHANNEL, float dividerRatio = BATTERY_DIVIDER_RATIO,
+        int currentChannel = BATTERY_CURRENT_ADC_CHANNEL, float mvPerAmp = BATTERY_CURRENT_MV_PER_AMP,
+        float offsetMv = BATTERY_CURRENT_OFFSET_MV);
+    void Init() override;
+    void Update(SensorsData *data) override;
+
+    // Latest filtered state, for throttle limiting outside the sensor loop
+    bool GetState(BatteryState &state) const;
+    BatteryAdcStats GetStats() const { return _stats; }
+    void PrintStats(Print &out) const;
+};
+
+#endif
@@ -1,21 +1,56 @@
 #ifndef DHT11SENSOR_H
 #define DHT11SENSOR_H
 #include "../ISensor.h"
-#include <DHT.h>
-#include <Wire.h>
-#define DHTTYPE DHT11
-class DHT11Sensor : public ISensor
+#include "../Configuration.h"
+#include <esp_timer.h>
+#include <driver/rmt.h>
+
+#define DHT_TYPE_DHT11 11
+#define DHT_TYPE_DHT22 22
+// DHT11 refreshes once a second, reading faster returns the cached value
+#define DHT_RATE_HZ 0.5f
+// Host start pulse
+#define DHT11_START_US 20000
+#define DHT22_START_US 1200
+// Response + 40 bits take under 5 ms
+#define DHT_FRAME_US 6000
+// Longest pulse in a frame is 80 us, a longer quiet line ends the frame
+#define DHT_IDLE_US 200
+
+// DHT11/DHT22 on an RMT receive channel. Update() pulls the line low and an
+// esp_timer releases it after the start pulse and arms the RMT, which records
+// the whole reply in hardware. The next Update() decodes it and starts the
+// next transaction, nothing waits on the wire.
+class DHT11Sensor final : public ISensor
 {
 private:
-    DHT _dht;
+    enum State {IDLE, STARTING, RECEIVING};
+
+    gpio_num_t _pin;
     int _id {0};
+    uint8_t _type {DHT_TYPE_DHT11};
+    rmt_channel_t _channel;
+    RingbufHandle_t _ringbuf {nullptr};
+    esp_timer_handle_t _startTimer {nullptr};
+    volatile State _state {IDLE};
+    int64_t _releasedUs {0};
+    bool _initiated {false};
+
+    uint32_t _reads {0};
+    uint32_t _errors {0};
+
+    static void OnStartPulseDone(void *arg);
+    void StartTransaction();
+    bool Decode(const rmt_item32_t *items, size_t count, float &temperature, float &humidity);
 
-    unsigned long _lastReadTime {0};
-    const unsigned long READ_INTERVAL {2000};
 public:
-    DHT11Sensor(int pin, int id);
+    DHT11Sensor(int pin, int id, uint8_t type = DHT_TYPE_DHT11, int rmtChannel = DHT_RMT_CHANNEL);
     void Init() override;
     void Update(SensorsData *data) override;
+
+    uint32_t GetReads() const { return _reads; }
+    // No reply, bad timing or checksum
+    uint32_t GetErrors() const { return _errors; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,86 @@
+#ifndef MPU6050DRIVER_H
+#define MPU6050DRIVER_H
+#include <Arduino.h>
+#include "../I2CBus.h"
+
+// Register level MPU6050 driver: the chip samples on its own clock into the
+// hardware FIFO and raises INT on every sample, the ISR records when. The FIFO
+// is drained through I2CBus (count read, then one burst of accel + gyro) and
+// every sample is paired with its INT time. Read() never touches the bus.
+
+#define MPU6050_ADDRESS 0x68
+// Accel XYZ + gyro XYZ, 16 bit each
+#define MPU6050_FIFO_SAMPLE_SIZE 12
+#define MPU6050_FIFO_SIZE 1024
+// Samples per I2C read, Wire buffers at most 128 bytes
+#define MPU6050_BURST_SAMPLES 10
+// INT timestamps kept for samples still waiting in the FIFO
+#define MPU6050_TIMESTAMP_RING 32
+// Decoded samples waiting for Read()
+#define MPU6050_SAMPLE_QUEUE 16
+
+struct MpuSample
+{
+    uint32_t timeUs;
+    float accel[3]; // m/s^2
+    float gyro[3];  // rad/s
+};
+
+class Mpu6050Driver
+{
+private:
+    I2CBus *_bus;
+    uint8_t _address {MPU6050_ADDRESS};
+    int8_t _intPin {-1};
+    uint32_t _samplePeriodUs {1000};
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    volatile uint32_t _readyTimes[MPU6050_TIMESTAMP_RING];
+    volatile uint32_t _readyCount {0};
+    // INT count that the next sample in the FIFO belongs to
+    uint32_t _consumed {0};
+
+    // Bus side, touched only from I2CBus callbacks while _busy
+    volatile bool _busy {false};
+    uint8_t _countBytes[2];
+    uint8_t _fifoBuffer[MPU6050_BURST_SAMPLES * MPU6050_FIFO_SAMPLE_SIZE];
+    uint16_t _fifoAvailable {0};
+    uint8_t _fifoReading {0};
+    uint32_t _countTime {0};
+
+    MpuSample _queue[MPU6050_SAMPLE_QUEUE];
+    uint8_t _queueHead {0};
+    uint8_t _queueCount {0};
+
+    uint32_t _samplesRead {0};
+    uint32_t _overflows {0};
+    uint32_t _resyncs {0};
+    uint32_t _busErrors {0};
+
+    static void IRAM_ATTR ISR(void *arg);
+    void IRAM_ATTR HandleInterrupt();
+
+    static void OnCount(void *context, bool ok);
+    static void OnFifo(void *context, bool ok);
+    static void OnFifoReset(void *context, bool ok);
+    void ResetFifo();
+    uint32_t GetReadyCount();
+
+public:
+    explicit Mpu6050Driver(I2CBus *bus) : _bus(bus) {}
+
+    // sampleRateHz divides the 1 kHz internal rate, dlpf 1..6 (CONFIG register).
+    // intPin < 0 polls the FIFO and spaces timestamps by the sample period.
+    bool Begin(int8_t intPin, uint16_t sampleRateHz, uint8_t dlpf, uint8_t address = MPU6050_ADDRESS);
+
+    // Oldest sample first, returns how many were written. Starts the next
+    // FIFO drain on the bus, so samples show up one call later.
+    uint8_t Read(MpuSample *samples, uint8_t maxSamples);
+
+    uint32_t GetSamplesRead() const { return _samplesRead; }
+    uint32_t GetOverflows() const { return _overflows; }
+    uint32_t GetResyncs() const { return _resyncs; }
+    uint32_t GetBusErrors() const { return _busErrors; }
+};
+
+#endif
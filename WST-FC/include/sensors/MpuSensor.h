@@ -1,21 +1,54 @@
 #ifndef MPUSENSOR_H
 #define MPUSENSOR_H
 #include "../ISensor.h"
-#include <Adafruit_MPU6050.h>
-#include <Wire.h>
+#include "../Configuration.h"
+#include "../I2CBus.h"
 
-class MpuSensor : public ISensor
+#if MPU_NATIVE_DRIVER
+    #include "Mpu6050Driver.h"
+#else
+    #include <Adafruit_MPU6050.h>
+#endif
+
+#if ATTITUDE_ESTIMATOR == 1
+    #include "../estimators/MadgwickFilter.h"
+    typedef MadgwickFilter AttitudeEstimator;
+#elif ATTITUDE_ESTIMATOR == 2
+    #include "../estimators/MahonyFilter.h"
+    typedef MahonyFilter AttitudeEstimator;
+#else
+    #include "../estimators/ComplementaryFilter.h"
+    typedef ComplementaryFilter AttitudeEstimator;
+#endif
+
+// Longest gap integrated as one step, e.g. after the task was stalled
+#define MPU_MAX_DT 0.05f
+
+class MpuSensor final : public ISensor
 {
 private:
+    I2CBus *bus;
+#if MPU_NATIVE_DRIVER
+    Mpu6050Driver mpu;
+    MpuSample samples[MPU6050_BURST_SAMPLES];
+#else
     Adafruit_MPU6050 mpu;
-    float pitch = 0;
-    float roll = 0;
+#endif
+    AttitudeEstimator estimator;
     unsigned long lastTime = 0;
     bool mpuInitiated = false;
 
+    void Integrate(const float accel[3], const float gyro[3], unsigned long sampleTime);
+    void Publish(SensorsData *data, const float accel[3], const float gyro[3]);
+
 public:
+#if MPU_NATIVE_DRIVER
+    explicit MpuSensor(I2CBus *bus) : bus(bus), mpu(bus) {}
+#else
+    explicit MpuSensor(I2CBus *bus) : bus(bus) {}
+#endif
     void Init() override;
     void Update(SensorsData *data) override;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,109 @@
+#ifndef ULTRASONICARRAY_H
+#define ULTRASONICARRAY_H
+#include "../ISensor.h"
+#include "../Configuration.h"
+#include <driver/rmt.h>
+#include <soc/soc_caps.h>
+#if SOC_MCPWM_SUPPORTED
+    #include <driver/mcpwm.h>
+#endif
+
+// One per distanceSensors slot, MCPWM has 2 units x 3 capture channels
+#define ULTRASONIC_MAX_CHANNELS 6
+#define ULTRASONIC_MEDIAN_WINDOW 5
+// Echo window, ~5 m. Longer pulses are HC-SR04's 38 ms "nothing there"
+#define ULTRASONIC_TIMEOUT_US 30000
+// Quiet time after a group finished, lets reflections and a late 38 ms
+// no-object pulse die out before the next trigger
+#define ULTRASONIC_GUARD_US 10000
+// Update() only polls, it can run often
+#define ULTRASONIC_RATE_HZ 200.0f
+
+struct UltrasonicChannelStats
+{
+    uint32_t measurements{0};
+    uint32_t timeouts{0};
+    // Trigger to filtered value in SensorsData
+    uint32_t lastLatencyUs{0};
+    uint32_t maxLatencyUs{0};
+    uint64_t latencySumUs{0};
+};
+
+// N HC-SR04s handled as one sensor. Trigger pulses come from one RMT TX
+// channel routed to the pins of the group being fired, echo edges are
+// timestamped by MCPWM capture (GPIO interrupt on chips without MCPWM).
+// Groups fire back to back, the next one as soon as the previous echoes
+// are in and the guard time passed. Readings go through a median filter.
+class UltrasonicArray final : public ISensor
+{
+public:
+    enum FiringPattern
+    {
+        // One transducer at a time, no cross-talk at all
+        ROUND_ROBIN,
+        // i fires together with i + N/2, for transducers facing away from each other
+        OPPOSITE_PAIRS
+    };
+
+private:
+    struct Channel
+    {
+        UltrasonicArray *owner{nullptr};
+        uint8_t index{0};
+        int trigPin{-1};
+        int echoPin{-1};
+        // Edge state, shared with the capture ISR
+        bool armed{false};
+        bool rising{false};
+        bool done{false};
+        uint32_t riseTicks{0};
+        uint32_t echoTicks{0};
+
+        uint16_t window[ULTRASONIC_MEDIAN_WINDOW];
+        uint8_t windowCount{0};
+        uint8_t windowIndex{0};
+        UltrasonicChannelStats stats;
+    };
+
+    Channel _channels[ULTRASONIC_MAX_CHANNELS];
+    uint8_t _count{0};
+    uint8_t _firstSlot{0};
+    uint8_t _groupMasks[ULTRASONIC_MAX_CHANNELS];
+    uint8_t _groupCount{0};
+    uint8_t _group{0};
+
+    rmt_channel_t _rmtChannel;
+    rmt_item32_t _pulse;
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    bool _initiated{false};
+    bool _inFlight{false};
+    int64_t _fireUs{0};
+    int64_t _doneUs{0};
+    int64_t _statsSinceUs{0};
+
+#if SOC_MCPWM_SUPPORTED
+    static bool IRAM_ATTR OnCapture(mcpwm_unit_t unit, mcpwm_capture_channel_id_t capture, const cap_event_data_t *event, void *arg);
+#else
+    static void IRAM_ATTR OnEchoChange(void *arg);
+#endif
+    void IRAM_ATTR HandleEdge(Channel &channel, bool rising, uint32_t ticks);
+    void Fire();
+    void Collect(SensorsData *data, int64_t now);
+    uint16_t Median(const Channel &channel) const;
+
+public:
+    // Channel i writes distanceSensors[firstSlot + i]
+    UltrasonicArray(const uint8_t *trigPins, const uint8_t *echoPins, uint8_t count, FiringPattern pattern = ROUND_ROBIN,
+        uint8_t firstSlot = 0, int rmtChannel = ULTRASONIC_RMT_CHANNEL);
+    void Init() override;
+    void Update(SensorsData *data) override;
+
+    uint8_t GetChannelCount() const { return _count; }
+    UltrasonicChannelStats GetStats(uint8_t index) const;
+    // Valid measurements per second over all channels
+    float GetAggregateRate() const;
+    void ResetStats();
+    void PrintStats(Print &out) const;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "Benchmark.h"
+
+#if USE_BENCHMARK
+#include "FastMath.h"
+#include "AirBoatMixer.h"
+#include "BicopterMixer.h"
+#include "MatrixMixer.h"
+
+#define MATH_SAMPLES 256
+
+void RunMathBenchmarks(Print &out)
+{
+    static float ys[MATH_SAMPLES], xs[MATH_SAMPLES], angles[MATH_SAMPLES];
+    static int32_t iys[MATH_SAMPLES], ixs[MATH_SAMPLES], centidegs[MATH_SAMPLES];
+    for (int i = 0; i < MATH_SAMPLES; i++)
+    {
+        float t = (float)i / MATH_SAMPLES;
+        angles[i] = -FAST_PI + FAST_TWO_PI * t;
+        ys[i] = 9.81f * sinf(t * 37.0f);
+        xs[i] = 9.81f * cosf(t * 23.0f);
+        centidegs[i] = -CENTIDEG_180 + (int32_t)(CENTIDEG_360 * t);
+        iys[i] = (int32_t)(4096 * sinf(t * 37.0f));
+        ixs[i] = (int32_t)(4096 * cosf(t * 23.0f));
+    }
+
+    volatile float floatSink = 0;
+    volatile int32_t intSink = 0;
+    int i = 0;
+    const uint32_t iterations = BENCHMARK_ITERATIONS;
+
+    PrintBenchmark(out, "atan2 (double)", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; floatSink = atan2((double)ys[i], (double)xs[i]); }));
+    PrintBenchmark(out, "atan2f", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; floatSink = atan2f(ys[i], xs[i]); }));
+    PrintBenchmark(out, "FastAtan2", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; floatSink = FastAtan2(ys[i], xs[i]); }));
+    PrintBenchmark(out, "FixedAtan2", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; intSink = FixedAtan2(iys[i], ixs[i]); }));
+
+    PrintBenchmark(out, "sin (double)", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; floatSink = sin((double)angles[i]); }));
+    PrintBenchmark(out, "sinf", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; floatSink = sinf(angles[i]); }));
+    PrintBenchmark(out, "FastSin", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; floatSink = FastSin(angles[i]); }));
+    PrintBenchmark(out, "FixedSin", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; intSink = FixedSin(centidegs[i]); }));
+
+    float accel[3];
+    int32_t accelFixed[3];
+    PrintBenchmark(out, "RemoveGravity", BenchmarkCycles(iterations, [&]() {
+        i = (i + 1) % MATH_SAMPLES;
+        accel[0] = xs[i]; accel[1] = ys[i]; accel[2] = GRAVITY;
+        RemoveGravity(angles[i] * FAST_RAD_TO_DEG, -angles[i] * FAST_RAD_TO_DEG, accel);
+        floatSink = accel[2];
+    }));
+    PrintBenchmark(out, "RemoveGravityFixed", BenchmarkCycles(iterations, [&]() {
+        i = (i + 1) % MATH_SAMPLES;
+        accelFixed[0] = ixs[i]; accelFixed[1] = iys[i]; accelFixed[2] = 981;
+        RemoveGravityFixed(centidegs[i], -centidegs[i], accelFixed);
+        intSink = accelFixed[2];
+    }));
+
+    float atanError = 0, sinError = 0, fixedAtanError = 0, fixedSinError = 0;
+    for (int k = 0; k < MATH_SAMPLES; k++)
+    {
+        atanError = fmaxf(atanError, fabsf(FastAtan2(ys[k], xs[k]) - (float)atan2((double)ys[k], (double)xs[k])));
+        sinError = fmaxf(sinError, fabsf(FastSin(angles[k]) - (float)sin((double)angles[k])));
+        fixedAtanError = fmaxf(fixedAtanError, fabsf(FixedAtan2(iys[k], ixs[k]) - (float)(atan2((double)iys[k], (double)ixs[k]) * 18000.0 / M_PI)));
+        fixedSinError = fmaxf(fixedSinError, fabsf(FixedSin(centidegs[k]) - (float)(sin(centidegs[k] * M_PI / 18000.0) * Q15_ONE)));
+    }
+    out.printf("[bench] max error FastAtan2 %.2e rad, FastSin %.2e, FixedAtan2 %.2f cdeg, FixedSin %.1f LSB\n",
+        atanError, sinError, fixedAtanError, fixedSinError);
+}
+
+// Keeps the last value, so the mixers are measured without the PWM drivers
+class NullActuator final : public IActuator
+{
+public:
+    volatile int16_t value{0};
+    void Init() override {}
+    void Set(int16_t speed) override { value = speed; }
+    void Loop() override {}
+};
+
+void RunMixerBenchmarks(Print &out)
+{
+    static NullActuator actuators[4];
+    static DroneControlData inputs[MATH_SAMPLES];
+    static SensorsData sensors[MATH_SAMPLES];
+    for (int i = 0; i < MATH_SAMPLES; i++)
+    {
+        float t = (float)i / MATH_SAMPLES;
+        inputs[i].throttle = (int16_t)(1000 * sinf(t * 7.0f));
+        inputs[i].yaw = (int16_t)(600 * sinf(t * 11.0f));
+        inputs[i].pitch = (int16_t)(1000 * sinf(t * 13.0f));
+        inputs[i].roll = (int16_t)(1000 * cosf(t * 17.0f));
+        sensors[i].pitch = (int16_t)(1500 * sinf(t * 19.0f));
+        sensors[i].roll = (int16_t)(1500 * cosf(t * 23.0f));
+        sensors[i].gyroX = (int16_t)(2000 * sinf(t * 29.0f));
+        sensors[i].gyroY = (int16_t)(2000 * cosf(t * 31.0f));
+    }
+    NullActuator *outputs[4] = {&actuators[0], &actuators[1], &actuators[2], &actuators[3]};
+    int i = 0;
+    const uint32_t iterations = BENCHMARK_ITERATIONS;
+
+    BoatMixer<NullActuator> boat(outputs[0], outputs[1]);
+    MatrixMixer<2, NullActuator> boatMatrix(outputs, MIXER_DIFFERENTIAL);
+    uint32_t boatCycles = BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; boat.Update(&inputs[i], &sensors[i]); });
+    uint32_t boatMatrixCycles = BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; boatMatrix.Update(&inputs[i], &sensors[i]); });
+    PrintBenchmark(out, "BoatMixer", boatCycles);
+    PrintBenchmark(out, "MatrixMixer<2> differential", boatMatrixCycles);
+
+    // Same loop gains on both sides, the difference is the mixing
+    BicopterMixer<NullActuator, NullActuator> bicopter(outputs[0], outputs[1], outputs[2], outputs[3]);
+    MatrixMixer<4, NullActuator> bicopterMatrix(outputs, MIXER_BICOPTER);
+    bicopterMatrix.GetPitchController() = bicopter.GetPitchController();
+    bicopterMatrix.GetRollController() = bicopter.GetRollController();
+    uint32_t bicopterCycles = BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; bicopter.Update(&inputs[i], &sensors[i]); });
+    uint32_t bicopterMatrixCycles = BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; bicopterMatrix.Update(&inputs[i], &sensors[i]); });
+    PrintBenchmark(out, "BicopterMixer", bicopterCycles);
+    PrintBenchmark(out, "MatrixMixer<4> bicopter", bicopterMatrixCycles);
+
+    MatrixMixer<4, NullActuator> quad(outputs, MIXER_QUAD_X);
+    quad.GetPitchController() = bicopter.GetPitchController();
+    quad.GetRollController() = bicopter.GetRollController();
+    PrintBenchmark(out, "MatrixMixer<4> quad X", BenchmarkCycles(iterations, [&]() { i = (i + 1) % MATH_SAMPLES; quad.Update(&inputs[i], &sensors[i]); }));
+    out.printf("[bench] saturated ticks: differential %lu, bicopter %lu, quad %lu\n",
+        (unsigned long)boatMatrix.GetSaturatedTicks(), (unsigned long)bicopterMatrix.GetSaturatedTicks(), (unsigned long)quad.GetSaturatedTicks());
+}
+
+#endif
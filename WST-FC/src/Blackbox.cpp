@@ -0,0 +1,98 @@
+#include "Blackbox.h"
+
+Blackbox::Blackbox()
+{
+    _full[0] = false;
+    _full[1] = false;
+}
+
+bool Blackbox::Init()
+{
+    if (_initiated) return true;
+    // The storage reports its own errors
+    if (!_storage.Begin(_session)) return false;
+    if (xTaskCreatePinnedToCore(TaskBody, "blackbox", BLACKBOX_TASK_STACK, this, BLACKBOX_TASK_PRIORITY, &_task, SYSTEM_CORE) != pdPASS)
+    {
+        Serial.println("Blackbox task start failed!");
+        return false;
+    }
+    _initiated = true;
+    return true;
+}
+
+void Blackbox::Append(const BlackboxRecord &record, uint32_t timeUs)
+{
+    // Second pass only after the first block filled up
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        if (!_open)
+        {
+            if (_full[_active].load(std::memory_order_acquire))
+            {
+                _stats.dropped++;
+                if (_droppedSinceBlock < UINT16_MAX) _droppedSinceBlock++;
+                return;
+            }
+            _writer.Begin(_buffers[_active], _session, _sequence++, _droppedSinceBlock);
+            _droppedSinceBlock = 0;
+            _open = true;
+        }
+        if (_writer.Append(record, timeUs))
+        {
+            _stats.records++;
+            return;
+        }
+        Seal();
+    }
+}
+
+void Blackbox::Seal()
+{
+    _writer.Finish();
+    _full[_active].store(true, std::memory_order_release);
+    xTaskNotifyGive(_task);
+    _active ^= 1;
+    _open = false;
+}
+
+void Blackbox::TaskBody(void *arg)
+{
+    Blackbox *self = static_cast<Blackbox *>(arg);
+    bool recycling = false;
+    for (;;)
+    {
+        // A sealed buffer wakes it up, the timeout checks for room to recycle
+        ulTaskNotifyTake(pdTRUE, recycling ? 1 : pdMS_TO_TICKS(BLACKBOX_RECYCLE_CHECK_MS));
+        // Buffers are sealed alternately, so they are written in turn
+        while (self->_full[self->_nextWrite].load(std::memory_order_acquire))
+        {
+            if (self->_storage.WriteBlock(self->_buffers[self->_nextWrite]))
+                self->_stats.blocks++;
+            else if (!self->_storage.IsFull())
+                self->_stats.writeErrors++;
+            self->_full[self->_nextWrite].store(false, std::memory_order_release);
+            self->_nextWrite ^= 1;
+        }
+        // One sector per pass, sealed blocks go first
+        recycling = self->_storage.Recycle(self->_quiet.load(std::memory_order_relaxed));
+        if (recycling) self->_stats.recycled++;
+    }
+}
+
+void Blackbox::PrintStats(Print &out) const
+{
+    if (!_initiated)
+    {
+        out.println("[blackbox] off");
+        return;
+    }
+    BlackboxStats stats = _stats;
+    out.printf("[blackbox] session:%lu %s records:%lu blocks:%lu dropped:%lu errors:%lu recycled:%lu\n",
+        (unsigned long)_session,
+        _storage.IsFull() ? "full" : (_recording ? "recording" : "waiting"),
+        (unsigned long)stats.records,
+        (unsigned long)stats.blocks,
+        (unsigned long)stats.dropped,
+        (unsigned long)stats.writeErrors,
+        (unsigned long)stats.recycled);
+}
@@ -0,0 +1,174 @@
+#include "BlackboxStorage.h"
+
+#if BLACKBOX_STORAGE == 1
+
+bool BlackboxSdStorage::Begin(uint32_t &session)
+{
+    if (!SD_MMC.begin(BLACKBOX_SD_MOUNT, true))
+    {
+        Serial.println("Blackbox SD card init failed!");
+        return false;
+    }
+
+    char path[24];
+    for (session = 1; session <= BLACKBOX_SD_MAX_FILES; session++)
+    {
+        snprintf(path, sizeof(path), "/blackbox_%03lu.bbx", (unsigned long)session);
+        if (!SD_MMC.exists(path)) break;
+    }
+    if (session > BLACKBOX_SD_MAX_FILES)
+    {
+        Serial.println("Blackbox SD card has no free file name!");
+        return false;
+    }
+
+    _file = SD_MMC.open(path, FILE_WRITE);
+    if (!_file)
+    {
+        Serial.println("Blackbox file open failed!");
+        return false;
+    }
+    Serial.printf("Blackbox session %lu: %s\n", (unsigned long)session, path);
+    return true;
+}
+
+bool BlackboxSdStorage::WriteBlock(const uint8_t *block)
+{
+    if (!_file) return false;
+    bool ok = _file.write(block, BLACKBOX_BLOCK_SIZE) == BLACKBOX_BLOCK_SIZE;
+    if (++_written % BLACKBOX_SD_FLUSH_BLOCKS == 0) _file.flush();
+    return ok;
+}
+
+#else
+
+bool BlackboxFlashStorage::ReadHeader(uint32_t block, BlackboxBlockHeader &header) const
+{
+    return esp_partition_read(_partition, block * BLACKBOX_BLOCK_SIZE, &header, sizeof(header)) == ESP_OK &&
+           header.magic == BLACKBOX_MAGIC && header.version == BLACKBOX_VERSION;
+}
+
+// Blocks are programmed header page first, a blank magic means a blank block
+bool BlackboxFlashStorage::IsBlank(uint32_t block) const
+{
+    uint32_t magic = 0;
+    return esp_partition_read(_partition, block * BLACKBOX_BLOCK_SIZE, &magic, sizeof(magic)) == ESP_OK &&
+           magic == 0xFFFFFFFF;
+}
+
+bool BlackboxFlashStorage::Erase(uint32_t first, uint32_t count)
+{
+    if (esp_partition_erase_range(_partition, first * BLACKBOX_BLOCK_SIZE, count * BLACKBOX_BLOCK_SIZE) != ESP_OK)
+    {
+        Serial.println("Blackbox erase failed!");
+        return false;
+    }
+    return true;
+}
+
+bool BlackboxFlashStorage::Begin(uint32_t &session)
+{
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)BLACKBOX_PARTITION_SUBTYPE, BLACKBOX_PARTITION_LABEL);
+    if (_partition == nullptr || _partition->size < 2 * BLACKBOX_BLOCK_SIZE)
+    {
+        Serial.println("Blackbox partition not found!");
+        return false;
+    }
+    _blocks = _partition->size / BLACKBOX_BLOCK_SIZE;
+
+    // Newest block of the newest session, the new one continues after it
+    bool found = false;
+    uint32_t latestSession = 0;
+    uint32_t latestSequence = 0;
+    uint32_t last = 0;
+    for (uint32_t block = 0; block < _blocks; block++)
+    {
+        BlackboxBlockHeader header;
+        if (!ReadHeader(block, header)) continue;
+        if (!found || header.session > latestSession || (header.session == latestSession && header.sequence > latestSequence))
+        {
+            found = true;
+            latestSession = header.session;
+            latestSequence = header.sequence;
+            last = block;
+        }
+    }
+    session = found ? latestSession + 1 : 1;
+    _next = found ? (last + 1) % _blocks : 0;
+
+    // Everything up to the previous session, and its oldest blocks while
+    // that leaves less than half of the partition
+    _free = 0;
+    while (_free < _blocks)
+    {
+        BlackboxBlockHeader header;
+        uint32_t block = (_next + _free) % _blocks;
+        if (found && _free >= _blocks / 2 && ReadHeader(block, header) && header.session == latestSession) break;
+        _free++;
+    }
+
+    uint32_t start = millis();
+    uint32_t runStart = 0;
+    uint32_t runLength = 0;
+    for (uint32_t i = 0; i <= _free; i++)
+    {
+        uint32_t block = (_next + i) % _blocks;
+        bool erase = i < _free && !IsBlank(block);
+        // One erase call per contiguous run, the driver uses 64 kB block erases inside it
+        if (runLength > 0 && (!erase || block != runStart + runLength))
+        {
+            if (!Erase(runStart, runLength)) return false;
+            runLength = 0;
+        }
+        if (erase)
+        {
+            if (runLength == 0) runStart = block;
+            runLength++;
+        }
+    }
+
+    Serial.printf("Blackbox session %lu: %lu kB free (%lu s at %lu Hz, %lu s in the partition), erased in %lu ms\n",
+        (unsigned long)session,
+        (unsigned long)(_free * BLACKBOX_BLOCK_SIZE / 1024),
+        (unsigned long)(_free * BLACKBOX_BLOCK_SIZE / BLACKBOX_BYTES_PER_SECOND),
+        (unsigned long)(CONTROL_LOOP_HZ / BLACKBOX_RATE_DIVIDER),
+        (unsigned long)(_blocks * BLACKBOX_BLOCK_SIZE / BLACKBOX_BYTES_PER_SECOND),
+        (unsigned long)(millis() - start));
+    return true;
+}
+
+bool BlackboxFlashStorage::Recycle(bool quiet)
+{
+    // Quiet: half of the partition ahead of the writer, like Begin() leaves
+    // it. In motion just enough that the writer never runs out.
+    uint32_t target = quiet ? _blocks / 2 : (BLACKBOX_RECYCLE_IN_MOTION ? BLACKBOX_FLASH_MIN_FREE : 0);
+    if (_free >= target) return false;
+
+    // Oldest block of the ring, after the erased ones
+    uint32_t block = (_next + _free) % _blocks;
+    if (!IsBlank(block) && !Erase(block, 1)) return false;
+    _free++;
+    return true;
+}
+
+bool BlackboxFlashStorage::WriteBlock(const uint8_t *block)
+{
+    if (_free == 0) return false;
+    uint32_t offset = _next * BLACKBOX_BLOCK_SIZE;
+    _next = (_next + 1) % _blocks;
+    _free--;
+
+    // Pages past the last record stay erased
+    BlackboxBlockHeader header;
+    memcpy(&header, block, sizeof(header));
+    uint32_t length = sizeof(header) + header.used;
+    for (uint32_t page = 0; page < length; page += BLACKBOX_FLASH_PAGE)
+    {
+        if (esp_partition_write(_partition, offset + page, block + page, BLACKBOX_FLASH_PAGE) != ESP_OK) return false;
+        // Let the control task run between cache stalls
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+#endif
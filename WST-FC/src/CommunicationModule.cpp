@@ -1,9 +1,18 @@
 #include "CommunicationModule.h"
 #include "Configuration.h"
 
-CommunicationModule::CommunicationModule(DroneControlData *dataPtr, DroneStatus *status)
+CommunicationModule::CommunicationModule(SeqLock<DroneControlData> *dataPtr, DroneStatus *status, SeqLock<SensorsData> *telemetry)
 {
     sharedData = dataPtr;
+    telemetryData = telemetry;
+    droneStatus = status;
+}
+
+CommunicationModule::CommunicationModule(ICommunicationInterface *interface, DroneStatus *status)
+{
+    sharedData = nullptr;
+    telemetryData = nullptr;
+    communicationInterface = interface;
     droneStatus = status;
 }
 
@@ -13,10 +22,10 @@ void CommunicationModule::Init()
         communicationInterface = new CommunicationWiFiUDPModule(sharedData, UDP_CONTROLL_PORT, droneStatus);
     }
     if(COMMUNICATION_METHOD == 1){
-        communicationInterface = new CommunicationESPNowModule(sharedData, droneStatus);
+        communicationInterface = new CommunicationESPNowModule(sharedData, droneStatus, telemetryData);
     }
     if(COMMUNICATION_METHOD == 2){
-        communicationInterface = new CommunicationSerialModule(sharedData, droneStatus);
+        communicationInterface = new CommunicationSerialModule(sharedData, droneStatus, telemetryData);
     }
     if(COMMUNICATION_METHOD == 3){
         communicationInterface = new CommunicationGamepadModule(sharedData, droneStatus);
@@ -39,4 +48,9 @@ void CommunicationModule::SendData(SensorsData* data)
 {
     if(communicationInterface == nullptr) return;
     communicationInterface->SendData(data);
+}
+void CommunicationModule::PrintStats(Print &out)
+{
+    if(communicationInterface == nullptr) return;
+    communicationInterface->PrintStats(out);
 }
\ No newline at end of file
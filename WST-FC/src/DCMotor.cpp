@@ -0,0 +1,186 @@
+#include "DCMotor.h"
+
+// 80 MHz group clock, 10 MHz timers: 500 duty steps at 20 kHz
+#define DC_MOTOR_GROUP_RESOLUTION_HZ 80000000
+#define DC_MOTOR_TIMER_RESOLUTION_HZ 10000000
+// LEDC fallback, 80 MHz / 2^10 leaves room up to ~78 kHz
+#define DC_MOTOR_LEDC_BITS 10
+
+void DCMotor::Init()
+{
+#if SOC_MCPWM_SUPPORTED
+    _unit = (mcpwm_unit_t)(_config.pwmChannel / 3);
+    _timer = (mcpwm_timer_t)(_config.pwmChannel % 3);
+    mcpwm_io_signals_t signalA = (mcpwm_io_signals_t)(MCPWM0A + 2 * _timer);
+    mcpwm_io_signals_t signalB = (mcpwm_io_signals_t)(MCPWM0B + 2 * _timer);
+
+    if (_config.wiring == DC_WIRING_DIR_EN)
+    {
+        mcpwm_gpio_init(_unit, signalA, _config.enablePin);
+        pinMode(_config.pin1, OUTPUT);
+        pinMode(_config.pin2, OUTPUT);
+        digitalWrite(_config.pin1, LOW);
+        digitalWrite(_config.pin2, LOW);
+    }
+    else
+    {
+        mcpwm_gpio_init(_unit, signalA, _config.pin1);
+        mcpwm_gpio_init(_unit, signalB, _config.pin2);
+    }
+
+    mcpwm_group_set_resolution(_unit, DC_MOTOR_GROUP_RESOLUTION_HZ);
+    mcpwm_timer_set_resolution(_unit, _timer, DC_MOTOR_TIMER_RESOLUTION_HZ);
+    mcpwm_config_t pwmConfig = {};
+    pwmConfig.frequency = _config.frequencyHz;
+    pwmConfig.cmpr_a = 0;
+    pwmConfig.cmpr_b = 0;
+    pwmConfig.counter_mode = MCPWM_UP_COUNTER;
+    pwmConfig.duty_mode = MCPWM_DUTY_MODE_0;
+    if (mcpwm_init(_unit, _timer, &pwmConfig) != ESP_OK)
+    {
+        Serial.println("DCMotor MCPWM init failed!");
+        return;
+    }
+
+    // B follows A inverted, with both switches off for deadTimeNs around
+    // every edge, so the off phase is driven through the low side
+    if (_config.wiring == DC_WIRING_HALF_BRIDGE && _config.decay == DC_DECAY_BRAKE)
+    {
+        uint32_t delay = _config.deadTimeNs / 100;
+        mcpwm_deadtime_enable(_unit, _timer, MCPWM_ACTIVE_HIGH_COMPLIMENT_MODE, delay, delay);
+    }
+#else
+    if (_config.wiring == DC_WIRING_HALF_BRIDGE)
+    {
+        Serial.println("DCMotor half-bridge wiring needs MCPWM!");
+        return;
+    }
+    ledcSetup(_config.pwmChannel, _config.frequencyHz, DC_MOTOR_LEDC_BITS);
+    int pins[3] = {_config.pin1, _config.pin2, _config.enablePin};
+    for (int pin : pins)
+    {
+        if (pin < 0) continue;
+        pinMode(pin, OUTPUT);
+        digitalWrite(pin, LOW);
+    }
+#endif
+
+    _initiated = true;
+    // Forces the first write
+    _direction = 2;
+    Apply(0, 0);
+}
+
+void DCMotor::SetLeg(uint8_t leg, Leg state, uint32_t duty)
+{
+#if SOC_MCPWM_SUPPORTED
+    mcpwm_generator_t generator = leg == 0 ? MCPWM_GEN_A : MCPWM_GEN_B;
+    if (state == LEG_PWM)
+    {
+        mcpwm_set_duty(_unit, _timer, generator, duty * 0.1f);
+        // The generator actions only change after it was forced high or low
+        if (!_legPwm[leg]) mcpwm_set_duty_type(_unit, _timer, generator, MCPWM_DUTY_MODE_0);
+    }
+    else if (state == LEG_HIGH)
+    {
+        mcpwm_set_signal_high(_unit, _timer, generator);
+    }
+    else
+    {
+        mcpwm_set_signal_low(_unit, _timer, generator);
+    }
+    _legPwm[leg] = state == LEG_PWM;
+#else
+    int pin = _config.wiring == DC_WIRING_DIR_EN ? _config.enablePin : (leg == 0 ? _config.pin1 : _config.pin2);
+    if (state == LEG_PWM)
+    {
+        if (_ledcPin != pin)
+        {
+            ledcAttachPin(pin, _config.pwmChannel);
+            _ledcPin = pin;
+        }
+        ledcWrite(_config.pwmChannel, duty * ((1 << DC_MOTOR_LEDC_BITS) - 1) / 1000);
+    }
+    else
+    {
+        if (_ledcPin == pin)
+        {
+            ledcDetachPin(pin);
+            pinMode(pin, OUTPUT);
+            _ledcPin = -1;
+        }
+        digitalWrite(pin, state == LEG_HIGH ? HIGH : LOW);
+    }
+#endif
+}
+
+void DCMotor::Apply(int8_t direction, uint32_t duty)
+{
+    TRACE_SCOPE("DCMotor::Apply");
+    bool brake = _config.decay == DC_DECAY_BRAKE;
+    bool directionChanged = direction != _direction;
+
+    if (_config.wiring == DC_WIRING_DIR_EN)
+    {
+        // Decay only picks what a stop does, the L298N style EN input has no
+        // slow decay PWM
+        if (directionChanged)
+        {
+            bool in1 = direction > 0 || (direction == 0 && brake);
+            bool in2 = direction < 0 || (direction == 0 && brake);
+            digitalWrite(_config.pin1, in1 ? HIGH : LOW);
+            digitalWrite(_config.pin2, in2 ? HIGH : LOW);
+        }
+        if (direction == 0)
+        {
+            if (directionChanged) SetLeg(0, brake ? LEG_HIGH : LEG_LOW, 0);
+        }
+        else
+        {
+            SetLeg(0, LEG_PWM, duty);
+        }
+    }
+    else if (_config.wiring == DC_WIRING_HALF_BRIDGE)
+    {
+        // B is the complement of A (brake) or stays low (coast)
+        if (direction == 0)
+        {
+            if (directionChanged) SetLeg(0, LEG_LOW, 0);
+        }
+        else
+        {
+            SetLeg(0, LEG_PWM, duty);
+        }
+        if (_direction == 2 && !brake) SetLeg(1, LEG_LOW, 0);
+    }
+    else
+    {
+        // The driven leg: PWM against low (coast) or high against inverted PWM (brake)
+        uint8_t driven = direction < 0 ? 1 : 0;
+        uint8_t other = 1 - driven;
+        Leg idle = brake ? LEG_HIGH : LEG_LOW;
+        if (direction == 0)
+        {
+            if (directionChanged)
+            {
+                SetLeg(0, idle, 0);
+                SetLeg(1, idle, 0);
+            }
+        }
+        else if (brake)
+        {
+            // Static leg first, the LEDC fallback frees its channel there
+            if (directionChanged) SetLeg(driven, LEG_HIGH, 0);
+            SetLeg(other, LEG_PWM, 1000 - duty);
+        }
+        else
+        {
+            if (directionChanged) SetLeg(other, LEG_LOW, 0);
+            SetLeg(driven, LEG_PWM, duty);
+        }
+    }
+
+    _direction = direction;
+    _duty = duty;
+    _writes++;
+}
@@ -0,0 +1,194 @@
+#include "DShotActuator.h"
+
+// 12.5 ns ticks, a DShot600 bit is 133 of them
+#define DSHOT_RMT_CLK_DIV 1
+#define DSHOT_RMT_TICKS_PER_SECOND 80000000UL
+// Reply bits come at 5/4 of the command bit rate
+#define DSHOT_REPLY_BITS 21
+// Longer than any run in a reply, shorter than the ~30 us the ESC waits
+// before answering, so our own frame and the reply land in separate buffers
+#define DSHOT_RX_IDLE_BITS 10
+// APB ticks, drops glitches from the slow open-drain edges
+#define DSHOT_RX_FILTER_TICKS 20
+#define DSHOT_RX_BUFFER 1024
+// Reply meaning "not spinning"
+#define DSHOT_ERPM_STOPPED 0x0FFF
+
+// 5 bit GCR code -> nibble, 0xFF for codes that are never sent
+static const uint8_t GCR_DECODE[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x9, 0xA, 0xB, 0xFF, 0xD, 0xE, 0xF,
+    0xFF, 0xFF, 0x2, 0x3, 0xFF, 0x5, 0x6, 0x7, 0xFF, 0x0, 0x8, 0x1, 0xFF, 0x4, 0xC, 0xFF};
+
+DShotActuator::DShotActuator(int pin, int txChannel, int rxChannel, uint8_t motorPoles)
+    : _pin(pin), _txChannel((rmt_channel_t)txChannel), _rxChannel(rxChannel), _poles(motorPoles > 0 ? motorPoles : 2)
+{
+    // T1H = 3/4 and T0H = 3/8 of the bit
+    _bitTicks = DSHOT_RMT_TICKS_PER_SECOND / (DSHOT_SPEED * 1000UL);
+    _oneHighTicks = _bitTicks * 3 / 4;
+    _zeroHighTicks = _bitTicks * 3 / 8;
+}
+
+void DShotActuator::Init()
+{
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)_pin, _txChannel);
+    config.clk_div = DSHOT_RMT_CLK_DIV;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = IsBidirectional() ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(_txChannel, 0, 0) != ESP_OK)
+    {
+        Serial.println("DShot RMT TX init failed!");
+        return;
+    }
+
+    if (IsBidirectional())
+    {
+        rmt_channel_t rxChannel = (rmt_channel_t)_rxChannel;
+        rmt_config_t rxConfig = RMT_DEFAULT_CONFIG_RX((gpio_num_t)_pin, rxChannel);
+        rxConfig.clk_div = DSHOT_RMT_CLK_DIV;
+        rxConfig.rx_config.filter_en = true;
+        rxConfig.rx_config.filter_ticks_thresh = DSHOT_RX_FILTER_TICKS;
+        rxConfig.rx_config.idle_threshold = _bitTicks * DSHOT_RX_IDLE_BITS;
+        if (rmt_config(&rxConfig) != ESP_OK || rmt_driver_install(rxChannel, DSHOT_RX_BUFFER, 0) != ESP_OK)
+        {
+            Serial.println("DShot RMT RX init failed!");
+            return;
+        }
+        rmt_get_ringbuf_handle(rxChannel, &_ringbuf);
+
+        // Both channels stay routed to the pin. Open-drain, so the ESC can pull
+        // the line low for its reply while our output idles high.
+        gpio_set_direction((gpio_num_t)_pin, GPIO_MODE_INPUT_OUTPUT_OD);
+        gpio_set_pull_mode((gpio_num_t)_pin, GPIO_PULLUP_ONLY);
+        rmt_rx_start(rxChannel, true);
+    }
+
+    _initiated = true;
+    Set(0);
+}
+
+void DShotActuator::Encode(uint16_t value)
+{
+    // 11 bit value, telemetry request bit (unused, eRPM comes without it), 4 bit CRC
+    uint16_t packet = value << 1;
+    uint16_t crc = (packet ^ (packet >> 4) ^ (packet >> 8)) & 0x0F;
+    if (IsBidirectional()) crc = ~crc & 0x0F;
+    packet = (packet << 4) | crc;
+
+    uint32_t active = IsBidirectional() ? 0 : 1;
+    for (uint8_t bit = 0; bit < 16; bit++)
+    {
+        uint16_t high = (packet & (0x8000 >> bit)) ? _oneHighTicks : _zeroHighTicks;
+        rmt_item32_t &item = _frame[bit];
+        item.level0 = active;
+        item.duration0 = high;
+        item.level1 = !active;
+        item.duration1 = _bitTicks - high;
+    }
+    _frame[16].val = 0;
+}
+
+int8_t DShotActuator::DecodeTelemetry(const rmt_item32_t *items, size_t count, uint32_t &erpm) const
+{
+    // Rebuild the GCR bits from the run lengths: every level change is a 1.
+    // The reply starts with a falling edge, the last high run merges into idle.
+    uint16_t replyBitTicks = _bitTicks * 4 / 5;
+    uint32_t value = 0;
+    int bits = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint32_t durations[2] = {items[i].duration0, items[i].duration1};
+        for (uint8_t half = 0; half < 2; half++)
+        {
+            if (durations[half] == 0) continue;
+            int run = (durations[half] + replyBitTicks / 2) / replyBitTicks;
+            // Shorter than a reply bit, this is our own command frame
+            if (run == 0) return 0;
+            bits += run;
+            if (bits > DSHOT_REPLY_BITS) return -1;
+            value = (value << run) | (1UL << (run - 1));
+        }
+    }
+    if (bits == 0) return 0;
+    int tail = DSHOT_REPLY_BITS - bits;
+    if (tail > 0) value = (value << tail) | (1UL << (tail - 1));
+
+    // Drop the start bit, 4 GCR quintets -> 16 bits: eeem mmmm mmmm cccc
+    value &= 0xFFFFF;
+    uint32_t decoded = 0;
+    for (uint8_t nibble = 0; nibble < 4; nibble++)
+    {
+        uint8_t code = GCR_DECODE[(value >> (5 * nibble)) & 0x1F];
+        if (code == 0xFF) return -1;
+        decoded |= (uint32_t)code << (4 * nibble);
+    }
+    uint32_t checksum = decoded ^ (decoded >> 8);
+    checksum ^= checksum >> 4;
+    if ((checksum & 0x0F) != 0x0F) return -1;
+
+    uint32_t data = decoded >> 4;
+    if (data == DSHOT_ERPM_STOPPED)
+    {
+        erpm = 0;
+        return 1;
+    }
+    // Period of one electrical revolution in us, 9 bit mantissa << 3 bit exponent
+    uint32_t periodUs = (data & 0x1FF) << (data >> 9);
+    if (periodUs == 0) return -1;
+    erpm = 60000000UL / periodUs;
+    return 1;
+}
+
+void DShotActuator::ReadTelemetry()
+{
+    size_t length = 0;
+    rmt_item32_t *items;
+    while ((items = (rmt_item32_t *)xRingbufferReceive(_ringbuf, &length, 0)) != nullptr)
+    {
+        uint32_t erpm = 0;
+        int8_t result = DecodeTelemetry(items, length / sizeof(rmt_item32_t), erpm);
+        vRingbufferReturnItem(_ringbuf, items);
+        if (result > 0)
+        {
+            _erpm = erpm;
+            _telemetryFrames++;
+        }
+        else if (result < 0)
+        {
+            _telemetryErrors++;
+        }
+    }
+}
+
+void DShotActuator::Set(int16_t speed)
+{
+    TRACE_SCOPE("DShotActuator::Set");
+    if (!_initiated) return;
+    if (speed < 0) speed = 0;
+    if (speed > 1000) speed = 1000;
+
+    // The reply to the previous frame, it arrived ~30 us after it
+    if (IsBidirectional()) ReadTelemetry();
+
+    uint16_t value = speed == 0 ? 0 : DSHOT_THROTTLE_MIN + (uint32_t)speed * (DSHOT_THROTTLE_MAX - DSHOT_THROTTLE_MIN) / 1000;
+    Encode(value);
+    rmt_write_items(_txChannel, _frame, DSHOT_FRAME_ITEMS, false);
+}
+
+DShotTelemetry::DShotTelemetry(DShotActuator *const *motors, uint8_t count)
+{
+    _count = count < 4 ? count : 4;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        _motors[i] = motors[i];
+    }
+}
+
+void DShotTelemetry::Update(SensorsData *data)
+{
+    TRACE_SCOPE("DShotTelemetry::Update");
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        uint32_t rpm = _motors[i]->GetRpm();
+        data->motorRpm[i] = rpm > 0xFFFF ? 0xFFFF : (uint16_t)rpm;
+    }
+}
@@ -0,0 +1,245 @@
+#include "I2CBus.h"
+#include <esp_timer.h>
+
+#define I2C_TASK_STACK 4096
+
+// TwoWire::endTransmission results
+#define I2C_RESULT_NACK_ADDRESS 2
+#define I2C_RESULT_NACK_DATA 3
+#define I2C_RESULT_TIMEOUT 5
+
+bool I2CBus::Begin(int sda, int scl, uint32_t clockHz, UBaseType_t priority, BaseType_t core)
+{
+    _sda = sda < 0 ? SDA : sda;
+    _scl = scl < 0 ? SCL : scl;
+    _clockHz = clockHz;
+
+    if (!Wire.begin(_sda, _scl, _clockHz)) return false;
+    _currentTimeoutMs = I2C_DEFAULT_TIMEOUT_MS;
+    Wire.setTimeOut(_currentTimeoutMs);
+
+    _queue = xQueueCreate(I2C_QUEUE_LENGTH, sizeof(I2CTransaction));
+    _mutex = xSemaphoreCreateMutex();
+    if (_queue == nullptr || _mutex == nullptr) return false;
+
+    _stats.sinceUs = esp_timer_get_time();
+    core = (portNUM_PROCESSORS > 1) ? core : 0;
+    return xTaskCreatePinnedToCore(TaskBody, "i2c", I2C_TASK_STACK, this, priority, &_task, core) == pdPASS;
+}
+
+bool I2CBus::Enqueue(I2CTransaction &transaction)
+{
+    if (_queue == nullptr) return false;
+    transaction.queuedUs = esp_timer_get_time();
+    if (xQueueSend(_queue, &transaction, 0) != pdTRUE)
+    {
+        _stats.dropped++;
+        return false;
+    }
+    uint32_t depth = uxQueueMessagesWaiting(_queue);
+    if (depth > _stats.maxQueueDepth) _stats.maxQueueDepth = depth;
+    return true;
+}
+
+bool I2CBus::Read(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t length, I2CCallback callback, void *context, uint16_t timeoutMs)
+{
+    I2CTransaction transaction;
+    transaction.address = address;
+    transaction.reg = reg;
+    transaction.buffer = buffer;
+    transaction.length = length;
+    transaction.timeoutMs = timeoutMs;
+    transaction.callback = callback;
+    transaction.context = context;
+    return Enqueue(transaction);
+}
+
+bool I2CBus::Write(uint8_t address, uint8_t reg, uint8_t value, I2CCallback callback, void *context, uint16_t timeoutMs)
+{
+    I2CTransaction transaction;
+    transaction.address = address;
+    transaction.reg = reg;
+    transaction.value = value;
+    transaction.length = 1;
+    transaction.write = true;
+    transaction.timeoutMs = timeoutMs;
+    transaction.callback = callback;
+    transaction.context = context;
+    return Enqueue(transaction);
+}
+
+bool I2CBus::ReadSync(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t length, uint16_t timeoutMs)
+{
+    I2CTransaction transaction;
+    transaction.address = address;
+    transaction.reg = reg;
+    transaction.buffer = buffer;
+    transaction.length = length;
+    transaction.timeoutMs = timeoutMs;
+    transaction.queuedUs = esp_timer_get_time();
+
+    Lock();
+    bool ok = Transfer(transaction);
+    Unlock();
+    return ok;
+}
+
+bool I2CBus::WriteSync(uint8_t address, uint8_t reg, uint8_t value, uint16_t timeoutMs)
+{
+    I2CTransaction transaction;
+    transaction.address = address;
+    transaction.reg = reg;
+    transaction.value = value;
+    transaction.length = 1;
+    transaction.write = true;
+    transaction.timeoutMs = timeoutMs;
+    transaction.queuedUs = esp_timer_get_time();
+
+    Lock();
+    bool ok = Transfer(transaction);
+    Unlock();
+    return ok;
+}
+
+void I2CBus::Lock()
+{
+    if (_mutex != nullptr) xSemaphoreTake(_mutex, portMAX_DELAY);
+}
+
+void I2CBus::Unlock()
+{
+    if (_mutex != nullptr) xSemaphoreGive(_mutex);
+}
+
+bool I2CBus::Transfer(I2CTransaction &transaction)
+{
+    if (transaction.timeoutMs != _currentTimeoutMs)
+    {
+        _currentTimeoutMs = transaction.timeoutMs;
+        Wire.setTimeOut(_currentTimeoutMs);
+    }
+
+    int64_t start = esp_timer_get_time();
+    Wire.beginTransmission(transaction.address);
+    Wire.write(transaction.reg);
+    if (transaction.write)
+    {
+        if (transaction.buffer != nullptr) Wire.write(transaction.buffer, transaction.length);
+        else Wire.write(transaction.value);
+    }
+    uint8_t result = Wire.endTransmission(transaction.write);
+
+    bool ok = result == 0;
+    if (ok && !transaction.write)
+    {
+        ok = Wire.requestFrom(transaction.address, transaction.length) == transaction.length
+            && Wire.readBytes(transaction.buffer, transaction.length) == transaction.length;
+        if (!ok) result = 0xFF;
+    }
+
+    int64_t end = esp_timer_get_time();
+    _stats.busyUs += end - start;
+    _stats.transactions++;
+    uint32_t latency = (uint32_t)(end - transaction.queuedUs);
+    _stats.latencySumUs += latency;
+    if (latency > _stats.maxLatencyUs) _stats.maxLatencyUs = latency;
+
+    if (ok)
+    {
+        _stats.bytes += transaction.length;
+    }
+    else if (result == I2C_RESULT_NACK_ADDRESS || result == I2C_RESULT_NACK_DATA)
+    {
+        // Missing or busy device, the bus itself is idle
+        _stats.nacks++;
+    }
+    else
+    {
+        if (result == I2C_RESULT_TIMEOUT) _stats.timeouts++;
+        else _stats.errors++;
+        Recover();
+    }
+    return ok;
+}
+
+// A slave reset mid-byte can hold SDA low forever. Up to nine SCL pulses
+// let it finish the byte, then a STOP puts the bus back to idle.
+void I2CBus::Recover()
+{
+    _stats.recoveries++;
+    Wire.end();
+
+    pinMode(_sda, INPUT_PULLUP);
+    pinMode(_scl, OUTPUT_OPEN_DRAIN);
+    digitalWrite(_scl, HIGH);
+    for (uint8_t i = 0; i < 9 && digitalRead(_sda) == LOW; i++)
+    {
+        digitalWrite(_scl, LOW);
+        delayMicroseconds(5);
+        digitalWrite(_scl, HIGH);
+        delayMicroseconds(5);
+    }
+
+    pinMode(_sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(_sda, LOW);
+    delayMicroseconds(5);
+    digitalWrite(_scl, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(_sda, HIGH);
+    delayMicroseconds(5);
+
+    Wire.begin(_sda, _scl, _clockHz);
+    Wire.setTimeOut(_currentTimeoutMs);
+}
+
+void I2CBus::TaskBody(void *arg)
+{
+    I2CBus *bus = static_cast<I2CBus *>(arg);
+    I2CTransaction transaction;
+
+    for (;;)
+    {
+        if (xQueueReceive(bus->_queue, &transaction, portMAX_DELAY) != pdTRUE) continue;
+
+        // Nobody is waiting for a result this old any more
+        if (esp_timer_get_time() - transaction.queuedUs > (int64_t)transaction.timeoutMs * 1000)
+        {
+            bus->_stats.timeouts++;
+            if (transaction.callback != nullptr) transaction.callback(transaction.context, false);
+            continue;
+        }
+
+        bus->Lock();
+        bool ok = bus->Transfer(transaction);
+        bus->Unlock();
+
+        if (transaction.callback != nullptr) transaction.callback(transaction.context, ok);
+    }
+}
+
+void I2CBus::ResetStats()
+{
+    _stats = I2CBusStats();
+    _stats.sinceUs = esp_timer_get_time();
+}
+
+void I2CBus::PrintStats(Print &out) const
+{
+    I2CBusStats stats = _stats;
+    uint32_t transactions = stats.transactions > 0 ? stats.transactions : 1;
+    int64_t elapsed = esp_timer_get_time() - stats.sinceUs;
+
+    out.printf("[i2c] %lukHz transactions:%lu bytes:%lu busy:%.1f%% latency avg/max:%lu/%luus nacks:%lu timeouts:%lu errors:%lu recoveries:%lu dropped:%lu queue max:%lu\n",
+        (unsigned long)(_clockHz / 1000),
+        (unsigned long)stats.transactions,
+        (unsigned long)stats.bytes,
+        elapsed > 0 ? 100.0f * stats.busyUs / elapsed : 0.0f,
+        (unsigned long)(stats.latencySumUs / transactions),
+        (unsigned long)stats.maxLatencyUs,
+        (unsigned long)stats.nacks,
+        (unsigned long)stats.timeouts,
+        (unsigned long)stats.errors,
+        (unsigned long)stats.recoveries,
+        (unsigned long)stats.dropped,
+        (unsigned long)stats.maxQueueDepth);
+}
@@ -1,28 +1,112 @@
 #include "SensorsModule.h"
+#include <esp_timer.h>
 
-SensorsModule::SensorsModule(SensorsData *data)
+SensorsModule::SensorsModule(SensorsData *data, SeqLock<SensorsData> *channel, uint32_t budgetUs)
 {
     sensorData = data;
+    sensorChannel = channel;
+    _budgetUs = budgetUs;
 }
 
-void SensorsModule::AddSensor(ISensor *sensor)
+void SensorsModule::AddSensor(ISensor *sensor, const char *name, float rateHz, uint8_t priority, uint32_t costUs)
 {
-    _sensors.push_back(sensor);
+    ScheduledSensor entry;
+    entry.sensor = sensor;
+    entry.name = name;
+    entry.schedule = SensorSchedule(SensorPeriodUs(rateHz), priority, costUs);
+
+    // Stable: after every sensor of the same or higher priority
+    auto position = _sensors.begin();
+    while (position != _sensors.end() && position->schedule.priority >= priority) ++position;
+    _sensors.insert(position, entry);
 }
 
 void SensorsModule::Init()
 {
-    Wire.begin();
-    for (auto sensor : _sensors)
+    for (auto &entry : _sensors)
+    {
+        entry.sensor->Init();
+    }
+
+    int64_t now = esp_timer_get_time();
+    uint32_t phase = 0;
+    for (auto &entry : _sensors)
     {
-        sensor->Init();
+        entry.schedule.Start(now, phase);
     }
+    _statsSinceUs = now;
 }
 
 void SensorsModule::Loop()
 {
-    for (auto sensor : _sensors)
+    SensorTick tick(esp_timer_get_time(), _budgetUs);
+
+    for (auto &entry : _sensors)
     {
-        sensor->Update(sensorData);
+        int64_t now = esp_timer_get_time();
+        if (!entry.schedule.Admit(tick, now)) continue;
+        entry.sensor->Update(sensorData);
+        entry.schedule.Ran(tick, now, esp_timer_get_time());
+    }
+
+    _ticks++;
+    if ((uint32_t)(esp_timer_get_time() - tick.startUs) > _budgetUs) _overBudgetTicks++;
+
+    if (sensorChannel != nullptr)
+        sensorChannel->Publish(*sensorData, micros());
+}
+
+const char *SensorsModule::GetSensorName(uint8_t index) const
+{
+    if (index >= _sensors.size()) return nullptr;
+    return _sensors[index].name;
+}
+
+SensorStats SensorsModule::GetStats(uint8_t index) const
+{
+    if (index >= _sensors.size()) return SensorStats();
+    return _sensors[index].schedule.stats;
+}
+
+float SensorsModule::GetRate(uint8_t index) const
+{
+    int64_t elapsed = esp_timer_get_time() - _statsSinceUs;
+    if (index >= _sensors.size() || elapsed <= 0) return 0.0f;
+    return _sensors[index].schedule.stats.runs * 1000000.0f / elapsed;
+}
+
+void SensorsModule::ResetStats()
+{
+    for (auto &entry : _sensors)
+    {
+        entry.schedule.stats = SensorStats();
+    }
+    _ticks = 0;
+    _overBudgetTicks = 0;
+    _statsSinceUs = esp_timer_get_time();
+}
+
+void SensorsModule::PrintStats(Print &out) const
+{
+    out.printf("[sensors] ticks:%lu over budget (%luus):%lu\n",
+        (unsigned long)_ticks, (unsigned long)_budgetUs, (unsigned long)_overBudgetTicks);
+    for (uint8_t i = 0; i < _sensors.size(); i++)
+    {
+        const SensorSchedule &schedule = _sensors[i].schedule;
+        SensorStats stats = schedule.stats;
+        uint32_t runs = stats.runs > 0 ? stats.runs : 1;
+        float target = schedule.periodUs > 0 ? 1000000.0f / schedule.periodUs : (float)CONTROL_LOOP_HZ;
+
+        out.printf("[sensor %s] prio:%u rate:%.1f/%.1fHz runs:%lu missed:%lu deferred:%lu exec avg/max:%lu/%luus cost:%luus\n",
+            _sensors[i].name,
+            (unsigned)schedule.priority,
+            GetRate(i),
+            target,
+            (unsigned long)stats.runs,
+            (unsigned long)stats.missedDeadlines,
+            (unsigned long)stats.deferred,
+            (unsigned long)(stats.execSumUs / runs),
+            (unsigned long)stats.maxExecUs,
+            (unsigned long)schedule.costUs);
     }
 }
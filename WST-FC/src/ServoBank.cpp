@@ -0,0 +1,136 @@
+#include "ServoBank.h"
+#if SOC_MCPWM_SUPPORTED
+
+#define SERVO_GROUP_RESOLUTION_HZ 80000000UL
+// MCPWM timers count 16 bits
+#define SERVO_MAX_PERIOD_TICKS 65535UL
+// Off time kept at the end of the period when an endpoint would not fit
+#define SERVO_MIN_GAP_US 20.0f
+
+ServoBank::ServoBank(int unit, uint32_t rateHz)
+    : _unit((mcpwm_unit_t)unit), _rateHz(rateHz > 0 ? rateHz : 50)
+{
+}
+
+int ServoBank::AddChannel(const ServoChannelConfig &config)
+{
+    if (_initiated || _count >= SERVO_BANK_MAX_CHANNELS) return -1;
+    _channels[_count] = config;
+    _staged[_count] = config.centerUs + config.trimUs;
+    return _count++;
+}
+
+float ServoBank::Clamp(uint8_t channel, float pulseUs) const
+{
+    const ServoChannelConfig &config = _channels[channel];
+    if (pulseUs < config.minUs) return config.minUs;
+    if (pulseUs > config.maxUs) return config.maxUs;
+    return pulseUs;
+}
+
+bool ServoBank::Init()
+{
+    if (_initiated) return true;
+    if (_count == 0) return false;
+
+    // Finest timer clock whose 16 bit counter still spans the period
+    uint32_t prescale = (SERVO_GROUP_RESOLUTION_HZ + SERVO_MAX_PERIOD_TICKS * _rateHz - 1) / (SERVO_MAX_PERIOD_TICKS * _rateHz);
+    if (prescale < 1) prescale = 1;
+    if (prescale > 256) prescale = 256;
+    uint32_t timerResolution = SERVO_GROUP_RESOLUTION_HZ / prescale;
+
+    float periodUs = 1000000.0f / _rateHz;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        ServoChannelConfig &config = _channels[i];
+        if (config.maxUs > periodUs - SERVO_MIN_GAP_US)
+        {
+            Serial.printf("Servo %u: %.0f us endpoint does not fit %lu Hz\n", (unsigned)i, config.maxUs, (unsigned long)_rateHz);
+            config.maxUs = periodUs - SERVO_MIN_GAP_US;
+        }
+        mcpwm_gpio_init(_unit, (mcpwm_io_signals_t)(MCPWM0A + i), config.pin);
+    }
+
+    mcpwm_group_set_resolution(_unit, SERVO_GROUP_RESOLUTION_HZ);
+    uint8_t timers = (_count + 1) / 2;
+    for (uint8_t t = 0; t < timers; t++)
+    {
+        mcpwm_timer_t timer = (mcpwm_timer_t)t;
+        mcpwm_timer_set_resolution(_unit, timer, timerResolution);
+        mcpwm_config_t pwmConfig = {};
+        pwmConfig.frequency = _rateHz;
+        pwmConfig.cmpr_a = 0;
+        pwmConfig.cmpr_b = 0;
+        pwmConfig.counter_mode = MCPWM_UP_COUNTER;
+        pwmConfig.duty_mode = MCPWM_DUTY_MODE_0;
+        if (mcpwm_init(_unit, timer, &pwmConfig) != ESP_OK)
+        {
+            Serial.println("Servo MCPWM init failed!");
+            return false;
+        }
+    }
+
+    // Timers 1 and 2 restart whenever timer 0 wraps, one period boundary for all
+    if (timers > 1)
+    {
+        mcpwm_set_timer_sync_output(_unit, MCPWM_TIMER_0, MCPWM_SWSYNC_SOURCE_TEZ);
+        mcpwm_sync_config_t syncConfig = {};
+        syncConfig.sync_sig = MCPWM_SELECT_TIMER0_SYNC;
+        syncConfig.timer_val = 0;
+        syncConfig.count_direction = MCPWM_TIMER_DIRECTION_UP;
+        for (uint8_t t = 1; t < timers; t++)
+        {
+            mcpwm_sync_configure(_unit, (mcpwm_timer_t)t, &syncConfig);
+        }
+    }
+
+    _initiated = true;
+    _pending = (1 << _count) - 1;
+    Commit();
+    return true;
+}
+
+void ServoBank::SetPulse(uint8_t channel, float commandUs)
+{
+    if (channel >= _count) return;
+    const ServoChannelConfig &config = _channels[channel];
+    float offset = commandUs - SERVO_COMMAND_CENTER_US;
+    if (config.reversed) offset = -offset;
+    _staged[channel] = Clamp(channel, config.centerUs + config.trimUs + offset);
+
+    _pending |= 1 << channel;
+    if (_pending == (1 << _count) - 1) Commit();
+}
+
+void ServoBank::SetNormalized(uint8_t channel, float value)
+{
+    if (channel >= _count) return;
+    const ServoChannelConfig &config = _channels[channel];
+    if (config.reversed) value = -value;
+    float span = value > 0.0f ? config.maxUs - config.centerUs : config.centerUs - config.minUs;
+    _staged[channel] = Clamp(channel, config.centerUs + config.trimUs + value * span);
+
+    _pending |= 1 << channel;
+    if (_pending == (1 << _count) - 1) Commit();
+}
+
+void ServoBank::Commit()
+{
+    TRACE_SCOPE("ServoBank::Commit");
+    if (!_initiated || _pending == 0) return;
+
+    // Percent of the period, sub-microsecond steps survive in the float
+    float percentPerUs = _rateHz * 0.0001f;
+    // A few us for all channels, a period boundary inside that window is
+    // the only way two of them can land in different frames
+    portENTER_CRITICAL(&_mux);
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (!(_pending & (1 << i))) continue;
+        mcpwm_set_duty(_unit, (mcpwm_timer_t)(i / 2), (i % 2) ? MCPWM_GEN_B : MCPWM_GEN_A, _staged[i] * percentPerUs);
+    }
+    portEXIT_CRITICAL(&_mux);
+    _pending = 0;
+    _commits++;
+}
+#endif
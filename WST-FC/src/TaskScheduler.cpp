@@ -0,0 +1,126 @@
+#include "TaskScheduler.h"
+
+int TaskScheduler::AddTask(const char *name, TaskCallback callback, void *arg, uint32_t rateHz, BaseType_t core, UBaseType_t priority)
+{
+    if (_started || callback == nullptr || rateHz == 0) return -1;
+    if (_taskCount >= MAX_SCHEDULED_TASKS) return -1;
+
+    ScheduledTask &task = _tasks[_taskCount];
+    task.name = name;
+    task.callback = callback;
+    task.arg = arg;
+    task.periodUs = 1000000UL / rateHz;
+    // ESP32-C3 has a single core
+    task.core = (portNUM_PROCESSORS > 1) ? core : 0;
+    task.priority = priority;
+    return _taskCount++;
+}
+
+void TaskScheduler::Start()
+{
+    if (_started) return;
+    _started = true;
+
+    for (uint8_t i = 0; i < _taskCount; i++)
+    {
+        ScheduledTask &task = _tasks[i];
+        if (xTaskCreatePinnedToCore(TaskBody, task.name, SCHEDULER_TASK_STACK, &task, task.priority, &task.handle, task.core) != pdPASS)
+        {
+            Serial.printf("Failed to create task %s\n", task.name);
+            continue;
+        }
+
+        esp_timer_create_args_t timerArgs = {};
+        timerArgs.callback = TimerCallback;
+        timerArgs.arg = &task;
+        timerArgs.dispatch_method = ESP_TIMER_TASK;
+        timerArgs.name = task.name;
+        esp_timer_create(&timerArgs, &task.timer);
+
+        task.nextReleaseUs = esp_timer_get_time() + task.periodUs;
+        esp_timer_start_periodic(task.timer, task.periodUs);
+    }
+}
+
+void TaskScheduler::TimerCallback(void *arg)
+{
+    ScheduledTask *task = static_cast<ScheduledTask *>(arg);
+    xTaskNotifyGive(task->handle);
+}
+
+void TaskScheduler::TaskBody(void *arg)
+{
+    ScheduledTask *task = static_cast<ScheduledTask *>(arg);
+    TaskStats &stats = task->stats;
+
+    for (;;)
+    {
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t start = esp_timer_get_time();
+
+        // Every notification beyond the first is a period we did not run
+        if (pending > 1)
+        {
+            stats.missedReleases += pending - 1;
+            task->nextReleaseUs += (int64_t)(pending - 1) * task->periodUs;
+        }
+
+        int64_t lateness = start - task->nextReleaseUs;
+        uint32_t jitter = lateness > 0 ? (uint32_t)lateness : (uint32_t)(-lateness);
+        task->nextReleaseUs += task->periodUs;
+
+        task->callback(task->arg);
+
+        uint32_t exec = (uint32_t)(esp_timer_get_time() - start);
+        stats.runs++;
+        stats.lastJitterUs = jitter;
+        stats.jitterSumUs += jitter;
+        if (jitter > stats.maxJitterUs) stats.maxJitterUs = jitter;
+        stats.lastExecUs = exec;
+        stats.execSumUs += exec;
+        if (exec > stats.maxExecUs) stats.maxExecUs = exec;
+        if (exec > task->periodUs) stats.overruns++;
+    }
+}
+
+const char *TaskScheduler::GetTaskName(uint8_t index) const
+{
+    if (index >= _taskCount) return nullptr;
+    return _tasks[index].name;
+}
+
+TaskStats TaskScheduler::GetStats(uint8_t index) const
+{
+    if (index >= _taskCount) return TaskStats();
+    return _tasks[index].stats;
+}
+
+void TaskScheduler::ResetStats()
+{
+    for (uint8_t i = 0; i < _taskCount; i++)
+    {
+        _tasks[i].stats = TaskStats();
+    }
+}
+
+void TaskScheduler::PrintStats(Print &out) const
+{
+    for (uint8_t i = 0; i < _taskCount; i++)
+    {
+        const ScheduledTask &task = _tasks[i];
+        TaskStats stats = task.stats;
+        uint32_t runs = stats.runs > 0 ? stats.runs : 1;
+
+        out.printf("[%s] core:%d period:%luus runs:%lu overruns:%lu missed:%lu jitter avg/max:%lu/%luus exec avg/max:%lu/%luus\n",
+            task.name,
+            (int)task.core,
+            (unsigned long)task.periodUs,
+            (unsigned long)stats.runs,
+            (unsigned long)stats.overruns,
+            (unsigned long)stats.missedReleases,
+            (unsigned long)(stats.jitterSumUs / runs),
+            (unsigned long)stats.maxJitterUs,
+            (unsigned long)(stats.execSumUs / runs),
+            (unsigned long)stats.maxExecUs);
+    }
+}
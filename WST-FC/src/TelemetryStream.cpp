@@ -0,0 +1,74 @@
+#include "TelemetryStream.h"
+
+#define TELEMETRY_FAST 1
+#define TELEMETRY_MEDIUM TELEMETRY_MEDIUM_DIVIDER
+#define TELEMETRY_SLOW TELEMETRY_SLOW_DIVIDER
+
+// Rate class of every SensorsData field, in declaration order
+static const uint8_t TELEMETRY_FIELD_DIVIDERS[] = {
+    // pitch, roll
+    TELEMETRY_FAST, TELEMETRY_FAST,
+    // gyroX/Y/Z
+    TELEMETRY_FAST, TELEMETRY_FAST, TELEMETRY_FAST,
+    // linearAccelX/Y/Z
+    TELEMETRY_FAST, TELEMETRY_FAST, TELEMETRY_FAST,
+    // voltage, current, consumedMah
+    TELEMETRY_SLOW, TELEMETRY_SLOW, TELEMETRY_SLOW,
+    // distanceSensors[6]
+    TELEMETRY_MEDIUM, TELEMETRY_MEDIUM, TELEMETRY_MEDIUM, TELEMETRY_MEDIUM, TELEMETRY_MEDIUM, TELEMETRY_MEDIUM,
+    // other[5], DHT and the like
+    TELEMETRY_SLOW, TELEMETRY_SLOW, TELEMETRY_SLOW, TELEMETRY_SLOW, TELEMETRY_SLOW,
+    // motorRpm[4]
+    TELEMETRY_FAST, TELEMETRY_FAST, TELEMETRY_FAST, TELEMETRY_FAST,
+};
+static_assert(sizeof(TELEMETRY_FIELD_DIVIDERS) == TELEMETRY_FIELDS, "TELEMETRY_FIELD_DIVIDERS must list every SensorsData field");
+
+TelemetryStream::TelemetryStream(SeqLock<SensorsData> *source)
+    : _source(source), _encoder(TELEMETRY_FIELD_DIVIDERS, TELEMETRY_FIELDS, TELEMETRY_KEYFRAME_INTERVAL)
+{
+}
+
+void TelemetryStream::Loop()
+{
+    TRACE_SCOPE("TelemetryStream::Loop");
+    if (_link == nullptr) return;
+    uint32_t now = micros();
+    if (now - _lastSendUs < 1000000.0f / _rateHz) return;
+    if (!_source->ReadIfNewer(_sample)) return;
+    _lastSendUs = now;
+
+    uint16_t values[TELEMETRY_FIELDS];
+    memcpy(values, &_sample.data, sizeof(SensorsData));
+    size_t length = _encoder.Encode(values, _payload, sizeof(_payload));
+    bool keyframe = _payload[0] == TELEMETRY_KEYFRAME;
+
+    if (_link->SendFrame(LINK_MSG_TELEMETRY_DELTA, _payload, length))
+    {
+        _stats.frames++;
+        _stats.bytes += length;
+        if (keyframe) _stats.keyframes++;
+        _rateHz += TELEMETRY_RATE_STEP_HZ;
+    }
+    else
+    {
+        // Deltas refer to the last keyframe, without it they are all lost
+        _stats.failed++;
+        if (keyframe) _encoder.ForceKeyframe();
+        _rateHz *= 0.5f;
+    }
+
+    float ceiling = TELEMETRY_MIN_HZ + (TELEMETRY_MAX_HZ - TELEMETRY_MIN_HZ) * _link->GetLinkQuality() / 100.0f;
+    if (_rateHz > ceiling) _rateHz = ceiling;
+    if (_rateHz < TELEMETRY_MIN_HZ) _rateHz = TELEMETRY_MIN_HZ;
+}
+
+void TelemetryStream::PrintStats(Print &out) const
+{
+    TelemetryStreamStats stats = _stats;
+    out.printf("[telemetry] %.1fHz frames:%lu keyframes:%lu avg:%.1fB failed:%lu\n",
+        _rateHz,
+        (unsigned long)stats.frames,
+        (unsigned long)stats.keyframes,
+        stats.frames > 0 ? (float)stats.bytes / stats.frames : 0.0f,
+        (unsigned long)stats.failed);
+}
@@ -0,0 +1,86 @@
+#include "Trace.h"
+
+#if USE_TRACE
+#include <vector>
+#include <algorithm>
+
+#define TRACE_MAX_SPAN_NAMES 32
+
+TraceEvent Tracer::_events[TRACE_BUFFER_SIZE];
+volatile uint32_t Tracer::_head = 0;
+
+uint16_t Tracer::GetEventCount()
+{
+    uint32_t head = _head;
+    return head < TRACE_BUFFER_SIZE ? head : TRACE_BUFFER_SIZE;
+}
+
+void Tracer::Dump(Print &out, uint16_t first, uint16_t count)
+{
+    uint32_t head = _head;
+    uint16_t available = GetEventCount();
+    uint32_t oldest = head - available;
+
+    if (first == 0)
+        out.printf("#TRACE cpu_mhz=%lu events=%u\n", (unsigned long)ESP.getCpuFreqMHz(), available);
+
+    for (uint32_t i = first; i < available && i < (uint32_t)first + count; i++)
+    {
+        const TraceEvent &event = _events[(oldest + i) % TRACE_BUFFER_SIZE];
+        if (event.name == nullptr) continue;
+        out.printf("%s,%u,%lu,%lu\n", event.name, event.core, (unsigned long)event.startCycles, (unsigned long)event.durationCycles);
+    }
+}
+
+void Tracer::PrintStats(Print &out)
+{
+    const char *names[TRACE_MAX_SPAN_NAMES];
+    std::vector<uint32_t> durations[TRACE_MAX_SPAN_NAMES];
+    uint8_t nameCount = 0;
+    uint16_t available = GetEventCount();
+
+    // Names are string literals, comparing pointers is enough
+    for (uint16_t i = 0; i < available; i++)
+    {
+        const TraceEvent &event = _events[i];
+        if (event.name == nullptr) continue;
+
+        uint8_t slot = 0;
+        while (slot < nameCount && names[slot] != event.name) slot++;
+        if (slot == nameCount)
+        {
+            if (nameCount >= TRACE_MAX_SPAN_NAMES) continue;
+            names[nameCount++] = event.name;
+        }
+        durations[slot].push_back(event.durationCycles);
+    }
+
+    float cyclesPerUs = (float)ESP.getCpuFreqMHz();
+    out.println("span,count,min_us,avg_us,p99_us,max_us");
+    for (uint8_t slot = 0; slot < nameCount; slot++)
+    {
+        std::vector<uint32_t> &values = durations[slot];
+        std::sort(values.begin(), values.end());
+
+        uint64_t sum = 0;
+        for (uint32_t value : values) sum += value;
+        size_t p99Index = (values.size() * 99) / 100;
+        if (p99Index >= values.size()) p99Index = values.size() - 1;
+
+        out.printf("%s,%u,%.2f,%.2f,%.2f,%.2f\n",
+            names[slot],
+            (unsigned)values.size(),
+            values.front() / cyclesPerUs,
+            (float)sum / values.size() / cyclesPerUs,
+            values[p99Index] / cyclesPerUs,
+            values.back() / cyclesPerUs);
+    }
+}
+
+void Tracer::Clear()
+{
+    _head = 0;
+    memset(_events, 0, sizeof(_events));
+}
+
+#endif
@@ -1,13 +1,12 @@
 #include "communicationModules\CommunicationESPNowModule.h"
 #include "Configuration.h"
-#include "communicationModules\CommunicationESPNowModule.h"
-
 
+CommunicationESPNowModule* CommunicationESPNowModule::instance = nullptr;
 
-
-CommunicationESPNowModule::CommunicationESPNowModule(DroneControlData *dataPtr, DroneStatus *status){
+CommunicationESPNowModule::CommunicationESPNowModule(SeqLock<DroneControlData> *dataPtr, DroneStatus *status, SeqLock<SensorsData> *telemetry){
     sharedData = dataPtr;
     droneStatus = status;
+    telemetryData = telemetry;
     instance = this;
 }
 
@@ -23,6 +22,7 @@ void CommunicationESPNowModule::Init()
     }
 
     esp_now_register_recv_cb(OnDataReceived);
+    esp_now_register_send_cb(OnDataSent);
 
     esp_now_peer_info_t peerInfo = {};
     memcpy(peerInfo.peer_addr, broadcastAddress, 6);
@@ -39,6 +39,27 @@ void CommunicationESPNowModule::Init()
 }
 void CommunicationESPNowModule::Loop()
 {
+    TRACE_SCOPE("CommunicationESPNowModule::Loop");
+    // A lost callback must not stall the telemetry for good
+    uint32_t sent = sendGeneration.load();
+    uint32_t settled = settledGeneration.load();
+    if(sent != settled && millis() - sendStartMs > ESPNOW_SEND_TIMEOUT_MS &&
+       settledGeneration.compare_exchange_strong(settled, sent))
+    {
+        stats.timeouts++;
+        failed += sent - settled;
+    }
+    // Callbacks still owed past twice the timeout were lost rather than late,
+    // renumber so the next callback answers the next send
+    uint32_t answered = callbackGeneration.load();
+    settled = settledGeneration.load();
+    if((int32_t)(settled - answered) > 0 && millis() - sendStartMs > 2 * ESPNOW_SEND_TIMEOUT_MS)
+    {
+        callbackGeneration.compare_exchange_strong(answered, settled);
+    }
+    AdaptRate();
+    SendTelemetry();
+
     if(droneStatus==nullptr) return;
     if(millis() - lastDataTime > MAX_ROGUE_TIME)
     {
@@ -49,29 +70,172 @@ void CommunicationESPNowModule::Loop()
         *droneStatus = WORKS;
     }
 }
-void CommunicationESPNowModule::OnDataReceived(const uint8_t *mac, const uint8_t *incomingData, int len) {
-    if(len != sizeof(DroneControlData)){
-        Serial.println("Received data of incorrect size");
+
+void CommunicationESPNowModule::AdaptRate()
+{
+    uint32_t deliveredNow = delivered.load();
+    uint32_t failedNow = failed.load();
+    uint32_t newDelivered = deliveredNow - seenDelivered;
+    uint32_t newFailed = failedNow - seenFailed;
+    seenDelivered = deliveredNow;
+    seenFailed = failedNow;
+    if(newDelivered + newFailed == 0) return;
+
+    deliveryRatio += 0.1f * ((float)newDelivered / (newDelivered + newFailed) - deliveryRatio);
+    if(newFailed > 0)
+    {
+        telemetryRateHz *= 0.5f;
+        if(telemetryRateHz < ESPNOW_TELEMETRY_MIN_HZ) telemetryRateHz = ESPNOW_TELEMETRY_MIN_HZ;
+    }
+}
+
+void CommunicationESPNowModule::SendTelemetry()
+{
+    TRACE_SCOPE("CommunicationESPNowModule::SendTelemetry");
+    if(InFlight()) return;
+
+    if(!telemetryPending)
+    {
+        uint32_t now = micros();
+        if(telemetryData == nullptr || now - lastTelemetryUs < 1000000.0f / telemetryRateHz) return;
+        if(!telemetryData->ReadIfNewer(telemetry)) return;
+        lastTelemetryUs = now;
+        telemetryPending = true;
+        telemetryMessage++;
+        nextFragment = 0;
+    }
+
+    const bool fragmented = LINK_OVERHEAD + sizeof(SensorsData) > ESP_NOW_MAX_DATA_LEN;
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    size_t size;
+    if(!fragmented)
+    {
+        size = LinkEncode(frame, sizeof(frame), LINK_MSG_TELEMETRY, txSequence, micros(), &telemetry.data, sizeof(SensorsData));
+    }
+    else
+    {
+        size = LinkEncodeFragment(frame, sizeof(frame), LINK_MSG_TELEMETRY, telemetryMessage, nextFragment, ESPNOW_FRAGMENT_CHUNK,
+                                  txSequence, micros(), &telemetry.data, sizeof(SensorsData));
+    }
+    if(!Send(frame, size))
+    {
+        // Dropped whole, the next sample replaces it
+        telemetryPending = false;
         return;
     }
 
+    if(fragmented)
+    {
+        stats.fragmentsSent++;
+        nextFragment++;
+    }
+    if(!fragmented || (uint32_t)nextFragment * ESPNOW_FRAGMENT_CHUNK >= sizeof(SensorsData))
+    {
+        telemetryPending = false;
+        stats.telemetrySent++;
+        // Additive increase once per sample that made it out
+        telemetryRateHz += ESPNOW_TELEMETRY_STEP_HZ;
+        if(telemetryRateHz > ESPNOW_TELEMETRY_MAX_HZ) telemetryRateHz = ESPNOW_TELEMETRY_MAX_HZ;
+    }
+}
+
+// A send without its result yet, or callbacks of timed out sends still
+// owed: a new send now would take one of those
+bool CommunicationESPNowModule::InFlight()
+{
+    uint32_t settled = settledGeneration.load();
+    return sendGeneration.load() != settled || (int32_t)(settled - callbackGeneration.load()) > 0;
+}
+
+bool CommunicationESPNowModule::Send(const uint8_t *frame, size_t size)
+{
+    if(size == 0) return false;
+    // Before the send, the callback may come first
+    sendGeneration++;
+    sendStartMs = millis();
+    if(esp_now_send(broadcastAddress, frame, size) != ESP_OK)
+    {
+        sendGeneration--;
+        stats.sendErrors++;
+        return false;
+    }
+    txSequence++;
+    return true;
+}
+
+bool CommunicationESPNowModule::SendFrame(uint8_t type, const void *payload, uint16_t length)
+{
+    if(InFlight()) return false;
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    return Send(frame, LinkEncode(frame, sizeof(frame), type, txSequence, micros(), payload, length));
+}
+
+void CommunicationESPNowModule::OnDataSent(const uint8_t *mac, esp_now_send_status_t status)
+{
+    if(instance == nullptr) return;
+    uint32_t generation = ++instance->callbackGeneration;
+    // Settled already when its send timed out
+    uint32_t settled = instance->settledGeneration.load();
+    do
+    {
+        if((int32_t)(generation - settled) <= 0) return;
+    } while(!instance->settledGeneration.compare_exchange_weak(settled, generation));
+
+    if(status == ESP_NOW_SEND_SUCCESS) instance->delivered++;
+    else instance->failed++;
+}
+
+void CommunicationESPNowModule::OnDataReceived(const uint8_t *mac, const uint8_t *incomingData, int len) {
+    if(instance == nullptr) return;
+    LinkFrame frame;
     DroneControlData receivedData;
-    if (instance->sharedData != nullptr) {
-        memcpy(instance->sharedData, incomingData, sizeof(DroneControlData));
+    if(len <= 0 || LinkDecode(incomingData, len, frame) != LINK_DECODE_OK){
+        instance->sequencer.CountCorrupt();
+        return;
+    }
+    // Telemetry of another vehicle on the channel
+    if(!LinkPayload(frame, LINK_MSG_CONTROL, receivedData)) return;
+
+    // Only accepted frames keep the link alive, a restarted sender resyncs after MAX_ROGUE_TIME
+    if(millis() - instance->lastDataTime > MAX_ROGUE_TIME) instance->sequencer.Reset();
+    if (instance->sequencer.Accept(frame.header.sequence)) {
+        if (instance->sharedData != nullptr) instance->sharedData->Publish(receivedData, micros());
+        instance->lastDataTime = millis();
     }
-    instance->lastDataTime = millis();
 }
 
 void CommunicationESPNowModule::SendData(DroneControlData* data)
 {
     if(data == nullptr) return;
-    esp_err_t result = esp_now_send(broadcastAddress, (uint8_t *)data, sizeof(DroneControlData));
-    if (result != ESP_OK) {
-        Serial.println("Error sending data via ESP-NOW");
-    }
+    // Control does not wait for the previous frame, it is the one that matters
+    uint8_t frame[LINK_OVERHEAD + sizeof(DroneControlData)];
+    size_t size = LinkEncode(frame, sizeof(frame), LINK_MSG_CONTROL, txSequence, micros(), data, sizeof(DroneControlData));
+    Send(frame, size);
 }
 
 void CommunicationESPNowModule::SendData(SensorsData* data)
 {
+    // Without a telemetry channel the caller's samples are sent, still paced
+    // by the send callback
+    if(data == nullptr || telemetryData != nullptr || telemetryPending) return;
+    memcpy(&telemetry.data, data, sizeof(SensorsData));
+    telemetryPending = true;
+    telemetryMessage++;
+    nextFragment = 0;
+    SendTelemetry();
+}
 
-}
\ No newline at end of file
+void CommunicationESPNowModule::PrintStats(Print &out)
+{
+    ESPNowLinkStats snapshot = stats;
+    out.printf("[espnow] telemetry:%lu (%.1fHz) fragments:%lu delivered:%lu failed:%lu (%.0f%% ok) send errors:%lu timeouts:%lu\n",
+        (unsigned long)snapshot.telemetrySent,
+        telemetryRateHz,
+        (unsigned long)snapshot.fragmentsSent,
+        (unsigned long)delivered.load(),
+        (unsigned long)failed.load(),
+        100.0f * deliveryRatio,
+        (unsigned long)snapshot.sendErrors,
+        (unsigned long)snapshot.timeouts);
+    sequencer.PrintStats(out, "espnow");
+}
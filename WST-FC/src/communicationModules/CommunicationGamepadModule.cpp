@@ -15,7 +15,7 @@ void CommunicationGamepadModule::onDisconnectedGamepad(GamepadPtr gp) {
     }
 }
 
-CommunicationGamepadModule::CommunicationGamepadModule(DroneControlData *dataPtr, DroneStatus *status){
+CommunicationGamepadModule::CommunicationGamepadModule(SeqLock<DroneControlData> *dataPtr, DroneStatus *status){
     sharedData = dataPtr;
     droneStatus = status;
     instance = this;
@@ -26,6 +26,7 @@ void CommunicationGamepadModule::Init(){
 }
 
 void CommunicationGamepadModule::Loop(){
+    TRACE_SCOPE("CommunicationGamepadModule::Loop");
     BP32.update();
 
     if (myGamepad && myGamepad->isConnected()) {
@@ -33,10 +34,12 @@ void CommunicationGamepadModule::Loop(){
         const int inRange = 511;
         const int outRange= 1000;
        
-        sharedData->throttle =  map(myGamepad->axisY(),  -inRange, inRange, -outRange, outRange);
-        sharedData->yaw      =  map(myGamepad->axisX(),  -inRange, inRange, -outRange, outRange);
-        sharedData->pitch    =  map(myGamepad->axisRY(), -inRange, inRange, -outRange, outRange); 
-        sharedData->roll     =  map(myGamepad->axisRX(), -inRange, inRange, -outRange, outRange);
+        DroneControlData controlData;
+        controlData.throttle =  map(myGamepad->axisY(),  -inRange, inRange, -outRange, outRange);
+        controlData.yaw      =  map(myGamepad->axisX(),  -inRange, inRange, -outRange, outRange);
+        controlData.pitch    =  map(myGamepad->axisRY(), -inRange, inRange, -outRange, outRange); 
+        controlData.roll     =  map(myGamepad->axisRX(), -inRange, inRange, -outRange, outRange);
+        sharedData->Publish(controlData, micros());
     }
 }
 
@@ -1,27 +1,54 @@
 #include "communicationModules\CommunicationSerialModule.h"
 #include "Configuration.h"
 
-CommunicationSerialModule::CommunicationSerialModule(DroneControlData *dataPtr, DroneStatus *status)
+CommunicationSerialModule::CommunicationSerialModule(SeqLock<DroneControlData> *dataPtr, DroneStatus *status, SeqLock<SensorsData> *telemetry)
 {
     sharedData = dataPtr;
     droneStatus = status;
+    telemetryData = telemetry;
 }
 void CommunicationSerialModule::Init()
 {
-
+    #if SERIAL_LINK_UART == 1
+        port = &Serial1;
+    #elif SERIAL_LINK_UART == 2
+        port = &Serial2;
+    #else
+        // Shared with the log, every line lands between two delimiters and fails the CRC
+        port = &Serial;
+    #endif
+    // Buffer sizes only apply before begin(), UART 0 was started in setup()
+    port->end();
+    port->setRxBufferSize(SERIAL_LINK_RX_BUFFER);
+    port->setTxBufferSize(SERIAL_LINK_TX_BUFFER);
+    port->begin(SERIAL_LINK_BAUD, SERIAL_8N1, SERIAL_LINK_RX_PIN, SERIAL_LINK_TX_PIN);
 }
 void CommunicationSerialModule::Loop()
 {
-    if (sharedData == nullptr) return;
-    if (Serial.available() < sizeof(DroneControlData) + 2) return;
-    if (Serial.read() != HEADER_BYTE_1) return;
-    if (Serial.read() != HEADER_BYTE_2) return;
+    TRACE_SCOPE("CommunicationSerialModule::Loop");
+    if (sharedData == nullptr || port == nullptr) return;
+
+    int available;
+    while ((available = port->available()) > 0)
+    {
+        size_t count = port->read(readBuffer, available < (int)sizeof(readBuffer) ? available : sizeof(readBuffer));
+        stats.rxBytes += count;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t length = decoder.Push(readBuffer[i]);
+            if (length > 0) HandleFrame(decoder.GetFrame(), length);
+        }
+    }
 
-    Serial.readBytes(inputBuffer, sizeof(DroneControlData));
-    memcpy(sharedData, inputBuffer, sizeof(DroneControlData));
-    lastUpdate = millis();
-    
-    
+    #if SERIAL_TELEMETRY_HZ > 0
+        uint32_t now = micros();
+        if (telemetryData != nullptr && now - lastTelemetryUs >= 1000000UL / SERIAL_TELEMETRY_HZ)
+        {
+            lastTelemetryUs = now;
+            if (telemetryData->ReadIfNewer(telemetry))
+                SendFrame(LINK_MSG_TELEMETRY, &telemetry.data, sizeof(SensorsData));
+        }
+    #endif
 
     if ((millis() - lastUpdate) > MAX_ROGUE_TIME) 
     {
@@ -32,7 +59,67 @@ void CommunicationSerialModule::Loop()
         *droneStatus = WORKS;
     }
 }
+
+void CommunicationSerialModule::HandleFrame(const uint8_t *data, size_t length)
+{
+    LinkFrame frame;
+    DroneControlData controlData;
+    if (LinkDecode(data, length, frame) != LINK_DECODE_OK)
+    {
+        sequencer.CountCorrupt();
+        return;
+    }
+    if (!LinkPayload(frame, LINK_MSG_CONTROL, controlData))
+    {
+        stats.rejected++;
+        return;
+    }
+
+    // Only accepted frames keep the link alive, a restarted sender resyncs after MAX_ROGUE_TIME
+    if ((millis() - lastUpdate) > MAX_ROGUE_TIME) sequencer.Reset();
+    if (sequencer.Accept(frame.header.sequence))
+    {
+        sharedData->Publish(controlData, micros());
+        lastUpdate = millis();
+    }
+}
+
+bool CommunicationSerialModule::SendFrame(uint8_t type, const void *payload, uint16_t length)
+{
+    TRACE_SCOPE("CommunicationSerialModule::SendFrame");
+    if (port == nullptr) return false;
+    size_t size = LinkEncode(frameBuffer, sizeof(frameBuffer), type, txSequence++, micros(), payload, length);
+    if (size == 0) return false;
+    size_t encoded = CobsEncode(frameBuffer, size, encodedBuffer);
+    // Whole frames only, a partial one would cost the receiver the next one too
+    if (port->availableForWrite() < (int)encoded)
+    {
+        stats.txDropped++;
+        return false;
+    }
+    port->write(encodedBuffer, encoded);
+    stats.txBytes += encoded;
+    stats.txFrames++;
+    return true;
+}
+
 void CommunicationSerialModule::SendData(SensorsData* data)
 {
+    if (data == nullptr || port == nullptr) return;
+    if (telemetryData != nullptr && SERIAL_TELEMETRY_HZ > 0) return;
+    SendFrame(LINK_MSG_TELEMETRY, data, sizeof(SensorsData));
+}
 
-}
\ No newline at end of file
+void CommunicationSerialModule::PrintStats(Print &out)
+{
+    SerialLinkStats snapshot = stats;
+    out.printf("[serial] %lubaud rx:%luB tx:%luB frames:%lu dropped:%lu rejected:%lu cobs errors:%lu\n",
+        (unsigned long)SERIAL_LINK_BAUD,
+        (unsigned long)snapshot.rxBytes,
+        (unsigned long)snapshot.txBytes,
+        (unsigned long)snapshot.txFrames,
+        (unsigned long)snapshot.txDropped,
+        (unsigned long)snapshot.rejected,
+        (unsigned long)decoder.GetErrors());
+    sequencer.PrintStats(out, "serial");
+}
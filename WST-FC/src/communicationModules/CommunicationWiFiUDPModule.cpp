@@ -1,8 +1,15 @@
 #include "communicationModules\CommunicationWiFiUDPModule.h"
 #include "Configuration.h"
 #include <esp_wifi.h> 
+#if UDP_RECEIVE_TASK
+    #include <lwip/sockets.h>
+#endif
 
-CommunicationWiFiUDPModule::CommunicationWiFiUDPModule(DroneControlData *dataPtr, unsigned int port, DroneStatus *status)
+#define UDP_RECEIVE_TASK_STACK 4096
+// The blocking receive wakes up this often even without traffic
+#define UDP_RECEIVE_TIMEOUT_MS 100
+
+CommunicationWiFiUDPModule::CommunicationWiFiUDPModule(SeqLock<DroneControlData> *dataPtr, unsigned int port, DroneStatus *status)
 {
     sharedData = dataPtr;
     localPort = port;
@@ -45,30 +52,80 @@ void CommunicationWiFiUDPModule::Init()
         Serial.println("WireGuard initialized!");
     #endif
 
-    udp.begin(localPort);
+    #if UDP_RECEIVE_TASK
+        sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(localPort);
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        timeval timeout = {0, UDP_RECEIVE_TIMEOUT_MS * 1000};
+        if (sock < 0 ||
+            bind(sock, (sockaddr *)&local, sizeof(local)) < 0 ||
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0 ||
+            xTaskCreatePinnedToCore(TaskBody, "udp_rx", UDP_RECEIVE_TASK_STACK, this, UDP_RECEIVE_PRIORITY, &receiveTask, SYSTEM_CORE) != pdPASS)
+        {
+            Serial.println("UDP receive task init failed!");
+        }
+    #else
+        udp.begin(localPort);
+    #endif
 }
 
 void CommunicationWiFiUDPModule::Loop()
 {
-    rssi = WiFi.RSSI();
+    TRACE_SCOPE("CommunicationWiFiUDPModule::Loop");
+    {
+        TRACE_SCOPE("WiFi.RSSI");
+        rssi = WiFi.RSSI();
+    }
     connectionStatus = WiFi.status();
 
+    #if UDP_RECEIVE_TASK
+    #if USE_TRACE
+        if (traceRequested)
+        {
+            traceRequested = false;
+            portENTER_CRITICAL(&remoteMux);
+            IPAddress ip = remoteIP;
+            uint16_t port = remotePort;
+            portEXIT_CRITICAL(&remoteMux);
+            SendTrace(ip, port);
+        }
+    #endif
+    #else
     int packetSize = udp.parsePacket();
 
     if (packetSize)
     {
         int len = udp.read(packetBuffer, 255);
 
-        if (len != sizeof(DroneControlData))
+        #if USE_TRACE
+            if (len == 1 && packetBuffer[0] == TRACE_REQUEST_BYTE)
+            {
+                SendTrace(udp.remoteIP(), udp.remotePort());
+                return;
+            }
+        #endif
+
+        LinkFrame frame;
+        DroneControlData controlData;
+        if (len <= 0 || LinkDecode(packetBuffer, len, frame) != LINK_DECODE_OK || !LinkPayload(frame, LINK_MSG_CONTROL, controlData))
         {
-            Serial.printf("Error: invalid packet");
+            sequencer.CountCorrupt();
             return;
         }
-        memcpy(sharedData, packetBuffer, sizeof(DroneControlData));
-        lastUpdate = millis();
-        remoteIP = udp.remoteIP();
-        remotePort = udp.remotePort();
+        // Only accepted frames keep the link alive, so a restarted ground
+        // station gets through after MAX_ROGUE_TIME even with a lower sequence
+        if (millis() - lastUpdate > MAX_ROGUE_TIME) sequencer.Reset();
+        if (sequencer.Accept(frame.header.sequence))
+        {
+            sharedData->Publish(controlData, micros());
+            lastUpdate = millis();
+            remoteIP = udp.remoteIP();
+            remotePort = udp.remotePort();
+        }
     }
+    #endif
     if (rssi < MIN_RSSI || connectionStatus != WL_CONNECTED || (millis() - lastUpdate) > MAX_ROGUE_TIME)
     {
         *droneStatus = WARNING;
@@ -81,9 +138,13 @@ void CommunicationWiFiUDPModule::Loop()
     #if USE_WIREGUARD
         if (remotePort != 0 && (millis() - lastKeepaliveTime > KEEPALIVE_INTERVAL))
         {
-            udp.beginPacket(remoteIP, remotePort);
-            udp.write(&KEEPALIVE_BYTE, 1);
-            udp.endPacket();
+            #if UDP_RECEIVE_TASK
+                SendPacket(&KEEPALIVE_BYTE, 1);
+            #else
+                udp.beginPacket(remoteIP, remotePort);
+                udp.write(&KEEPALIVE_BYTE, 1);
+                udp.endPacket();
+            #endif
             
             lastKeepaliveTime = millis();
         }
@@ -92,11 +153,162 @@ void CommunicationWiFiUDPModule::Loop()
 
 void CommunicationWiFiUDPModule::SendData(SensorsData* data)
 {
-    if(remotePort==0 || data == nullptr) return;
-    udp.beginPacket(remoteIP, remotePort);
-    udp.write((const uint8_t*)data, sizeof(SensorsData));
-    udp.endPacket();
+    if(data == nullptr) return;
+    SendFrame(LINK_MSG_TELEMETRY, data, sizeof(SensorsData));
+}
+
+bool CommunicationWiFiUDPModule::SendFrame(uint8_t type, const void *payload, uint16_t length)
+{
+    TRACE_SCOPE("CommunicationWiFiUDPModule::SendFrame");
+    if(remotePort==0) return false;
+    size_t size = LinkEncode(sendBuffer, sizeof(sendBuffer), type, txSequence++, micros(), payload, length);
+    if(size == 0) return false;
+    #if UDP_RECEIVE_TASK
+        bool sent = SendPacket(sendBuffer, size);
+    #else
+        udp.beginPacket(remoteIP, remotePort);
+        udp.write(sendBuffer, size);
+        bool sent = udp.endPacket() == 1;
+    #endif
     #if USE_WIREGUARD
         lastKeepaliveTime = millis();
     #endif
-}
\ No newline at end of file
+    return sent;
+}
+
+uint8_t CommunicationWiFiUDPModule::GetLinkQuality()
+{
+    if(connectionStatus != WL_CONNECTED || rssi >= 0) return 0;
+    // MIN_RSSI -> 0, 30 dB above it -> 100
+    int quality = (rssi - MIN_RSSI) * 100 / 30;
+    if(quality < 0) return 0;
+    return quality > 100 ? 100 : quality;
+}
+
+void CommunicationWiFiUDPModule::PrintStats(Print &out)
+{
+    #if UDP_RECEIVE_TASK
+        UdpReceiveStats stats = rxStats;
+        out.printf("[udp] drains:%lu datagrams:%lu depth avg/max:%.2f/%lu superseded:%lu max gap:%luus\n",
+            (unsigned long)stats.drains,
+            (unsigned long)stats.datagrams,
+            stats.drains > 0 ? (float)depthSum / stats.drains : 0.0f,
+            (unsigned long)stats.maxDepth,
+            (unsigned long)stats.superseded,
+            (unsigned long)stats.maxGapUs);
+    #endif
+    sequencer.PrintStats(out, "udp");
+}
+
+#if UDP_RECEIVE_TASK
+void CommunicationWiFiUDPModule::TaskBody(void *arg)
+{
+    CommunicationWiFiUDPModule *self = static_cast<CommunicationWiFiUDPModule *>(arg);
+    for (;;)
+    {
+        self->Drain();
+    }
+}
+
+void CommunicationWiFiUDPModule::Drain()
+{
+    sockaddr_in source;
+    socklen_t sourceLength = sizeof(source);
+    // Blocks until the first datagram or the timeout
+    int length = recvfrom(sock, packetBuffer, sizeof(packetBuffer), 0, (sockaddr *)&source, &sourceLength);
+    if (length < 0) return;
+
+    TRACE_SCOPE("CommunicationWiFiUDPModule::Drain");
+    DroneControlData newest;
+    uint32_t newestUs = 0;
+    sockaddr_in newestSource;
+    uint32_t depth = 0;
+    uint32_t accepted = 0;
+    while (length >= 0)
+    {
+        uint32_t receiveUs = micros();
+        depth++;
+
+        LinkFrame frame;
+        DroneControlData controlData;
+        #if USE_TRACE
+        if (length == 1 && packetBuffer[0] == TRACE_REQUEST_BYTE)
+        {
+            portENTER_CRITICAL(&remoteMux);
+            remoteIP = IPAddress(source.sin_addr.s_addr);
+            remotePort = ntohs(source.sin_port);
+            portEXIT_CRITICAL(&remoteMux);
+            traceRequested = true;
+        }
+        else
+        #endif
+        if (LinkDecode(packetBuffer, length, frame) != LINK_DECODE_OK || !LinkPayload(frame, LINK_MSG_CONTROL, controlData))
+        {
+            sequencer.CountCorrupt();
+        }
+        else
+        {
+            // Only accepted frames keep the link alive, a restarted ground
+            // station gets through after MAX_ROGUE_TIME with a lower sequence
+            if (millis() - lastUpdate > MAX_ROGUE_TIME) sequencer.Reset();
+            if (sequencer.Accept(frame.header.sequence))
+            {
+                // Accept() only passes frames newer than all before, the last one wins
+                newest = controlData;
+                newestUs = receiveUs;
+                newestSource = source;
+                accepted++;
+                lastUpdate = millis();
+
+                if (rxStats.lastReceiveUs != 0 && receiveUs - rxStats.lastReceiveUs > rxStats.maxGapUs)
+                    rxStats.maxGapUs = receiveUs - rxStats.lastReceiveUs;
+                rxStats.lastReceiveUs = receiveUs;
+            }
+        }
+
+        sourceLength = sizeof(source);
+        length = recvfrom(sock, packetBuffer, sizeof(packetBuffer), MSG_DONTWAIT, (sockaddr *)&source, &sourceLength);
+    }
+
+    rxStats.drains++;
+    rxStats.datagrams += depth;
+    depthSum += depth;
+    if (depth > rxStats.maxDepth) rxStats.maxDepth = depth;
+    if (accepted == 0) return;
+    rxStats.superseded += accepted - 1;
+
+    sharedData->Publish(newest, newestUs);
+    portENTER_CRITICAL(&remoteMux);
+    remoteIP = IPAddress(newestSource.sin_addr.s_addr);
+    remotePort = ntohs(newestSource.sin_port);
+    portEXIT_CRITICAL(&remoteMux);
+}
+
+bool CommunicationWiFiUDPModule::SendPacket(const uint8_t *data, size_t length)
+{
+    sockaddr_in destination = {};
+    destination.sin_family = AF_INET;
+    portENTER_CRITICAL(&remoteMux);
+    destination.sin_addr.s_addr = (uint32_t)remoteIP;
+    destination.sin_port = htons(remotePort);
+    portEXIT_CRITICAL(&remoteMux);
+    // Same socket as the receive task, lwIP allows one sender and one receiver at a time.
+    // Fails with ENOMEM when the WiFi TX queue is full.
+    return sendto(sock, data, length, 0, (sockaddr *)&destination, sizeof(destination)) == (int)length;
+}
+#endif
+
+#if USE_TRACE
+void CommunicationWiFiUDPModule::SendTrace(IPAddress ip, uint16_t port)
+{
+    // Small chunks so a datagram stays below the MTU
+    const uint16_t eventsPerPacket = 16;
+    uint16_t count = Tracer::GetEventCount();
+    for (uint16_t first = 0; first < count; first += eventsPerPacket)
+    {
+        udp.beginPacket(ip, port);
+        Tracer::Dump(udp, first, eventsPerPacket);
+        udp.endPacket();
+    }
+}
+#endif
\ No newline at end of file
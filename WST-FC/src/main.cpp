@@ -4,17 +4,59 @@
 #include "Configuration.h"
 #include "SensorsModule.h"
 #include "SensorsData.h"
+#include "TaskScheduler.h"
+#include "SeqLock.h"
+#include "Trace.h"
+#include "Benchmark.h"
+#include "I2CBus.h"
 #include "modules/IModule.h"
+#if TELEMETRY_STREAM
+  #include "TelemetryStream.h"
+#endif
+#if USE_BLACKBOX
+  #include "Blackbox.h"
+#endif
+
+// Shared by every I2C sensor, started in setup() before they Init
+I2CBus i2cBus;
 
 #ifdef VEHICLE_TYPE_BICOPTER
   #include "BicopterMixer.h"
   #include "sensors/MpuSensor.h"
-  MpuSensor mpuSensor;
+  MpuSensor mpuSensor(&i2cBus);
+  #if ESC_PROTOCOL == 1
+    #include "DShotActuator.h"
+    //pin, TX channel, RX channel (bidirectional) or -1
+    DShotActuator motorL(25, DSHOT_RMT_CHANNEL, DSHOT_BIDIRECTIONAL ? DSHOT_RMT_RX_CHANNEL : -1);
+    DShotActuator motorR(26, DSHOT_RMT_CHANNEL + 1, DSHOT_BIDIRECTIONAL ? DSHOT_RMT_RX_CHANNEL + 1 : -1);
+    DShotActuator *const dshotMotors[2] = {&motorL, &motorR};
+    DShotTelemetry motorTelemetry(dshotMotors, 2);
+  #else
+    //pin, minPulse, maxPulse
+    ESCActuator motorL(25, 700, 1500);
+    ESCActuator motorR(26, 700, 1500);
+  #endif
+  #include <soc/soc_caps.h>
+  // Chips without MCPWM (ESP32-C3) stay on ESP32Servo whatever SERVO_BANK says
+  #if SERVO_BANK && SOC_MCPWM_SUPPORTED
+    #include "ServoBank.h"
+    // Both tilt servos latch in the same frame
+    ServoBank servoBank(SERVO_MCPWM_UNIT, SERVO_RATE_HZ);
+    //bank, pin
+    BankServo servoL(&servoBank, 32);
+    BankServo servoR(&servoBank, 33);
+  #else
+    //pin, center angle
+    ServoMotor servoL(32, 90);
+    ServoMotor servoR(33, 90);
+  #endif
 #endif
 
 #ifdef VEHICLE_TYPE_AIRBOAT
     #include "AirBoatMixer.h"
     #include "sensors/AdxlSensor.h"
+    #include "modules/CameraModule.h"
+    AdxlSensor adxlSensor(&i2cBus);
     DCMotor motorL(16, 17, 4, 0); 
     DCMotor motorR(18, 19, 5, 1);
 #endif
@@ -26,19 +68,168 @@
     DCMotor motorR(15, 2, 1); 
 #endif
 
-DroneControlData droneControllData{};
+// Written by comms, read by the control task
+SeqLock<DroneControlData> controlChannel;
+// Written by the control task, read by comms and modules
+SeqLock<SensorsData> sensorsChannel;
+// Working copy, touched only by the control task
 SensorsData sensorsData{};
 
+#if TELEMETRY_STREAM
+  TelemetryStream telemetryStream(&sensorsChannel);
+  // Links leave telemetry to the stream
+  SeqLock<SensorsData> *const linkTelemetry = nullptr;
+#else
+  SeqLock<SensorsData> *const linkTelemetry = &sensorsChannel;
+#endif
+
+#if USE_BLACKBOX
+  Blackbox blackbox;
+#endif
+
 DroneStatus connectionStatus{WORKS};
 DroneStatus batteryStatus{WORKS};
 DroneStatus droneStatus{WORKS};
 
-CommunicationModule comms(&droneControllData, &connectionStatus);
-SensorsModule sensorsModule(&sensorsData);
+#if STATIC_VEHICLE
+  #include "Vehicle.h"
+  #if COMMUNICATION_METHOD == 0
+    CommunicationWiFiUDPModule linkInterface(&controlChannel, UDP_CONTROLL_PORT, &connectionStatus);
+  #elif COMMUNICATION_METHOD == 1
+    CommunicationESPNowModule linkInterface(&controlChannel, &connectionStatus, linkTelemetry);
+  #elif COMMUNICATION_METHOD == 2
+    CommunicationSerialModule linkInterface(&controlChannel, &connectionStatus, linkTelemetry);
+  #elif COMMUNICATION_METHOD == 3
+    CommunicationGamepadModule linkInterface(&controlChannel, &connectionStatus);
+  #endif
+  Link<decltype(linkInterface)> vehicleLink(&linkInterface);
+  // Modules still get the dynamic view of the same link
+  CommunicationModule comms(&linkInterface, &connectionStatus);
+
+  #ifdef VEHICLE_TYPE_BICOPTER
+    #if ESC_PROTOCOL == 1 && DSHOT_BIDIRECTIONAL
+      Sensors<SensorSlot<MpuSensor>, SensorSlot<DShotTelemetry>> vehicleSensors(&mpuSensor, &motorTelemetry);
+    #else
+      Sensors<SensorSlot<MpuSensor>> vehicleSensors(&mpuSensor);
+    #endif
+    BicopterMixer<decltype(motorL), decltype(servoL)> vehicleMixer(&motorL, &motorR, &servoL, &servoR);
+  #endif
+  #ifdef VEHICLE_TYPE_AIRBOAT
+    Sensors<SensorSlot<AdxlSensor, SensorPeriodUs(ADXL345_RATE_HZ)>> vehicleSensors(&adxlSensor);
+    BoatMixer<DCMotor> vehicleMixer(&motorL, &motorR);
+  #endif
+  #ifdef VEHICLE_TYPE_TANK
+    Sensors<> vehicleSensors;
+    BoatMixer<DCMotor> vehicleMixer(&motorL, &motorR);
+  #endif
+  Vehicle<decltype(vehicleSensors), decltype(vehicleMixer), decltype(vehicleLink)> vehicle(vehicleSensors, vehicleMixer, vehicleLink);
+#else
+  CommunicationModule comms(&controlChannel, &connectionStatus, linkTelemetry);
+  SensorsModule sensorsModule(&sensorsData, &sensorsChannel);
+  IMixer* droneMixer = nullptr;
+#endif
 std::vector<IModule *> modules;
 
-IMixer* droneMixer = nullptr;
+TaskScheduler scheduler;
 unsigned long lastTelemetryTimestamp {0};
+unsigned long lastStatsTimestamp {0};
+
+// Sensor -> mixer -> actuator chain, runs at CONTROL_LOOP_HZ on CONTROL_LOOP_CORE
+void ControlTask(void *arg)
+{
+  TRACE_SCOPE("ControlTask");
+  // Keeps the last consistent command if the writer is mid-publish
+  static Snapshot<DroneControlData> control;
+  controlChannel.Read(control);
+
+  #if STATIC_VEHICLE
+    vehicle.ControlTick(&control.data, &sensorsData);
+    sensorsChannel.Publish(sensorsData, micros());
+    #if USE_BLACKBOX
+      blackbox.Log(control.data, sensorsData, vehicle.GetMixer(), micros());
+    #endif
+  #else
+    sensorsModule.Loop();
+    if(droneMixer != nullptr) 
+    {
+      droneMixer->Update(&control.data, &sensorsData);
+      #if USE_BLACKBOX
+        blackbox.Log(control.data, sensorsData, *droneMixer, micros());
+      #endif
+    }
+  #endif
+}
+
+void CommsTask(void *arg)
+{
+  TRACE_SCOPE("CommsTask");
+  #if STATIC_VEHICLE
+    vehicle.CommsTick();
+  #else
+    comms.Loop();
+  #endif
+  #if TELEMETRY_STREAM
+    telemetryStream.Loop();
+  #else
+    static Snapshot<SensorsData> telemetry;
+    if(millis() - lastTelemetryTimestamp > TELEMETRY_TIME)
+    {
+      lastTelemetryTimestamp = millis();
+      sensorsChannel.Read(telemetry);
+      #if STATIC_VEHICLE
+        vehicle.SendTelemetry(&telemetry.data);
+      #else
+        comms.SendData(&telemetry.data);
+      #endif
+    }
+  #endif
+}
+
+void ModulesTask(void *arg)
+{
+  TRACE_SCOPE("ModulesTask");
+  static Snapshot<SensorsData> sensors;
+  sensorsChannel.Read(sensors);
+  for (auto module : modules)
+    module->Loop(&comms, &sensors.data);
+}
+
+#if USE_BENCHMARK && STATIC_VEHICLE
+// Same sensors and actuators, once through the runtime interfaces and once
+// through the compile-time Vehicle
+void RunBenchmarks()
+{
+  DroneControlData input{};
+  SensorsData data{};
+  SensorsModule dynamicSensors(&data);
+  IMixer *dynamicMixer = nullptr;
+
+  #ifdef VEHICLE_TYPE_BICOPTER
+    dynamicSensors.AddSensor(&mpuSensor, "mpu", CONTROL_LOOP_HZ, SENSOR_PRIORITY_CRITICAL, 300);
+    dynamicMixer = new BicopterMixer<>(&motorL, &motorR, &servoL, &servoR);
+  #endif
+  #ifdef VEHICLE_TYPE_AIRBOAT
+    dynamicSensors.AddSensor(&adxlSensor, "adxl", ADXL345_RATE_HZ, SENSOR_PRIORITY_CRITICAL, 100);
+    dynamicMixer = new BoatMixer<>(&motorL, &motorR);
+  #endif
+  #ifdef VEHICLE_TYPE_TANK
+    dynamicMixer = new BoatMixer<>(&motorL, &motorR);
+  #endif
+
+  uint32_t dynamicCycles = BenchmarkCycles(BENCHMARK_ITERATIONS, [&]() {
+    dynamicSensors.Loop();
+    dynamicMixer->Update(&input, &data);
+  });
+  uint32_t staticCycles = BenchmarkCycles(BENCHMARK_ITERATIONS, [&]() {
+    vehicle.ControlTick(&input, &data);
+  });
+
+  PrintBenchmark(Serial, "control tick (virtual)", dynamicCycles);
+  PrintBenchmark(Serial, "control tick (Vehicle<>)", staticCycles);
+  PrintBenchmarkSaving(Serial, "control tick", dynamicCycles, staticCycles);
+  delete dynamicMixer;
+}
+#endif
 
 void setup()
 {
@@ -46,42 +237,97 @@ void setup()
   
   #ifdef VEHICLE_TYPE_BICOPTER
     Serial.println("Configuring as BICOPTER");
-    sensorsModule.AddSensor(&mpuSensor);
-    droneMixer = new BicopterMixer();
   #endif
   #ifdef VEHICLE_TYPE_AIRBOAT
     Serial.println("Configuring as AIRBOAT");
-    sensorsModule.AddSensor(&adxlSensor);
-    droneMixer = new BoatMixer(&motorL, &motorR);
     modules.push_back(new CameraModule());
   #endif
   #ifdef VEHICLE_TYPE_TANK
     Serial.println("Configuring as TANK");
-    droneMixer = new BoatMixer(&motorL, &motorR);
   #endif
 
-  comms.Init();
-  sensorsModule.Init();
-  if(droneMixer != nullptr) droneMixer->Init();
+  if(!i2cBus.Begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_CLOCK_HZ))
+    Serial.println("I2C bus init failed!");
+
+  #if STATIC_VEHICLE
+    vehicle.Init();
+  #else
+    #ifdef VEHICLE_TYPE_BICOPTER
+      sensorsModule.AddSensor(&mpuSensor, "mpu", CONTROL_LOOP_HZ, SENSOR_PRIORITY_CRITICAL, 300);
+      #if ESC_PROTOCOL == 1 && DSHOT_BIDIRECTIONAL
+        sensorsModule.AddSensor(&motorTelemetry, "rpm", CONTROL_LOOP_HZ, SENSOR_PRIORITY_CRITICAL, 5);
+      #endif
+      droneMixer = new BicopterMixer<>(&motorL, &motorR, &servoL, &servoR);
+    #endif
+    #ifdef VEHICLE_TYPE_AIRBOAT
+      sensorsModule.AddSensor(&adxlSensor, "adxl", ADXL345_RATE_HZ, SENSOR_PRIORITY_CRITICAL, 100);
+      droneMixer = new BoatMixer<>(&motorL, &motorR);
+    #endif
+    #ifdef VEHICLE_TYPE_TANK
+      droneMixer = new BoatMixer<>(&motorL, &motorR);
+    #endif
+
+    comms.Init();
+    sensorsModule.Init();
+    if(droneMixer != nullptr) droneMixer->Init();
+  #endif
+
+  #if TELEMETRY_STREAM && COMMUNICATION_METHOD != 3
+    telemetryStream.SetLink(comms.GetInterface());
+  #endif
+
+  #if USE_BENCHMARK
+    RunMathBenchmarks(Serial);
+    RunMixerBenchmarks(Serial);
+  #endif
+  #if USE_BENCHMARK && STATIC_VEHICLE
+    RunBenchmarks();
+  #endif
+
   for (auto module : modules)
   {
     module->Init();
   }
+
+  #if USE_BLACKBOX
+    // Erases its flash space, before the control task runs
+    blackbox.Init();
+  #endif
+
+  scheduler.AddTask("control", ControlTask, nullptr, CONTROL_LOOP_HZ, CONTROL_LOOP_CORE, 5);
+  scheduler.AddTask("comms", CommsTask, nullptr, COMMS_LOOP_HZ, SYSTEM_CORE, 3);
+  if(!modules.empty())
+    scheduler.AddTask("modules", ModulesTask, nullptr, MODULES_LOOP_HZ, SYSTEM_CORE, 2);
+  scheduler.Start();
 }
 
 void loop()
 {
-  comms.Loop();
-  sensorsModule.Loop();
-  if(millis() - lastTelemetryTimestamp > TELEMETRY_TIME)
+  if(millis() - lastStatsTimestamp > SCHEDULER_STATS_TIME)
   {
-    lastTelemetryTimestamp = millis();
-    comms.SendData(&sensorsData);
-  } 
-
-  if(droneMixer != nullptr) 
-    droneMixer->Update(&droneControllData, &sensorsData);
-
-  for (auto module : modules)
-    module->Loop(&comms, &sensorsData);
+    lastStatsTimestamp = millis();
+    scheduler.PrintStats(Serial);
+    i2cBus.PrintStats(Serial);
+    comms.PrintStats(Serial);
+    #if TELEMETRY_STREAM
+      telemetryStream.PrintStats(Serial);
+    #endif
+    #if USE_BLACKBOX
+      blackbox.PrintStats(Serial);
+    #endif
+    #if !STATIC_VEHICLE
+      sensorsModule.PrintStats(Serial);
+    #endif
+    for (auto module : modules)
+      module->PrintStats(Serial);
+    #if USE_TRACE
+      Tracer::PrintStats(Serial);
+    #endif
+  }
+  #if USE_TRACE && (COMMUNICATION_METHOD != 2 || SERIAL_LINK_UART != 0)
+    // Serial is free for a full dump when it is not the control link
+    if(Serial.available() && Serial.read() == TRACE_REQUEST_BYTE)
+      Tracer::Dump(Serial);
+  #endif
+  delay(100);
 }
\ No newline at end of file
@@ -1,6 +1,5 @@
 #include "modules/CameraModule.h"
 #ifdef CAMERA_SUPPORTED
-#include "esp_camera.h"
 #include "esp_timer.h"
 
 CameraModule::CameraModule(){}
@@ -28,72 +27,305 @@ void CameraModule::Init()
     config.pin_reset = RESET_GPIO_NUM;
     config.xclk_freq_hz = XCLK_FREQ_HZ;
     config.pixel_format = PIXFORMAT_JPEG; 
-    config.frame_size = FRAMESIZE_HVGA;
+    config.frame_size = FRAME_SIZE;
     config.jpeg_quality = JPEG_QUALITY; 
-    config.fb_count = FB_COUNT;
-    config.grab_mode = CAMERA_GRAB_LATEST;
     
-    esp_camera_init(&config);
+    // Buffer count and location are up to the streamer
+    if (!_streamer.Init(config)) return;
     startCameraServer();
 }
 
-void CameraModule::Loop(CommunicationModule* interface, SensorsData *data){}
+void CameraModule::Loop(CommunicationModule* interface, SensorsData *data)
+{
+    TRACE_SCOPE("CameraModule::Loop");
+    _streamer.Adapt();
+}
+
+void CameraModule::PrintStats(Print &out)
+{
+    _streamer.PrintStats(out);
+}
+
+// Writes a whole buffer, send() may take only part of it
+static bool SendAll(int socket, const void *data, size_t length, int flags)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (length > 0)
+    {
+        int sent = send(socket, bytes, length, flags);
+        if (sent <= 0) return false;
+        bytes += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+// Collects PrintStats() output for /stats
+class BufferPrint : public Print
+{
+    private:
+        char *_buffer;
+        size_t _capacity;
+        size_t _length {0};
+    public:
+        BufferPrint(char *buffer, size_t capacity) : _buffer(buffer), _capacity(capacity) {}
+        size_t write(uint8_t c) override
+        {
+            if (_length >= _capacity) return 0;
+            _buffer[_length++] = c;
+            return 1;
+        }
+        size_t GetLength() const { return _length; }
+};
+
+bool MjpegClient::Open(int socket, const char *address)
+{
+    static const char headers[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: multipart/x-mixed-replace;boundary=" PART_BOUNDARY "\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: close\r\n"
+        "Access-Control-Allow-Origin: *\r\n";
+    // The blank line ending the headers comes with the first part
+    snprintf(_name, sizeof(_name), "mjpeg %s", address);
+    _socket = socket;
+    if (!SendAll(socket, headers, sizeof(headers) - 1, 0))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MjpegClient::Send(const CameraFrame &frame)
+{
+    TRACE_SCOPE("MjpegClient::Send");
+    // Capture time (esp_timer clock) and frame id let the viewer measure
+    // latency and count skipped frames
+    char part[160];
+    int length = snprintf(part, sizeof(part),
+        "\r\n--" PART_BOUNDARY "\r\n"
+        "Content-Type: image/jpeg\r\n"
+        "Content-Length: %u\r\n"
+        "X-Frame-Id: %lu\r\n"
+        "X-Capture-Us: %lld\r\n\r\n",
+        (unsigned)frame.fb->len, (unsigned long)frame.id, (long long)frame.captureUs);
+    return SendAll(_socket, part, length, MSG_MORE) && SendAll(_socket, frame.fb->buf, frame.fb->len, 0);
+}
+
+void MjpegClient::Close()
+{
+    int socket = _socket;
+    if (socket < 0) return;
+    shutdown(socket, SHUT_RDWR);
+    close(socket);
+    _socket = -1;
+}
+
+void CameraModule::Accept(int socket, const char *address)
+{
+    // Only the request line matters, GET /stats or anything else for the stream
+    timeval timeout = {1, 0};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char request[128];
+    int received = recv(socket, request, sizeof(request) - 1, 0);
+    if (received <= 0)
+    {
+        close(socket);
+        return;
+    }
+    request[received] = '\0';
+
+    if (strncmp(request, "GET /stats", 10) == 0)
+    {
+        static char body[768];
+        BufferPrint print(body, sizeof(body));
+        _streamer.PrintStats(print);
+        char headers[128];
+        int length = snprintf(headers, sizeof(headers),
+            "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+            (unsigned)print.GetLength());
+        if (SendAll(socket, headers, length, MSG_MORE)) SendAll(socket, body, print.GetLength(), 0);
+        close(socket);
+        return;
+    }
+
+    MjpegClient *client = nullptr;
+    for (MjpegClient &candidate : _clients)
+    {
+        if (!candidate.IsOpen())
+        {
+            client = &candidate;
+            break;
+        }
+    }
+    if (client == nullptr)
+    {
+        static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+        SendAll(socket, busy, sizeof(busy) - 1, 0);
+        close(socket);
+        return;
+    }
 
-esp_err_t CameraModule::stream_handler(httpd_req_t *req)
+    // A stalled viewer fails the send instead of holding its frame forever
+    timeout = {STREAM_SEND_TIMEOUT_MS / 1000, (STREAM_SEND_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    if (!client->Open(socket, address)) return;
+    if (!_streamer.AddClient(client)) client->Close();
+}
+
+#if STREAM_UDP
+void UdpVideoClient::Open(int socket, const sockaddr_in &address, const VideoSubscribe &subscribe)
 {
-    camera_fb_t * fb = NULL;
-    esp_err_t res = ESP_OK;
-    char part_buf[64];
+    _socket = socket;
+    _address = address;
+    _lastComplete = subscribe.framesComplete;
+    _lastIncomplete = subscribe.framesIncomplete;
+    _loss = 0.0f;
+    _lastSubscribeMs = millis();
+    snprintf(_name, sizeof(_name), "udp %s:%u", inet_ntoa(address.sin_addr), ntohs(address.sin_port));
+    _open = true;
+}
 
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(33);
+bool UdpVideoClient::IsFrom(const sockaddr_in &address) const
+{
+    return _address.sin_addr.s_addr == address.sin_addr.s_addr && _address.sin_port == address.sin_port;
+}
 
-    res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
+void UdpVideoClient::Refresh(const VideoSubscribe &subscribe)
+{
+    uint32_t complete = subscribe.framesComplete - _lastComplete;
+    uint32_t incomplete = subscribe.framesIncomplete - _lastIncomplete;
+    if (complete + incomplete > 0) _loss = (float)incomplete / (complete + incomplete);
+    _lastComplete = subscribe.framesComplete;
+    _lastIncomplete = subscribe.framesIncomplete;
+    _lastSubscribeMs = millis();
+}
 
-    if(res != ESP_OK) return res;
+bool UdpVideoClient::Send(const CameraFrame &frame)
+{
+    // The viewer went away, Close() frees the slot
+    if (millis() - _lastSubscribeMs > VIDEO_SUBSCRIBE_TIMEOUT_MS) return false;
+    if (frame.fb->len > VIDEO_MAX_FRAME_SIZE) return true;
 
-    while(true){
-        fb = esp_camera_fb_get();
-        
-        if (!fb) 
+    TRACE_SCOPE("UdpVideoClient::Send");
+    for (uint32_t index = 0;; index++)
+    {
+        size_t size = VideoEncodeFragment(_datagram, frame.id, (uint32_t)frame.captureUs, frame.fb->buf, frame.fb->len, index);
+        if (size == 0) break;
+        // A frame is a burst of datagrams, lwIP runs out of buffers until
+        // the WiFi task drained some
+        uint8_t attempt = 0;
+        while (sendto(_socket, _datagram, size, 0, (const sockaddr *)&_address, sizeof(_address)) < 0)
         {
-        vTaskDelayUntil( &xLastWakeTime, xFrequency );
-        continue;
+            if (errno != ENOMEM || ++attempt > STREAM_UDP_RETRIES) return true;
+            vTaskDelay(1);
         }
+    }
+    return true;
+}
 
-        size_t hlen = snprintf(part_buf, 64, _STREAM_PART, fb->len);
-        res = httpd_resp_send_chunk(req, (const char *)part_buf, hlen);
-        
-        if(res == ESP_OK)
-        res = httpd_resp_send_chunk(req, (const char *)fb->buf, fb->len);
-        if(res == ESP_OK)
-        res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));  
-        
-        esp_camera_fb_return(fb);
-        
-        if(res != ESP_OK) break;
-        vTaskDelayUntil( &xLastWakeTime, xFrequency );
+void CameraModule::ReceiveSubscribe()
+{
+    VideoSubscribe subscribe;
+    sockaddr_in peer;
+    socklen_t peerLength = sizeof(peer);
+    int received = recvfrom(_udpSocket, &subscribe, sizeof(subscribe), 0, (sockaddr *)&peer, &peerLength);
+    if (received != sizeof(subscribe) || VideoMessageTypeOf((const uint8_t *)&subscribe, received) != VIDEO_MSG_SUBSCRIBE) return;
+
+    // Answered first, the round trip is what the viewer's clock offset rests on
+    VideoSync sync;
+    VideoFillHeader(sync, VIDEO_MSG_SYNC);
+    sync.viewerUs = subscribe.viewerUs;
+    sync.vehicleUs = esp_timer_get_time();
+    sendto(_udpSocket, &sync, sizeof(sync), 0, (const sockaddr *)&peer, sizeof(peer));
+
+    UdpVideoClient *slot = nullptr;
+    for (UdpVideoClient &client : _udpClients)
+    {
+        if (client.IsOpen() && client.IsFrom(peer))
+        {
+            client.Refresh(subscribe);
+            return;
+        }
+        if (!client.IsOpen() && slot == nullptr) slot = &client;
+    }
+    if (slot == nullptr) return;
+    slot->Open(_udpSocket, peer, subscribe);
+    if (!_streamer.AddClient(slot)) slot->Close();
+}
+#endif
+
+void CameraModule::ServerTaskBody(void *arg)
+{
+    CameraModule *self = static_cast<CameraModule *>(arg);
+    for (;;)
+    {
+        fd_set sockets;
+        FD_ZERO(&sockets);
+        FD_SET(self->_listenSocket, &sockets);
+        int highest = self->_listenSocket;
+        #if STREAM_UDP
+            if (self->_udpSocket >= 0)
+            {
+                FD_SET(self->_udpSocket, &sockets);
+                if (self->_udpSocket > highest) highest = self->_udpSocket;
+            }
+        #endif
+        if (select(highest + 1, &sockets, nullptr, nullptr, nullptr) <= 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        #if STREAM_UDP
+            if (self->_udpSocket >= 0 && FD_ISSET(self->_udpSocket, &sockets)) self->ReceiveSubscribe();
+        #endif
+        if (!FD_ISSET(self->_listenSocket, &sockets)) continue;
+
+        sockaddr_in peer;
+        socklen_t peerLength = sizeof(peer);
+        int socket = accept(self->_listenSocket, (sockaddr *)&peer, &peerLength);
+        if (socket < 0) continue;
+        char address[24];
+        snprintf(address, sizeof(address), "%s:%u", inet_ntoa(peer.sin_addr), ntohs(peer.sin_port));
+        self->Accept(socket, address);
     }
-    return res;
 }
 
 void CameraModule::startCameraServer()
 {
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.server_port = 80;
-    config.max_uri_handlers = 1;
-    config.recv_wait_timeout = 1; 
-    config.send_wait_timeout = 1;
-
-    httpd_uri_t index_uri = {
-        .uri       = "/",
-        .method    = HTTP_GET,
-        .handler   = CameraModule::stream_handler,
-        .user_ctx  = NULL
-    };
-
-    if (httpd_start(&stream_httpd, &config) == ESP_OK) {
-        httpd_register_uri_handler(stream_httpd, &index_uri);
+    _listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_listenSocket < 0)
+    {
+        Serial.println("Camera server socket failed!");
+        return;
     }
+    int reuse = 1;
+    setsockopt(_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(STREAM_PORT);
+    if (bind(_listenSocket, (sockaddr *)&address, sizeof(address)) < 0 || listen(_listenSocket, 2) < 0)
+    {
+        Serial.println("Camera server bind failed!");
+        close(_listenSocket);
+        _listenSocket = -1;
+        return;
+    }
+    #if STREAM_UDP
+        _udpSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        address.sin_port = htons(VIDEO_PORT);
+        if (_udpSocket >= 0 && bind(_udpSocket, (sockaddr *)&address, sizeof(address)) < 0)
+        {
+            close(_udpSocket);
+            _udpSocket = -1;
+        }
+        if (_udpSocket < 0) Serial.println("Camera UDP stream socket failed!");
+    #endif
+    if (xTaskCreatePinnedToCore(ServerTaskBody, "camera server", STREAM_SERVER_STACK, this, STREAM_SERVER_PRIORITY, &_serverTask, SYSTEM_CORE) != pdPASS)
+        Serial.println("Camera server task start failed!");
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,385 @@
+#include "modules/CameraStreamer.h"
+#include "esp_timer.h"
+
+#define CAMERA_CAPTURE_STACK 3072
+#define CAMERA_CLIENT_STACK 3072
+
+// Sizes Adapt() steps through, smallest first, all close to 4:3 so the
+// viewer does not change its aspect
+static const framesize_t CAMERA_FRAME_SIZES[] = {FRAMESIZE_QQVGA, FRAMESIZE_QVGA, FRAMESIZE_CIF, FRAMESIZE_VGA};
+static const char *const CAMERA_FRAME_SIZE_NAMES[] = {"160x120", "320x240", "400x296", "640x480"};
+static const uint8_t CAMERA_FRAME_SIZE_COUNT = sizeof(CAMERA_FRAME_SIZES) / sizeof(CAMERA_FRAME_SIZES[0]);
+
+bool CameraStreamer::Init(camera_config_t config)
+{
+    if (_initiated) return true;
+    if (psramFound())
+    {
+        config.fb_location = CAMERA_FB_IN_PSRAM;
+        config.fb_count = CAMERA_FB_COUNT;
+        config.grab_mode = CAMERA_GRAB_LATEST;
+    }
+    else
+    {
+        // A JPEG buffer in DRAM, clients send it in turns
+        Serial.println("Camera: no PSRAM, one frame buffer at 320x240");
+        config.fb_location = CAMERA_FB_IN_DRAM;
+        config.fb_count = 1;
+        config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
+        if (config.frame_size > FRAMESIZE_QVGA) config.frame_size = FRAMESIZE_QVGA;
+    }
+    if (esp_camera_init(&config) != ESP_OK)
+    {
+        Serial.println("Camera init failed!");
+        return false;
+    }
+    _frameCount = config.fb_count;
+
+    _sizeCount = 0;
+    while (_sizeCount < CAMERA_FRAME_SIZE_COUNT && CAMERA_FRAME_SIZES[_sizeCount] <= config.frame_size)
+        _sizeCount++;
+    if (_sizeCount == 0) _sizeCount = 1;
+    _sizeIndex = _sizeCount - 1;
+    _quality = constrain(config.jpeg_quality, CAMERA_QUALITY_BEST, CAMERA_QUALITY_WORST);
+    _appliedSize = config.frame_size;
+    Apply();
+
+    for (Client &client : _clients)
+    {
+        client.streamer = this;
+        if (xTaskCreatePinnedToCore(ClientTaskBody, "camera client", CAMERA_CLIENT_STACK, &client, CAMERA_CLIENT_PRIORITY, &client.task, SYSTEM_CORE) != pdPASS)
+        {
+            Serial.println("Camera client task start failed!");
+            return false;
+        }
+    }
+    if (xTaskCreatePinnedToCore(CaptureTaskBody, "camera", CAMERA_CAPTURE_STACK, this, CAMERA_CAPTURE_PRIORITY, &_captureTask, SYSTEM_CORE) != pdPASS)
+    {
+        Serial.println("Camera task start failed!");
+        return false;
+    }
+    _lastAdaptMs = millis();
+    _initiated = true;
+    return true;
+}
+
+void CameraStreamer::CaptureTaskBody(void *arg)
+{
+    CameraStreamer *self = static_cast<CameraStreamer *>(arg);
+    for (;;)
+    {
+        // Nobody to send to, the driver keeps its buffers
+        if (self->GetClientCount() == 0)
+        {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
+        self->Capture();
+    }
+}
+
+void CameraStreamer::Capture()
+{
+    // Fewer descriptors in use than driver buffers: the driver has one to fill
+    CameraFrame *frame = nullptr;
+    portENTER_CRITICAL(&_mux);
+    for (uint8_t i = 0; i < _frameCount; i++)
+    {
+        if (_frames[i].refs == 0)
+        {
+            frame = &_frames[i];
+            frame->refs = 1;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_mux);
+    if (frame == nullptr)
+    {
+        // Every buffer is out to a client, Release() wakes us up
+        _stats.starved++;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        return;
+    }
+
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (fb == nullptr)
+    {
+        _stats.captureErrors++;
+        portENTER_CRITICAL(&_mux);
+        frame->refs = 0;
+        portEXIT_CRITICAL(&_mux);
+        return;
+    }
+
+    TRACE_SCOPE("CameraStreamer::Capture");
+    frame->fb = fb;
+    frame->id = ++_nextId;
+    frame->captureUs = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+    _stats.captured++;
+
+    // Every client gets the frame, one it did not get to is replaced
+    CameraFrame *replaced[CAMERA_MAX_CLIENTS];
+    uint8_t replacedCount = 0;
+    portENTER_CRITICAL(&_mux);
+    _intervalCaptured++;
+    for (Client &client : _clients)
+    {
+        if (client.sink == nullptr) continue;
+        if (client.pending != nullptr)
+        {
+            replaced[replacedCount++] = client.pending;
+            client.stats.dropped++;
+        }
+        client.pending = frame;
+        frame->refs++;
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    for (uint8_t i = 0; i < replacedCount; i++)
+        Release(replaced[i]);
+    for (Client &client : _clients)
+    {
+        if (client.sink != nullptr) xTaskNotifyGive(client.task);
+    }
+    // The capture's own reference
+    Release(frame);
+}
+
+void CameraStreamer::Release(CameraFrame *frame)
+{
+    camera_fb_t *fb = nullptr;
+    portENTER_CRITICAL(&_mux);
+    if (--frame->refs == 0)
+    {
+        fb = frame->fb;
+        frame->fb = nullptr;
+    }
+    portEXIT_CRITICAL(&_mux);
+    if (fb != nullptr)
+    {
+        esp_camera_fb_return(fb);
+        xTaskNotifyGive(_captureTask);
+    }
+}
+
+void CameraStreamer::ClientTaskBody(void *arg)
+{
+    Client *client = static_cast<Client *>(arg);
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        client->streamer->Serve(*client);
+    }
+}
+
+void CameraStreamer::Serve(Client &client)
+{
+    for (;;)
+    {
+        portENTER_CRITICAL(&_mux);
+        CameraFrame *frame = client.pending;
+        client.pending = nullptr;
+        ICameraSink *sink = client.sink;
+        portEXIT_CRITICAL(&_mux);
+        if (frame == nullptr) return;
+        if (sink == nullptr)
+        {
+            Release(frame);
+            return;
+        }
+
+        int64_t start = esp_timer_get_time();
+        bool sent = sink->Send(*frame);
+        int64_t end = esp_timer_get_time();
+        uint32_t latencyUs = end - frame->captureUs;
+        size_t length = frame->fb->len;
+        Release(frame);
+
+        if (!sent)
+        {
+            // The slot is free before the sink is, AddClient() never sees a closing sink
+            portENTER_CRITICAL(&_mux);
+            CameraFrame *left = client.pending;
+            client.pending = nullptr;
+            client.sink = nullptr;
+            portEXIT_CRITICAL(&_mux);
+            if (left != nullptr) Release(left);
+            sink->Close();
+            return;
+        }
+
+        portENTER_CRITICAL(&_mux);
+        client.stats.frames++;
+        client.stats.bytes += length;
+        client.intervalFrames++;
+        client.intervalBytes += length;
+        client.intervalBusyUs += end - start;
+        client.intervalLatencyUs += latencyUs;
+        if (latencyUs > client.intervalLatencyMaxUs) client.intervalLatencyMaxUs = latencyUs;
+        portEXIT_CRITICAL(&_mux);
+    }
+}
+
+bool CameraStreamer::AddClient(ICameraSink *sink)
+{
+    if (!_initiated) return false;
+    bool added = false;
+    portENTER_CRITICAL(&_mux);
+    for (Client &client : _clients)
+    {
+        if (client.sink != nullptr) continue;
+        client.sink = sink;
+        client.stats = CameraClientStats();
+        client.intervalFrames = 0;
+        client.intervalBytes = 0;
+        client.intervalBusyUs = 0;
+        client.intervalLatencyUs = 0;
+        client.intervalLatencyMaxUs = 0;
+        added = true;
+        break;
+    }
+    portEXIT_CRITICAL(&_mux);
+    if (added) xTaskNotifyGive(_captureTask);
+    return added;
+}
+
+uint8_t CameraStreamer::GetClientCount()
+{
+    uint8_t count = 0;
+    portENTER_CRITICAL(&_mux);
+    for (Client &client : _clients)
+    {
+        if (client.sink != nullptr) count++;
+    }
+    portEXIT_CRITICAL(&_mux);
+    return count;
+}
+
+void CameraStreamer::Adapt()
+{
+    unsigned long now = millis();
+    if (!_initiated || now - _lastAdaptMs < CAMERA_ADAPT_INTERVAL_MS) return;
+    float seconds = (now - _lastAdaptMs) * 0.001f;
+    _lastAdaptMs = now;
+
+    float bestFps = -1.0f;
+    float bestBusy = 0.0f;
+    ICameraSink *bestSink = nullptr;
+    portENTER_CRITICAL(&_mux);
+    _stats.fps = _intervalCaptured / seconds;
+    _intervalCaptured = 0;
+    for (Client &client : _clients)
+    {
+        CameraClientStats &stats = client.stats;
+        stats.fps = client.intervalFrames / seconds;
+        stats.kBps = client.intervalBytes / 1024.0f / seconds;
+        stats.busy = client.intervalBusyUs * 1e-6f / seconds;
+        stats.latencyAvgUs = client.intervalFrames > 0 ? client.intervalLatencyUs / client.intervalFrames : 0;
+        stats.latencyMaxUs = client.intervalLatencyMaxUs;
+        client.intervalFrames = 0;
+        client.intervalBytes = 0;
+        client.intervalBusyUs = 0;
+        client.intervalLatencyUs = 0;
+        client.intervalLatencyMaxUs = 0;
+        if (client.sink != nullptr && stats.fps > bestFps)
+        {
+            bestFps = stats.fps;
+            bestBusy = stats.busy;
+            bestSink = client.sink;
+        }
+    }
+    portEXIT_CRITICAL(&_mux);
+    if (bestSink == nullptr) return;
+    float loss = bestSink->GetLoss();
+
+    // Sending takes most of the time and still falls short, or datagrams get
+    // lost: the link is the limit, smaller frames first by quality, then by
+    // size. With time to spare the frames grow back one quality step per
+    // interval.
+    int quality = _quality;
+    uint8_t sizeIndex = _sizeIndex;
+    if ((bestFps < CAMERA_TARGET_FPS * 0.8f && bestBusy > 0.8f) || loss > CAMERA_LOSS_DEGRADE)
+    {
+        quality += 5;
+        if (quality > CAMERA_QUALITY_WORST)
+        {
+            if (sizeIndex > 0)
+            {
+                sizeIndex--;
+                quality = (CAMERA_QUALITY_BEST + CAMERA_QUALITY_WORST) / 2;
+            }
+            else quality = CAMERA_QUALITY_WORST;
+        }
+    }
+    else if (bestBusy < 0.5f && loss < CAMERA_LOSS_IMPROVE)
+    {
+        quality -= 1;
+        if (quality < CAMERA_QUALITY_BEST)
+        {
+            if (sizeIndex + 1 < _sizeCount)
+            {
+                sizeIndex++;
+                quality = CAMERA_QUALITY_WORST;
+            }
+            else quality = CAMERA_QUALITY_BEST;
+        }
+    }
+    if (quality == _quality && sizeIndex == _sizeIndex) return;
+    _quality = quality;
+    _sizeIndex = sizeIndex;
+    Apply();
+}
+
+void CameraStreamer::Apply()
+{
+    sensor_t *sensor = esp_camera_sensor_get();
+    if (sensor == nullptr) return;
+    // The sensor restarts on a size change, only when it really changes
+    if (CAMERA_FRAME_SIZES[_sizeIndex] != _appliedSize)
+    {
+        sensor->set_framesize(sensor, CAMERA_FRAME_SIZES[_sizeIndex]);
+        _appliedSize = CAMERA_FRAME_SIZES[_sizeIndex];
+    }
+    sensor->set_quality(sensor, _quality);
+}
+
+framesize_t CameraStreamer::GetFrameSize() const
+{
+    return CAMERA_FRAME_SIZES[_sizeIndex];
+}
+
+void CameraStreamer::PrintStats(Print &out)
+{
+    if (!_initiated)
+    {
+        out.println("[camera] off");
+        return;
+    }
+    CameraStreamerStats stats = _stats;
+    out.printf("[camera] %.1ffps %s q:%d captured:%lu errors:%lu starved:%lu\n",
+        stats.fps,
+        CAMERA_FRAME_SIZE_NAMES[_sizeIndex],
+        _quality,
+        (unsigned long)stats.captured,
+        (unsigned long)stats.captureErrors,
+        (unsigned long)stats.starved);
+
+    for (Client &client : _clients)
+    {
+        portENTER_CRITICAL(&_mux);
+        ICameraSink *sink = client.sink;
+        CameraClientStats clientStats = client.stats;
+        portEXIT_CRITICAL(&_mux);
+        if (sink == nullptr) continue;
+        out.printf("[camera] %s %.1ffps %.0fkB/s busy:%.0f%% frames:%lu dropped:%lu loss:%.0f%% latency avg:%.1fms max:%.1fms\n",
+            sink->GetName(),
+            clientStats.fps,
+            clientStats.kBps,
+            clientStats.busy * 100.0f,
+            (unsigned long)clientStats.frames,
+            (unsigned long)clientStats.dropped,
+            sink->GetLoss() * 100.0f,
+            clientStats.latencyAvgUs * 0.001f,
+            clientStats.latencyMaxUs * 0.001f);
+    }
+}
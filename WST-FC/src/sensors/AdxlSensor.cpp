@@ -1,54 +1,164 @@
 #include "sensors/AdxlSensor.h"
+#include "FastMath.h"
+#include "Configuration.h"
 
-AdxlSensor::AdxlSensor(){
+#define ADXL_REG_DEVID 0x00
+#define ADXL_REG_BW_RATE 0x2C
+#define ADXL_REG_POWER_CTL 0x2D
+#define ADXL_REG_DATA_FORMAT 0x31
+#define ADXL_REG_DATAX0 0x32
 
+// Full resolution mode, 3.9 mg/LSB on every range
+#define ADXL_SCALE (0.0039f * GRAVITY)
+// The same in cm/s^2 per count, Q10 (3.826 * 1024)
+#define ADXL_SCALE_CMS_Q10 3918
+// Low pass alpha 0.2 in Q8
+#define ADXL_ALPHA_Q8 51
+
+AdxlSensor::AdxlSensor(I2CBus *bus) : bus(bus)
+{
 }
+
+void AdxlSensor::OnRead(void *context, bool ok)
+{
+    AdxlSensor *self = static_cast<AdxlSensor *>(context);
+    if (ok)
+    {
+        portENTER_CRITICAL(&self->mux);
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            // Little endian
+            self->raw[axis] = (int16_t)((self->readBuffer[axis * 2 + 1] << 8) | self->readBuffer[axis * 2]);
+        }
+        self->newData = true;
+        portEXIT_CRITICAL(&self->mux);
+    }
+    else
+    {
+        self->busErrors++;
+    }
+    self->readPending = false;
+}
+
+#if !USE_FIXED_POINT_MATH
+void AdxlSensor::ToAcceleration(const int16_t counts[3], float accel[3])
+{
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        accel[axis] = counts[axis] * ADXL_SCALE;
+    }
+}
+#endif
+
+// Starts the filter at the attitude of one sample
+void AdxlSensor::Reset(const int16_t counts[3])
+{
+    #if USE_FIXED_POINT_MATH
+        pitchQ8 = FixedAtan2(counts[1], counts[2]) * 256;
+        rollQ8  = FixedAtan2(-counts[0], counts[2]) * 256;
+    #else
+        float accel[3];
+        ToAcceleration(counts, accel);
+        pitch = FastAtan2(accel[1], accel[2]) * FAST_RAD_TO_DEG;
+        roll  = FastAtan2(-accel[0], accel[2]) * FAST_RAD_TO_DEG;
+    #endif
+}
+
 void AdxlSensor::Init() {
-    if (!accel.begin()) 
+    uint8_t deviceId = 0;
+    if (!bus->ReadSync(ADXL345_ADDRESS, ADXL_REG_DEVID, &deviceId, 1) || deviceId != 0xE5) 
     {
         Serial.println("ADXL345 not found!");
         return;
     }
 
-    accel.setRange(ADXL345_RANGE_8_G);
-    accel.setDataRate(ADXL345_DATARATE_100_HZ);
+    // 100 Hz, full resolution +-8 g, measure
+    bus->WriteSync(ADXL345_ADDRESS, ADXL_REG_BW_RATE, 0x0A);
+    bus->WriteSync(ADXL345_ADDRESS, ADXL_REG_DATA_FORMAT, 0x0A);
+    bus->WriteSync(ADXL345_ADDRESS, ADXL_REG_POWER_CTL, 0x08);
 
     sensorInitiated = true;
-    sensors_event_t event;
-    accel.getEvent(&event);
-    pitch = atan2(event.acceleration.y, event.acceleration.z) * RAD_TO_DEG;
-    roll  = atan2(-event.acceleration.x, event.acceleration.z) * RAD_TO_DEG;
+    delay(10);
+    if (bus->ReadSync(ADXL345_ADDRESS, ADXL_REG_DATAX0, readBuffer, 6))
+    {
+        int16_t counts[3];
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            counts[axis] = (int16_t)((readBuffer[axis * 2 + 1] << 8) | readBuffer[axis * 2]);
+        }
+        Reset(counts);
+    }
 }
 
 void AdxlSensor::Update(SensorsData* data) 
 {
+    TRACE_SCOPE("AdxlSensor::Update");
     if(!sensorInitiated) return;
 
-    sensors_event_t event;
-    accel.getEvent(&event);
+    // Result of the read queued last time, the next one goes out below
+    bool fresh = false;
+    int16_t counts[3];
+    if (newData)
+    {
+        portENTER_CRITICAL(&mux);
+        counts[0] = raw[0];
+        counts[1] = raw[1];
+        counts[2] = raw[2];
+        newData = false;
+        portEXIT_CRITICAL(&mux);
+        fresh = true;
+    }
+
+    if (!readPending)
+    {
+        readPending = true;
+        if (!bus->Read(ADXL345_ADDRESS, ADXL_REG_DATAX0, readBuffer, 6, OnRead, this))
+            readPending = false;
+    }
+
+    if (!fresh) return;
 
-    float currentPitch = atan2(event.acceleration.y, event.acceleration.z) * RAD_TO_DEG;
-    float currentRoll  = atan2(-event.acceleration.x, event.acceleration.z) * RAD_TO_DEG;
+    #if USE_FIXED_POINT_MATH
+        // Raw counts to the output without a float: the ESP32-C3 has no FPU
+        int32_t currentPitch = FixedAtan2(counts[1], counts[2]);
+        int32_t currentRoll  = FixedAtan2(-counts[0], counts[2]);
 
-    // Low Pass Filter
-    pitch = (pitch * (1.0f - alpha)) + (currentPitch * alpha);
-    roll  = (roll  * (1.0f - alpha)) + (currentRoll  * alpha);
+        // Low Pass Filter
+        pitchQ8 += ((currentPitch * 256 - pitchQ8) * ADXL_ALPHA_Q8) >> 8;
+        rollQ8  += ((currentRoll * 256 - rollQ8) * ADXL_ALPHA_Q8) >> 8;
 
-    float radPitch = pitch * DEG_TO_RAD;
-    float radRoll  = roll  * DEG_TO_RAD;
+        int32_t pitchCdeg = (pitchQ8 + 128) >> 8;
+        int32_t rollCdeg = (rollQ8 + 128) >> 8;
+        data->pitch = (int16_t)pitchCdeg;
+        data->roll  = (int16_t)rollCdeg;
 
-    float gravityX = sin(radRoll) * 9.81;
-    float gravityY = sin(radPitch) * 9.81;
-    float gravityZ = cos(radRoll) * cos(radPitch) * 9.81;
+        int32_t accel[3];
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            accel[axis] = (counts[axis] * ADXL_SCALE_CMS_Q10) >> 10;
+        }
+        RemoveGravityFixed(pitchCdeg, rollCdeg, accel);
+        data->linearAccelX = (int16_t)accel[0];
+        data->linearAccelY = (int16_t)accel[1];
+        data->linearAccelZ = (int16_t)accel[2];
+    #else
+        float event[3];
+        ToAcceleration(counts, event);
 
-    float linearAccelX = event.acceleration.x - gravityX;
-    float linearAccelY = event.acceleration.y - gravityY;
-    float linearAccelZ = event.acceleration.z - gravityZ;
+        float currentPitch = FastAtan2(event[1], event[2]) * FAST_RAD_TO_DEG;
+        float currentRoll  = FastAtan2(-event[0], event[2]) * FAST_RAD_TO_DEG;
 
-    data->pitch = (int16_t)(pitch * 100.0f);
-    data->roll  = (int16_t)(roll * 100.0f);
-    
-    data->linearAccelX = (int16_t)(linearAccelX * 100.0f);
-    data->linearAccelY = (int16_t)(linearAccelY * 100.0f);
-    data->linearAccelZ = (int16_t)(linearAccelZ * 100.0f);
-}
\ No newline at end of file
+        // Low Pass Filter
+        pitch = (pitch * (1.0f - alpha)) + (currentPitch * alpha);
+        roll  = (roll  * (1.0f - alpha)) + (currentRoll  * alpha);
+
+        data->pitch = (int16_t)(pitch * 100.0f);
+        data->roll  = (int16_t)(roll * 100.0f);
+
+        float accel[3] = {event[0], event[1], event[2]};
+        RemoveGravity(pitch, roll, accel);
+        data->linearAccelX = (int16_t)(accel[0] * 100.0f);
+        data->linearAccelY = (int16_t)(accel[1] * 100.0f);
+        data->linearAccelZ = (int16_t)(accel[2] * 100.0f);
+    #endif
+}
@@ -0,0 +1,193 @@
+#include "sensors/BatteryAdcSensor.h"
+#include <esp_timer.h>
+
+#define BATTERY_ADC_TASK_STACK 3072
+#define BATTERY_ADC_FRAMES_BUFFERED 4
+// Reference used when the chip has no Vref/Two Point values burned in
+#define BATTERY_DEFAULT_VREF_MV 1100
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+    #define BATTERY_ADC_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE1
+    #define BATTERY_ADC_RESULT_BYTES 2
+#else
+    #define BATTERY_ADC_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE2
+    #define BATTERY_ADC_RESULT_BYTES 4
+#endif
+
+#define BATTERY_ADC_FRAME_BYTES (BATTERY_ADC_SAMPLE_HZ / BATTERY_ADC_FRAME_HZ * BATTERY_ADC_RESULT_BYTES)
+
+BatteryAdcSensor::BatteryAdcSensor(int voltageChannel, float dividerRatio, int currentChannel, float mvPerAmp, float offsetMv)
+    : _voltageChannel(voltageChannel), _currentChannel(currentChannel), _dividerRatio(dividerRatio),
+      _mvPerAmp(mvPerAmp), _offsetMv(offsetMv)
+{
+}
+
+void BatteryAdcSensor::Init()
+{
+    adc_digi_init_config_t initConfig = {};
+    initConfig.max_store_buf_size = BATTERY_ADC_FRAME_BYTES * BATTERY_ADC_FRAMES_BUFFERED;
+    initConfig.conv_num_each_intr = BATTERY_ADC_FRAME_BYTES;
+    initConfig.adc1_chan_mask = 1 << _voltageChannel;
+    if (_currentChannel >= 0) initConfig.adc1_chan_mask |= 1 << _currentChannel;
+
+    adc_digi_pattern_config_t pattern[2] = {};
+    uint8_t channels[2] = {(uint8_t)_voltageChannel, (uint8_t)_currentChannel};
+    uint8_t patternCount = _currentChannel >= 0 ? 2 : 1;
+    for (uint8_t i = 0; i < patternCount; i++)
+    {
+        pattern[i].atten = ADC_ATTEN_DB_11;
+        pattern[i].channel = channels[i];
+        pattern[i].unit = 0;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = true;
+    config.conv_limit_num = 250;
+    config.pattern_num = patternCount;
+    config.adc_pattern = pattern;
+    config.sample_freq_hz = BATTERY_ADC_SAMPLE_HZ;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = BATTERY_ADC_FORMAT;
+
+    if (adc_digi_initialize(&initConfig) != ESP_OK || adc_digi_controller_configure(&config) != ESP_OK)
+    {
+        Serial.println("Battery ADC init failed!");
+        return;
+    }
+
+    esp_adc_cal_value_t source = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+        BATTERY_DEFAULT_VREF_MV, &_calibration);
+    if (source == ESP_ADC_CAL_VAL_DEFAULT_VREF)
+        Serial.println("Battery ADC: no eFuse calibration, using default Vref");
+
+    if (adc_digi_start() != ESP_OK ||
+        xTaskCreatePinnedToCore(TaskBody, "battery", BATTERY_ADC_TASK_STACK, this, BATTERY_ADC_TASK_PRIORITY, &_task, SYSTEM_CORE) != pdPASS)
+    {
+        Serial.println("Battery ADC start failed!");
+        return;
+    }
+    _initiated = true;
+}
+
+void BatteryAdcSensor::TaskBody(void *arg)
+{
+    BatteryAdcSensor *self = static_cast<BatteryAdcSensor *>(arg);
+    uint8_t buffer[BATTERY_ADC_FRAME_BYTES];
+    for (;;)
+    {
+        uint32_t length = 0;
+        // Blocks until the DMA finished a frame
+        esp_err_t result = adc_digi_read_bytes(buffer, sizeof(buffer), &length, ADC_MAX_DELAY);
+        if (result == ESP_OK)
+        {
+            self->ProcessFrame(buffer, length);
+        }
+        else if (result != ESP_ERR_TIMEOUT)
+        {
+            // ESP_ERR_INVALID_STATE - the task fell behind and the driver dropped data
+            self->_stats.readErrors++;
+        }
+    }
+}
+
+void BatteryAdcSensor::ProcessFrame(const uint8_t *buffer, uint32_t length)
+{
+    TRACE_SCOPE("BatteryAdcSensor::ProcessFrame");
+    uint32_t sums[2] = {0, 0};
+    uint32_t counts[2] = {0, 0};
+    for (uint32_t i = 0; i + BATTERY_ADC_RESULT_BYTES <= length; i += BATTERY_ADC_RESULT_BYTES)
+    {
+        const adc_digi_output_data_t *sample = reinterpret_cast<const adc_digi_output_data_t *>(&buffer[i]);
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+        int channel = sample->type1.channel;
+        uint32_t raw = sample->type1.data;
+#else
+        int channel = sample->type2.unit == 0 ? sample->type2.channel : -1;
+        uint32_t raw = sample->type2.data;
+#endif
+        if (channel == _voltageChannel)
+        {
+            sums[0] += raw;
+            counts[0]++;
+        }
+        else if (_currentChannel >= 0 && channel == _currentChannel)
+        {
+            sums[1] += raw;
+            counts[1]++;
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    _stats.frames++;
+    _stats.samples += counts[0] + counts[1];
+    if (counts[0] == 0)
+    {
+        _stats.emptyFrames++;
+        return;
+    }
+
+    // Averaging before the conversion, the calibration curve is close to linear
+    float voltage = esp_adc_cal_raw_to_voltage(sums[0] / counts[0], &_calibration) * 0.001f * _dividerRatio;
+    float current = 0.0f;
+    if (counts[1] > 0)
+    {
+        float millivolts = (float)esp_adc_cal_raw_to_voltage(sums[1] / counts[1], &_calibration);
+        current = (millivolts - _offsetMv) / _mvPerAmp;
+    }
+
+    float dt = _primed ? (now - _lastFrameUs) * 0.000001f : 0.0f;
+    _lastFrameUs = now;
+    if (!_primed)
+    {
+        _filtered.voltage = voltage;
+        _filtered.current = current;
+        _primed = true;
+    }
+    else
+    {
+        float rc = 1.0f / (2.0f * PI * BATTERY_FILTER_HZ);
+        float alpha = dt / (rc + dt);
+        _filtered.voltage += alpha * (voltage - _filtered.voltage);
+        _filtered.current += alpha * (current - _filtered.current);
+    }
+
+    // Unfiltered current, the filter would only delay the integral
+    _consumedMah += current * dt * (1000.0 / 3600.0);
+    _filtered.consumedMah = (float)_consumedMah;
+    _state.Publish(_filtered, (uint32_t)now);
+}
+
+void BatteryAdcSensor::Update(SensorsData *data)
+{
+    TRACE_SCOPE("BatteryAdcSensor::Update");
+    Snapshot<BatteryState> snapshot;
+    if (!_initiated || !_state.Read(snapshot) || snapshot.sequence == 0) return;
+
+    data->voltage = (int16_t)(snapshot.data.voltage * 100.0f);
+    data->current = (int16_t)(snapshot.data.current * 100.0f);
+    data->consumedMah = (uint16_t)snapshot.data.consumedMah;
+}
+
+bool BatteryAdcSensor::GetState(BatteryState &state) const
+{
+    Snapshot<BatteryState> snapshot;
+    if (!_state.Read(snapshot) || snapshot.sequence == 0) return false;
+    state = snapshot.data;
+    return true;
+}
+
+void BatteryAdcSensor::PrintStats(Print &out) const
+{
+    BatteryState state;
+    GetState(state);
+    BatteryAdcStats stats = _stats;
+    out.printf("[battery] %.2fV %.2fA %.0fmAh frames:%lu samples:%lu empty:%lu errors:%lu\n",
+        state.voltage,
+        state.current,
+        state.consumedMah,
+        (unsigned long)stats.frames,
+        (unsigned long)stats.samples,
+        (unsigned long)stats.emptyFrames,
+        (unsigned long)stats.readErrors);
+}
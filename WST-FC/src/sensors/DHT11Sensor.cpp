@@ -1,33 +1,141 @@
 #include "sensors/DHT11Sensor.h"
+#include <esp_rom_gpio.h>
+#include <soc/gpio_sig_map.h>
 
-DHT11Sensor::DHT11Sensor(int pin, int id) : _dht(pin, DHTTYPE), _id(id)
+// 1 us RMT ticks
+#define DHT_RMT_CLK_DIV 80
+// A '1' holds the line high ~70 us, a '0' ~27 us
+#define DHT_BIT_THRESHOLD_US 48
+
+DHT11Sensor::DHT11Sensor(int pin, int id, uint8_t type, int rmtChannel)
+    : _pin((gpio_num_t)pin), _id(id), _type(type), _channel((rmt_channel_t)rmtChannel)
+{
+}
+
+void DHT11Sensor::Init()
 {
+    rmt_config_t config = RMT_DEFAULT_CONFIG_RX(_pin, _channel);
+    config.clk_div = DHT_RMT_CLK_DIV;
+    // 43 items per frame, one block holds 64 (48 on C3)
+    config.mem_block_num = 1;
+    config.rx_config.filter_en = true;
+    // In APB ticks, drops glitches shorter than ~1 us
+    config.rx_config.filter_ticks_thresh = 80;
+    config.rx_config.idle_threshold = DHT_IDLE_US;
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(_channel, 512, 0) != ESP_OK)
+    {
+        Serial.println("DHT RMT init failed!");
+        return;
+    }
+    rmt_get_ringbuf_handle(_channel, &_ringbuf);
+
+    // The RMT only listens, the start pulse is driven as open-drain GPIO
+    gpio_set_pull_mode(_pin, GPIO_PULLUP_ONLY);
+    gpio_set_direction(_pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    esp_rom_gpio_connect_out_signal(_pin, SIG_GPIO_OUT_IDX, false, false);
+    gpio_set_level(_pin, 1);
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = OnStartPulseDone;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "dht";
+    esp_timer_create(&timerArgs, &_startTimer);
+    _initiated = true;
 }
 
-void DHT11Sensor::Init() 
+void DHT11Sensor::StartTransaction()
 {
-    _dht.begin();
+    _state = STARTING;
+    gpio_set_level(_pin, 0);
+    esp_timer_start_once(_startTimer, _type == DHT_TYPE_DHT22 ? DHT22_START_US : DHT11_START_US);
 }
 
-void DHT11Sensor::Update(SensorsData* data) 
+void DHT11Sensor::OnStartPulseDone(void *arg)
 {
-    unsigned long now = millis();
-    if (now - _lastReadTime > READ_INTERVAL) 
+    DHT11Sensor *self = static_cast<DHT11Sensor *>(arg);
+    // Line is high again before the RMT starts, so the first edge it sees is the reply
+    gpio_set_level(self->_pin, 1);
+    rmt_rx_start(self->_channel, true);
+    self->_releasedUs = esp_timer_get_time();
+    self->_state = RECEIVING;
+}
+
+bool DHT11Sensor::Decode(const rmt_item32_t *items, size_t count, float &temperature, float &humidity)
+{
+    // Every bit ends with its high phase. The first high is the 80 us
+    // response, the last item may close with a zero length idle high.
+    uint8_t bytes[5] = {0, 0, 0, 0, 0};
+    int bit = -1;
+    for (size_t i = 0; i < count && bit < 40; i++)
     {
-        _lastReadTime = now;
+        const uint32_t levels[2] = {items[i].level0, items[i].level1};
+        const uint32_t durations[2] = {items[i].duration0, items[i].duration1};
+        for (uint8_t half = 0; half < 2 && bit < 40; half++)
+        {
+            if (levels[half] == 0 || durations[half] == 0) continue;
+            if (bit >= 0 && durations[half] > DHT_BIT_THRESHOLD_US)
+                bytes[bit / 8] |= 0x80 >> (bit % 8);
+            bit++;
+        }
+    }
+    if (bit < 40) return false;
+    if ((uint8_t)(bytes[0] + bytes[1] + bytes[2] + bytes[3]) != bytes[4]) return false;
 
-        float temp = _dht.readTemperature();
-        float hum = _dht.readHumidity();
+    if (_type == DHT_TYPE_DHT22)
+    {
+        humidity = ((bytes[0] << 8) | bytes[1]) * 0.1f;
+        temperature = (((bytes[2] & 0x7F) << 8) | bytes[3]) * 0.1f;
+        if (bytes[2] & 0x80) temperature = -temperature;
+    }
+    else
+    {
+        // DHT11 keeps the sign in the top bit of the tenths byte
+        humidity = bytes[0] + bytes[1] * 0.1f;
+        temperature = bytes[2] + (bytes[3] & 0x0F) * 0.1f;
+        if (bytes[3] & 0x80) temperature = -temperature;
+    }
+    return true;
+}
+
+void DHT11Sensor::Update(SensorsData* data)
+{
+    TRACE_SCOPE("DHT11Sensor::Update");
+    if (!_initiated || _state == STARTING) return;
+
+    if (_state == RECEIVING)
+    {
+        // Called faster than a frame takes, come back later
+        if (esp_timer_get_time() - _releasedUs < DHT_FRAME_US) return;
+
+        size_t length = 0;
+        rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(_ringbuf, &length, 0);
+        rmt_rx_stop(_channel);
 
-        if (isnan(temp) || isnan(hum)) 
+        float temp = 0.0f;
+        float hum = 0.0f;
+        bool ok = false;
+        if (items != nullptr)
         {
-            return;
+            ok = Decode(items, length / sizeof(rmt_item32_t), temp, hum);
+            vRingbufferReturnItem(_ringbuf, items);
         }
-        
-        if (_id >= 0 && _id < 4)
+        _state = IDLE;
+
+        if (ok)
         {
-            data->other[_id]   = (int16_t)(temp * 100.0f);
-            data->other[_id+1] = (int16_t)(hum * 100.0f);
+            _reads++;
+            if (_id >= 0 && _id < 4)
+            {
+                data->other[_id]   = (int16_t)(temp * 100.0f);
+                data->other[_id+1] = (int16_t)(hum * 100.0f);
+            }
+        }
+        else
+        {
+            _errors++;
         }
     }
-}
\ No newline at end of file
+
+    StartTransaction();
+}
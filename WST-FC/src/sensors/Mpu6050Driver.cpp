@@ -0,0 +1,220 @@
+#include "sensors/Mpu6050Driver.h"
+#include "FastMath.h"
+
+#define MPU_REG_SMPLRT_DIV 0x19
+#define MPU_REG_CONFIG 0x1A
+#define MPU_REG_GYRO_CONFIG 0x1B
+#define MPU_REG_ACCEL_CONFIG 0x1C
+#define MPU_REG_FIFO_EN 0x23
+#define MPU_REG_INT_PIN_CFG 0x37
+#define MPU_REG_INT_ENABLE 0x38
+#define MPU_REG_USER_CTRL 0x6A
+#define MPU_REG_PWR_MGMT_1 0x6B
+#define MPU_REG_FIFO_COUNTH 0x72
+#define MPU_REG_FIFO_R_W 0x74
+#define MPU_REG_WHO_AM_I 0x75
+
+// +-8 g and +-500 deg/s, same ranges as the Adafruit setup
+#define MPU_ACCEL_SCALE (GRAVITY / 4096.0f)
+#define MPU_GYRO_SCALE (FAST_DEG_TO_RAD / 65.5f)
+
+void IRAM_ATTR Mpu6050Driver::ISR(void *arg)
+{
+    Mpu6050Driver *self = static_cast<Mpu6050Driver *>(arg);
+    self->HandleInterrupt();
+}
+
+void IRAM_ATTR Mpu6050Driver::HandleInterrupt()
+{
+    uint32_t now = micros();
+    portENTER_CRITICAL_ISR(&_mux);
+    _readyTimes[_readyCount % MPU6050_TIMESTAMP_RING] = now;
+    _readyCount = _readyCount + 1;
+    portEXIT_CRITICAL_ISR(&_mux);
+}
+
+uint32_t Mpu6050Driver::GetReadyCount()
+{
+    portENTER_CRITICAL(&_mux);
+    uint32_t count = _readyCount;
+    portEXIT_CRITICAL(&_mux);
+    return count;
+}
+
+// Reset, then enable again. _consumed is resynced once the enable went out.
+void Mpu6050Driver::ResetFifo()
+{
+    if (!_bus->Write(_address, MPU_REG_USER_CTRL, 0x04)
+        || !_bus->Write(_address, MPU_REG_USER_CTRL, 0x40, OnFifoReset, this))
+    {
+        _busy = false;
+    }
+}
+
+void Mpu6050Driver::OnFifoReset(void *context, bool ok)
+{
+    Mpu6050Driver *self = static_cast<Mpu6050Driver *>(context);
+    if (!ok) self->_busErrors++;
+    self->_consumed = self->GetReadyCount();
+    self->_busy = false;
+}
+
+bool Mpu6050Driver::Begin(int8_t intPin, uint16_t sampleRateHz, uint8_t dlpf, uint8_t address)
+{
+    _address = address;
+    _intPin = intPin;
+
+    uint8_t whoAmI = 0;
+    if (!_bus->ReadSync(_address, MPU_REG_WHO_AM_I, &whoAmI, 1) || whoAmI != 0x68) return false;
+
+    // Wake up, clock from the X gyro PLL
+    _bus->WriteSync(_address, MPU_REG_PWR_MGMT_1, 0x80);
+    delay(100);
+    _bus->WriteSync(_address, MPU_REG_PWR_MGMT_1, 0x01);
+
+    if (dlpf < 1) dlpf = 1;
+    if (dlpf > 6) dlpf = 6;
+    if (sampleRateHz < 4) sampleRateHz = 4;
+    if (sampleRateHz > 1000) sampleRateHz = 1000;
+    uint8_t divider = 1000 / sampleRateHz - 1;
+    _samplePeriodUs = 1000UL * (divider + 1);
+
+    _bus->WriteSync(_address, MPU_REG_CONFIG, dlpf);
+    _bus->WriteSync(_address, MPU_REG_SMPLRT_DIV, divider);
+    _bus->WriteSync(_address, MPU_REG_GYRO_CONFIG, 0x08);
+    _bus->WriteSync(_address, MPU_REG_ACCEL_CONFIG, 0x10);
+
+    // 50 us active-high pulse on every data ready
+    _bus->WriteSync(_address, MPU_REG_INT_PIN_CFG, 0x00);
+    _bus->WriteSync(_address, MPU_REG_INT_ENABLE, 0x01);
+
+    if (_intPin >= 0)
+    {
+        pinMode(_intPin, INPUT);
+        attachInterruptArg(digitalPinToInterrupt(_intPin), ISR, this, RISING);
+    }
+
+    _bus->WriteSync(_address, MPU_REG_FIFO_EN, 0x78);
+    _bus->WriteSync(_address, MPU_REG_USER_CTRL, 0x04);
+    _bus->WriteSync(_address, MPU_REG_USER_CTRL, 0x40);
+    _consumed = GetReadyCount();
+    return true;
+}
+
+void Mpu6050Driver::OnCount(void *context, bool ok)
+{
+    Mpu6050Driver *self = static_cast<Mpu6050Driver *>(context);
+    if (!ok)
+    {
+        self->_busErrors++;
+        self->_busy = false;
+        return;
+    }
+    self->_countTime = micros();
+    uint16_t count = (self->_countBytes[0] << 8) | self->_countBytes[1];
+
+    // Full FIFO drops samples and a partial one loses alignment, start over.
+    // Same when the backlog outgrew the timestamp ring, it is stale anyway.
+    if (count > MPU6050_FIFO_SIZE - MPU6050_FIFO_SAMPLE_SIZE || count % MPU6050_FIFO_SAMPLE_SIZE != 0
+        || count / MPU6050_FIFO_SAMPLE_SIZE >= MPU6050_TIMESTAMP_RING)
+    {
+        self->_overflows++;
+        self->ResetFifo();
+        return;
+    }
+
+    uint16_t available = count / MPU6050_FIFO_SAMPLE_SIZE;
+    if (self->_intPin >= 0)
+    {
+        // Every FIFO sample has an INT behind it, at most one more may have
+        // fired after the count was read. Anything else means we lost track.
+        uint32_t readyCount = self->GetReadyCount();
+        uint32_t pending = readyCount - self->_consumed;
+        if (pending < available || pending > available + 1u)
+        {
+            self->_consumed = readyCount - available;
+            self->_resyncs++;
+        }
+    }
+
+    if (available == 0)
+    {
+        self->_busy = false;
+        return;
+    }
+    self->_fifoAvailable = available;
+    self->_fifoReading = available < MPU6050_BURST_SAMPLES ? available : MPU6050_BURST_SAMPLES;
+    if (!self->_bus->Read(self->_address, MPU_REG_FIFO_R_W, self->_fifoBuffer, self->_fifoReading * MPU6050_FIFO_SAMPLE_SIZE, OnFifo, self))
+    {
+        self->_busy = false;
+    }
+}
+
+void Mpu6050Driver::OnFifo(void *context, bool ok)
+{
+    Mpu6050Driver *self = static_cast<Mpu6050Driver *>(context);
+    if (!ok)
+    {
+        // Bytes may have left the FIFO, alignment is unknown
+        self->_busErrors++;
+        self->ResetFifo();
+        return;
+    }
+
+    for (uint8_t i = 0; i < self->_fifoReading; i++)
+    {
+        const uint8_t *raw = self->_fifoBuffer + i * MPU6050_FIFO_SAMPLE_SIZE;
+        MpuSample sample;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            sample.accel[axis] = (int16_t)((raw[axis * 2] << 8) | raw[axis * 2 + 1]) * MPU_ACCEL_SCALE;
+            sample.gyro[axis] = (int16_t)((raw[6 + axis * 2] << 8) | raw[7 + axis * 2]) * MPU_GYRO_SCALE;
+        }
+
+        if (self->_intPin >= 0)
+        {
+            portENTER_CRITICAL(&self->_mux);
+            sample.timeUs = self->_readyTimes[self->_consumed % MPU6050_TIMESTAMP_RING];
+            portEXIT_CRITICAL(&self->_mux);
+            self->_consumed++;
+        }
+        else
+        {
+            // Newest sample at the time of the count read
+            sample.timeUs = self->_countTime - (self->_fifoAvailable - 1 - i) * self->_samplePeriodUs;
+        }
+
+        // Oldest sample is overwritten if Read() fell behind
+        portENTER_CRITICAL(&self->_mux);
+        uint8_t slot = (self->_queueHead + self->_queueCount) % MPU6050_SAMPLE_QUEUE;
+        self->_queue[slot] = sample;
+        if (self->_queueCount < MPU6050_SAMPLE_QUEUE) self->_queueCount++;
+        else self->_queueHead = (self->_queueHead + 1) % MPU6050_SAMPLE_QUEUE;
+        portEXIT_CRITICAL(&self->_mux);
+    }
+    self->_busy = false;
+}
+
+uint8_t Mpu6050Driver::Read(MpuSample *samples, uint8_t maxSamples)
+{
+    uint8_t count = 0;
+    portENTER_CRITICAL(&_mux);
+    while (count < maxSamples && _queueCount > 0)
+    {
+        samples[count++] = _queue[_queueHead];
+        _queueHead = (_queueHead + 1) % MPU6050_SAMPLE_QUEUE;
+        _queueCount--;
+    }
+    portEXIT_CRITICAL(&_mux);
+    _samplesRead += count;
+
+    if (!_busy)
+    {
+        _busy = true;
+        if (!_bus->Read(_address, MPU_REG_FIFO_COUNTH, _countBytes, 2, OnCount, this))
+        {
+            _busy = false;
+        }
+    }
+    return count;
+}
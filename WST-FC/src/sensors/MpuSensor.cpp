@@ -1,8 +1,34 @@
 #include "sensors/MpuSensor.h"
+#include "FastMath.h"
 
 void MpuSensor::Init() {
+#if MPU_NATIVE_DRIVER
+    if (!mpu.Begin(MPU_INT_PIN, MPU_SAMPLE_RATE_HZ, MPU_DLPF_CFG))
+    {
+        Serial.println("MPU6050 not found!");
+        return;
+    }
+    mpuInitiated = true;
+
+    // First samples after the FIFO reset, reads complete on the bus task
+    for (uint8_t attempt = 0; attempt < 20; attempt++)
+    {
+        delay(1);
+        uint8_t count = mpu.Read(samples, MPU6050_BURST_SAMPLES);
+        if (count > 0)
+        {
+            const MpuSample &last = samples[count - 1];
+            estimator.Reset(last.accel[0], last.accel[1], last.accel[2]);
+            lastTime = last.timeUs;
+            return;
+        }
+    }
+#else
+    // Adafruit talks to Wire directly, keep the bus task out meanwhile
+    bus->Lock();
     if (!mpu.begin()) 
     {
+        bus->Unlock();
         Serial.println("MPU6050 not found!");
         return;
     }
@@ -14,45 +40,69 @@ void MpuSensor::Init() {
 
     sensors_event_t a, g, temp;
     mpu.getEvent(&a, &g, &temp);
-    pitch = atan2(a.acceleration.y, a.acceleration.z) * RAD_TO_DEG;
-    roll  = atan2(-a.acceleration.x, a.acceleration.z) * RAD_TO_DEG;
+    bus->Unlock();
+    estimator.Reset(a.acceleration.x, a.acceleration.y, a.acceleration.z);
+#endif
 
-    lastTime = millis();
+    lastTime = micros();
 }
 
-void MpuSensor::Update(SensorsData* data) 
+void MpuSensor::Integrate(const float accel[3], const float gyro[3], unsigned long sampleTime)
 {
-    if(mpuInitiated == false) return;
-    sensors_event_t a, g, temp;
-    mpu.getEvent(&a, &g, &temp);
+    // Microseconds, millis() quantizes dt to 0 or 1 ms at high loop rates
+    float dt = (sampleTime - lastTime) * 1e-6f;
+    lastTime = sampleTime;
+    if (dt > MPU_MAX_DT) dt = MPU_MAX_DT;
 
-    unsigned long currentTime = millis();
-    float dt = (currentTime - lastTime) / 1000.0;
-    lastTime = currentTime;
+    #if LOG_IMU_SAMPLES
+        Serial.printf("%lu,%.4f,%.4f,%.4f,%.5f,%.5f,%.5f\n", sampleTime,
+            accel[0], accel[1], accel[2], gyro[0], gyro[1], gyro[2]);
+    #endif
 
-    // Filters
-    float accelPitch = atan2(a.acceleration.y, a.acceleration.z) * RAD_TO_DEG;
-    float accelRoll = atan2(-a.acceleration.x, a.acceleration.z) * RAD_TO_DEG;
+    estimator.Update(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], dt);
+}
 
-    pitch = 0.96 * (pitch + g.gyro.x * RAD_TO_DEG * dt) + 0.04 * accelPitch;
-    roll  = 0.96 * (roll  + g.gyro.y * RAD_TO_DEG * dt) + 0.04 * accelRoll; 
+void MpuSensor::Publish(SensorsData *data, const float accel[3], const float gyro[3])
+{
+    //Output
+    data->pitch = (int16_t)(estimator.GetPitch() * 100.0f);
+    data->roll = (int16_t)(estimator.GetRoll() * 100.0f);
 
-    //Accel
-    float radPitch = pitch * DEG_TO_RAD;
-    float radRoll  = roll  * DEG_TO_RAD;
+    //Gyro, rad/s -> decidegrees/s
+    data->gyroX = (int16_t)(gyro[0] * FAST_RAD_TO_DEG * 10.0f);
+    data->gyroY = (int16_t)(gyro[1] * FAST_RAD_TO_DEG * 10.0f);
+    data->gyroZ = (int16_t)(gyro[2] * FAST_RAD_TO_DEG * 10.0f);
 
-    float gravityX = sin(radRoll) * 9.81;
-    float gravityY = sin(radPitch) * 9.81;
-    float gravityZ = cos(radRoll) * cos(radPitch) * 9.81;
+    //Accel
+    float gravity[3];
+    estimator.GetGravity(gravity);
+    data->linearAccelX = (int16_t)((accel[0] - gravity[0] * GRAVITY) * 100.0f);
+    data->linearAccelY = (int16_t)((accel[1] - gravity[1] * GRAVITY) * 100.0f);
+    data->linearAccelZ = (int16_t)((accel[2] - gravity[2] * GRAVITY) * 100.0f);
+}
 
-    float linearAccelX = a.acceleration.x - gravityX;
-    float linearAccelY = a.acceleration.y - gravityY;
-    float linearAccelZ = a.acceleration.z - gravityZ;
+void MpuSensor::Update(SensorsData* data) 
+{
+    TRACE_SCOPE("MpuSensor::Update");
+    if(mpuInitiated == false) return;
 
-    //Output
-    data->pitch = (int16_t)(pitch * 100.0f);
-    data->roll = (int16_t)(roll * 100.0f);
-    data->linearAccelX = (int16_t)(linearAccelX * 100.0f);
-    data->linearAccelY= (int16_t)(linearAccelY * 100.0f);
-    data->linearAccelZ = (int16_t)(linearAccelZ * 100.0f);
-}
\ No newline at end of file
+#if MPU_NATIVE_DRIVER
+    // Every sample the chip produced since the last call, each with its own dt
+    uint8_t count = mpu.Read(samples, MPU6050_BURST_SAMPLES);
+    if (count == 0) return;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        Integrate(samples[i].accel, samples[i].gyro, samples[i].timeUs);
+    }
+    Publish(data, samples[count - 1].accel, samples[count - 1].gyro);
+#else
+    sensors_event_t a, g, temp;
+    bus->Lock();
+    mpu.getEvent(&a, &g, &temp);
+    bus->Unlock();
+    float accel[3] = {a.acceleration.x, a.acceleration.y, a.acceleration.z};
+    float gyro[3] = {g.gyro.x, g.gyro.y, g.gyro.z};
+    Integrate(accel, gyro, micros());
+    Publish(data, accel, gyro);
+#endif
+}
@@ -0,0 +1,288 @@
+#include "sensors/UltrasonicArray.h"
+#include "FastMath.h"
+#include <esp_timer.h>
+#include <esp_rom_gpio.h>
+#include <soc/gpio_sig_map.h>
+
+#if SOC_MCPWM_SUPPORTED
+    // Capture timer runs from APB
+    #define ULTRASONIC_TICKS_PER_US 80
+#else
+    #define ULTRASONIC_TICKS_PER_US 1
+#endif
+
+// 1 us RMT ticks, 10 us trigger pulse
+#define ULTRASONIC_RMT_CLK_DIV 80
+#define ULTRASONIC_TRIGGER_US 10
+// ~4.5 m, HC-SR04 rated range
+#define ULTRASONIC_MAX_CM 450
+
+UltrasonicArray::UltrasonicArray(const uint8_t *trigPins, const uint8_t *echoPins, uint8_t count, FiringPattern pattern,
+    uint8_t firstSlot, int rmtChannel)
+    : _rmtChannel((rmt_channel_t)rmtChannel)
+{
+    // Clipped to the distanceSensors slots that are left
+    _firstSlot = firstSlot < ULTRASONIC_MAX_CHANNELS ? firstSlot : ULTRASONIC_MAX_CHANNELS;
+    _count = count < ULTRASONIC_MAX_CHANNELS - _firstSlot ? count : ULTRASONIC_MAX_CHANNELS - _firstSlot;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        _channels[i].owner = this;
+        _channels[i].index = i;
+        _channels[i].trigPin = trigPins[i];
+        _channels[i].echoPin = echoPins[i];
+    }
+
+    if (pattern == OPPOSITE_PAIRS)
+    {
+        uint8_t half = (_count + 1) / 2;
+        for (uint8_t i = 0; i < half; i++)
+        {
+            _groupMasks[i] = 1 << i;
+            if (i + half < _count) _groupMasks[i] |= 1 << (i + half);
+        }
+        _groupCount = half;
+    }
+    else
+    {
+        for (uint8_t i = 0; i < _count; i++)
+        {
+            _groupMasks[i] = 1 << i;
+        }
+        _groupCount = _count;
+    }
+
+    _pulse.level0 = 1;
+    _pulse.duration0 = ULTRASONIC_TRIGGER_US;
+    _pulse.level1 = 0;
+    _pulse.duration1 = ULTRASONIC_TRIGGER_US;
+}
+
+void IRAM_ATTR UltrasonicArray::HandleEdge(Channel &channel, bool rising, uint32_t ticks)
+{
+    portENTER_CRITICAL_ISR(&_mux);
+    if (channel.armed)
+    {
+        if (rising)
+        {
+            channel.riseTicks = ticks;
+            channel.rising = true;
+        }
+        else if (channel.rising)
+        {
+            // Falling edge without our rising one is the tail of an old echo
+            channel.echoTicks = ticks - channel.riseTicks;
+            channel.done = true;
+            channel.armed = false;
+        }
+    }
+    portEXIT_CRITICAL_ISR(&_mux);
+}
+
+#if SOC_MCPWM_SUPPORTED
+bool IRAM_ATTR UltrasonicArray::OnCapture(mcpwm_unit_t unit, mcpwm_capture_channel_id_t capture, const cap_event_data_t *event, void *arg)
+{
+    Channel *channel = static_cast<Channel *>(arg);
+    channel->owner->HandleEdge(*channel, event->cap_edge == MCPWM_POS_EDGE, event->cap_value);
+    return false;
+}
+#else
+void IRAM_ATTR UltrasonicArray::OnEchoChange(void *arg)
+{
+    Channel *channel = static_cast<Channel *>(arg);
+    channel->owner->HandleEdge(*channel, digitalRead(channel->echoPin) == HIGH, (uint32_t)esp_timer_get_time());
+}
+#endif
+
+void UltrasonicArray::Init()
+{
+    if (_count == 0) return;
+
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)_channels[0].trigPin, _rmtChannel);
+    config.clk_div = ULTRASONIC_RMT_CLK_DIV;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(_rmtChannel, 0, 0) != ESP_OK)
+    {
+        Serial.println("Ultrasonic RMT init failed!");
+        return;
+    }
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        Channel &channel = _channels[i];
+        pinMode(channel.trigPin, OUTPUT);
+        digitalWrite(channel.trigPin, LOW);
+        pinMode(channel.echoPin, INPUT);
+
+#if SOC_MCPWM_SUPPORTED
+        mcpwm_unit_t unit = (mcpwm_unit_t)(i / 3);
+        mcpwm_capture_channel_id_t capture = (mcpwm_capture_channel_id_t)(i % 3);
+        mcpwm_gpio_init(unit, (mcpwm_io_signals_t)(MCPWM_CAP_0 + i % 3), channel.echoPin);
+
+        mcpwm_capture_config_t captureConfig = {};
+        captureConfig.cap_edge = MCPWM_BOTH_EDGE;
+        captureConfig.cap_prescale = 1;
+        captureConfig.capture_cb = OnCapture;
+        captureConfig.user_data = &channel;
+        mcpwm_capture_enable_channel(unit, capture, &captureConfig);
+#else
+        attachInterruptArg(digitalPinToInterrupt(channel.echoPin), OnEchoChange, &channel, CHANGE);
+#endif
+    }
+
+    _statsSinceUs = esp_timer_get_time();
+    _doneUs = _statsSinceUs - ULTRASONIC_GUARD_US;
+    _initiated = true;
+}
+
+// Routes the RMT output to every trigger pin in the group and sends one pulse
+void UltrasonicArray::Fire()
+{
+    uint8_t mask = _groupMasks[_group];
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        Channel &channel = _channels[i];
+        if (mask & (1 << i))
+        {
+            rmt_set_gpio(_rmtChannel, RMT_MODE_TX, (gpio_num_t)channel.trigPin, false);
+            portENTER_CRITICAL(&_mux);
+            channel.armed = true;
+            channel.rising = false;
+            channel.done = false;
+            portEXIT_CRITICAL(&_mux);
+        }
+        else
+        {
+            esp_rom_gpio_connect_out_signal(channel.trigPin, SIG_GPIO_OUT_IDX, false, false);
+            digitalWrite(channel.trigPin, LOW);
+        }
+    }
+
+    _fireUs = esp_timer_get_time();
+    _inFlight = true;
+    rmt_write_items(_rmtChannel, &_pulse, 1, false);
+}
+
+uint16_t UltrasonicArray::Median(const Channel &channel) const
+{
+    uint16_t sorted[ULTRASONIC_MEDIAN_WINDOW];
+    uint8_t count = channel.windowCount;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint16_t value = channel.window[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > value; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = value;
+    }
+    return sorted[count / 2];
+}
+
+void UltrasonicArray::Collect(SensorsData *data, int64_t now)
+{
+    uint8_t mask = _groupMasks[_group];
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (!(mask & (1 << i))) continue;
+        Channel &channel = _channels[i];
+
+        portENTER_CRITICAL(&_mux);
+        bool done = channel.done;
+        uint32_t echoTicks = channel.echoTicks;
+        channel.armed = false;
+        channel.done = false;
+        portEXIT_CRITICAL(&_mux);
+
+        uint32_t distance = done ? EchoMicrosToCm(echoTicks / ULTRASONIC_TICKS_PER_US) : 0;
+        if (!done || distance > ULTRASONIC_MAX_CM)
+        {
+            // Keep the last filtered value, nothing came back in range
+            channel.stats.timeouts++;
+            continue;
+        }
+
+        channel.window[channel.windowIndex] = (uint16_t)distance;
+        channel.windowIndex = (channel.windowIndex + 1) % ULTRASONIC_MEDIAN_WINDOW;
+        if (channel.windowCount < ULTRASONIC_MEDIAN_WINDOW) channel.windowCount++;
+        data->distanceSensors[_firstSlot + i] = Median(channel);
+
+        UltrasonicChannelStats &stats = channel.stats;
+        uint32_t latency = (uint32_t)(now - _fireUs);
+        stats.measurements++;
+        stats.lastLatencyUs = latency;
+        stats.latencySumUs += latency;
+        if (latency > stats.maxLatencyUs) stats.maxLatencyUs = latency;
+    }
+}
+
+void UltrasonicArray::Update(SensorsData *data)
+{
+    TRACE_SCOPE("UltrasonicArray::Update");
+    if (!_initiated) return;
+    int64_t now = esp_timer_get_time();
+
+    if (_inFlight)
+    {
+        uint8_t mask = _groupMasks[_group];
+        bool allDone = true;
+        portENTER_CRITICAL(&_mux);
+        for (uint8_t i = 0; i < _count; i++)
+        {
+            if ((mask & (1 << i)) && !_channels[i].done) allDone = false;
+        }
+        portEXIT_CRITICAL(&_mux);
+        if (!allDone && now - _fireUs < ULTRASONIC_TIMEOUT_US) return;
+
+        Collect(data, now);
+        _inFlight = false;
+        _doneUs = now;
+        _group = (_group + 1) % _groupCount;
+    }
+
+    if (now - _doneUs >= ULTRASONIC_GUARD_US) Fire();
+}
+
+UltrasonicChannelStats UltrasonicArray::GetStats(uint8_t index) const
+{
+    if (index >= _count) return UltrasonicChannelStats();
+    return _channels[index].stats;
+}
+
+float UltrasonicArray::GetAggregateRate() const
+{
+    int64_t elapsed = esp_timer_get_time() - _statsSinceUs;
+    if (elapsed <= 0) return 0.0f;
+    uint32_t measurements = 0;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        measurements += _channels[i].stats.measurements;
+    }
+    return measurements * 1000000.0f / elapsed;
+}
+
+void UltrasonicArray::ResetStats()
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        _channels[i].stats = UltrasonicChannelStats();
+    }
+    _statsSinceUs = esp_timer_get_time();
+}
+
+void UltrasonicArray::PrintStats(Print &out) const
+{
+    int64_t elapsed = esp_timer_get_time() - _statsSinceUs;
+    out.printf("[sonar] channels:%u groups:%u aggregate:%.1fHz\n", (unsigned)_count, (unsigned)_groupCount, GetAggregateRate());
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        UltrasonicChannelStats stats = _channels[i].stats;
+        uint32_t measurements = stats.measurements > 0 ? stats.measurements : 1;
+        out.printf("[sonar %u] slot:%u rate:%.1fHz latency avg/max:%lu/%luus timeouts:%lu\n",
+            (unsigned)i,
+            (unsigned)(_firstSlot + i),
+            elapsed > 0 ? stats.measurements * 1000000.0f / elapsed : 0.0f,
+            (unsigned long)(stats.latencySumUs / measurements),
+            (unsigned long)stats.maxLatencyUs,
+            (unsigned long)stats.timeouts);
+    }
+}
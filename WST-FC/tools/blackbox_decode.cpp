@@ -0,0 +1,232 @@
+// Decodes blackbox logs (BlackboxFormat.h) on the host into CSV, one row
+// per control tick.
+//
+//   g++ -std=c++17 -O2 -I../include blackbox_decode.cpp -o blackbox_decode
+//   esptool.py read_flash 0x290000 0x160000 blackbox.bin   # partitions_blackbox.csv
+//   ./blackbox_decode --list blackbox.bin                    # sessions in the dump
+//   ./blackbox_decode blackbox.bin > flight.csv              # newest session
+//   ./blackbox_decode --session 12 blackbox.bin              # a given one
+//   ./blackbox_decode blackbox_003.bbx > flight.csv          # SD card file (esp32cam)
+//   ./blackbox_decode --selftest                             # writer -> reader round trip
+//
+// Columns: session,t_us,<BlackboxRecord fields>, one type per column and
+// no empty cells, so pandas/polars/duckdb load it as is (and write it out
+// as Parquet). Values are in engineering units (degrees, degrees/s, m/s^2,
+// mixer units); --raw prints the stored integers. t_us is 64 bit and keeps
+// counting across the 71 minute micros() wrap. Dropped records and missing
+// or corrupt blocks are reported on stderr.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "BlackboxFormat.h"
+
+struct Block
+{
+    BlackboxBlockHeader header;
+    std::vector<uint8_t> data;
+};
+
+static std::vector<Block> ReadBlocks(const char *path, uint32_t &corrupt)
+{
+    std::vector<Block> blocks;
+    corrupt = 0;
+    FILE *input = fopen(path, "rb");
+    if (input == nullptr)
+    {
+        perror(path);
+        return blocks;
+    }
+    std::vector<uint8_t> data(BLACKBOX_BLOCK_SIZE);
+    while (fread(data.data(), 1, data.size(), input) == data.size())
+    {
+        BlackboxBlockReader reader(data.data());
+        if (reader.IsValid())
+        {
+            blocks.push_back({reader.GetHeader(), data});
+        }
+        else if (reader.GetHeader().magic == BLACKBOX_MAGIC)
+        {
+            // Torn by a power loss, or written by another version
+            corrupt++;
+        }
+    }
+    fclose(input);
+    // The flash ring starts anywhere, order by session and block number
+    std::sort(blocks.begin(), blocks.end(), [](const Block &a, const Block &b) {
+        if (a.header.session != b.header.session) return a.header.session < b.header.session;
+        return a.header.sequence < b.header.sequence;
+    });
+    return blocks;
+}
+
+static void PrintHeader()
+{
+    printf("session,t_us");
+    for (size_t i = 0; i < BLACKBOX_FIELDS; i++)
+        printf(",%s", BLACKBOX_FIELD_NAMES[i]);
+    printf("\n");
+}
+
+static void PrintRow(uint32_t session, uint64_t timeUs, const BlackboxRecord &record, bool raw)
+{
+    int16_t values[BLACKBOX_FIELDS];
+    memcpy(values, &record, sizeof(record));
+    printf("%u,%llu", session, (unsigned long long)timeUs);
+    for (size_t i = 0; i < BLACKBOX_FIELDS; i++)
+    {
+        if (raw || BLACKBOX_FIELD_SCALES[i] == 1.0f) printf(",%d", values[i]);
+        else printf(",%.2f", values[i] * BLACKBOX_FIELD_SCALES[i]);
+    }
+    printf("\n");
+}
+
+static int List(const std::vector<Block> &blocks)
+{
+    printf("session,blocks,first_block,last_block,seconds\n");
+    for (size_t i = 0; i < blocks.size();)
+    {
+        size_t end = i;
+        while (end < blocks.size() && blocks[end].header.session == blocks[i].header.session) end++;
+        const BlackboxBlockHeader &first = blocks[i].header;
+        const BlackboxBlockHeader &last = blocks[end - 1].header;
+        printf("%u,%zu,%u,%u,%.1f\n", first.session, end - i, first.sequence, last.sequence,
+            (uint32_t)(last.firstUs - first.firstUs) * 1e-6);
+        i = end;
+    }
+    return 0;
+}
+
+static int Decode(const std::vector<Block> &blocks, uint32_t session, bool raw)
+{
+    PrintHeader();
+    uint64_t timeUs = 0;
+    uint32_t lastUs = 0;
+    bool started = false;
+    uint32_t expected = 0;
+    uint32_t rows = 0;
+    uint32_t dropped = 0;
+    uint32_t missing = 0;
+    // Valid CRC but a record that does not decode, a format mismatch
+    uint32_t broken = 0;
+    for (const Block &block : blocks)
+    {
+        if (block.header.session != session) continue;
+        if (started && block.header.sequence != expected) missing += block.header.sequence - expected;
+        expected = block.header.sequence + 1;
+        dropped += block.header.dropped;
+
+        BlackboxBlockReader reader(block.data.data());
+        BlackboxRecord record;
+        uint32_t recordUs;
+        while (reader.Next(record, recordUs))
+        {
+            timeUs = started ? timeUs + (uint32_t)(recordUs - lastUs) : recordUs;
+            lastUs = recordUs;
+            started = true;
+            PrintRow(session, timeUs, record, raw);
+            rows++;
+        }
+        if (!reader.AtEnd()) broken++;
+    }
+    fprintf(stderr, "session %u: rows:%u dropped:%u missing blocks:%u unreadable blocks:%u\n",
+        session, rows, dropped, missing, broken);
+    return rows > 0 ? 0 : 1;
+}
+
+// Random walk records through the block writer and reader, every record
+// must come back unchanged and in order
+static int RunSelfTest()
+{
+    std::mt19937 random(11);
+    std::vector<uint8_t> block(BLACKBOX_BLOCK_SIZE);
+    BlackboxBlockWriter writer;
+    int16_t values[BLACKBOX_FIELDS] = {};
+    std::vector<BlackboxRecord> written;
+    uint32_t timeUs = 0xFFFF0000; // crosses the micros() wrap
+    uint32_t sequence = 0;
+    size_t bytes = 0;
+    int mismatches = 0;
+    int records = 0;
+
+    // Seals the block and reads it back
+    auto check = [&]() {
+        writer.Finish();
+        BlackboxBlockReader reader(block.data());
+        if (!reader.IsValid()) mismatches++;
+        bytes += sizeof(BlackboxBlockHeader) + reader.GetHeader().used;
+        BlackboxRecord decoded;
+        uint32_t decodedUs;
+        size_t index = 0;
+        while (reader.Next(decoded, decodedUs))
+        {
+            if (index >= written.size() || memcmp(&decoded, &written[index], sizeof(decoded)) != 0) mismatches++;
+            index++;
+        }
+        if (index != written.size() || !reader.AtEnd()) mismatches++;
+        records += index;
+        written.clear();
+    };
+
+    writer.Begin(block.data(), 1, sequence++, 0);
+    for (int tick = 0; tick < 100000; tick++)
+    {
+        for (size_t i = 0; i < BLACKBOX_FIELDS; i++)
+            values[i] += (int)(random() % 21) - 10;
+        BlackboxRecord record;
+        memcpy(&record, values, sizeof(record));
+        timeUs += 2000 + random() % 20;
+
+        if (!writer.Append(record, timeUs))
+        {
+            check();
+            writer.Begin(block.data(), 1, sequence++, 0);
+            writer.Append(record, timeUs);
+        }
+        written.push_back(record);
+    }
+    check();
+
+    // A flipped bit must fail the CRC
+    block[sizeof(BlackboxBlockHeader) + 10] ^= 0x04;
+    bool corruptRejected = !BlackboxBlockReader(block.data()).IsValid();
+
+    printf("records:%d blocks:%u %.1f B/record (raw %zu) mismatches:%d corrupt block rejected:%s\n",
+        records, sequence, (float)bytes / records, sizeof(BlackboxRecord), mismatches, corruptRejected ? "yes" : "no");
+    return mismatches == 0 && records == 100000 && corruptRejected ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    bool raw = false;
+    bool list = false;
+    long session = -1;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--selftest") == 0) return RunSelfTest();
+        else if (strcmp(argv[i], "--raw") == 0) raw = true;
+        else if (strcmp(argv[i], "--list") == 0) list = true;
+        else if (strcmp(argv[i], "--session") == 0 && i + 1 < argc) session = atol(argv[++i]);
+        else path = argv[i];
+    }
+    if (path == nullptr)
+    {
+        fprintf(stderr, "usage: %s [--list] [--session N] [--raw] <partition dump|SD file> | --selftest\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t corrupt;
+    std::vector<Block> blocks = ReadBlocks(path, corrupt);
+    if (corrupt > 0) fprintf(stderr, "%u corrupt blocks skipped\n", corrupt);
+    if (blocks.empty())
+    {
+        fprintf(stderr, "no blackbox blocks in %s\n", path);
+        return 1;
+    }
+    if (list) return List(blocks);
+    return Decode(blocks, session >= 0 ? (uint32_t)session : blocks.back().header.session, raw);
+}
@@ -0,0 +1,190 @@
+// Replays an IMU trace through every attitude estimator and compares accuracy
+// and cost on the host.
+//
+//   g++ -std=c++17 -O2 -I../include estimator_replay.cpp -o estimator_replay
+//   ./estimator_replay imu.csv        # trace recorded with LOG_IMU_SAMPLES
+//   ./estimator_replay                # synthetic trace with known truth
+//
+// CSV columns: t_us,ax,ay,az,gx,gy,gz[,pitch_ref,roll_ref]
+// (m/s^2, rad/s, reference angles in degrees as in SensorsData)
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "estimators/ComplementaryFilter.h"
+#include "estimators/MadgwickFilter.h"
+#include "estimators/MahonyFilter.h"
+
+struct ImuSample
+{
+    uint32_t timeUs;
+    float accel[3];
+    float gyro[3];
+    bool hasReference;
+    float pitchRef;
+    float rollRef;
+};
+
+static std::vector<ImuSample> LoadCsv(const char *path)
+{
+    std::vector<ImuSample> samples;
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        perror(path);
+        exit(1);
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        ImuSample sample{};
+        unsigned long timeUs;
+        int fields = sscanf(line, "%lu,%f,%f,%f,%f,%f,%f,%f,%f", &timeUs,
+            &sample.accel[0], &sample.accel[1], &sample.accel[2],
+            &sample.gyro[0], &sample.gyro[1], &sample.gyro[2],
+            &sample.pitchRef, &sample.rollRef);
+        if (fields < 7) continue;
+        sample.timeUs = (uint32_t)timeUs;
+        sample.hasReference = fields == 9;
+        samples.push_back(sample);
+    }
+    fclose(file);
+    return samples;
+}
+
+// 60 s at 1 kHz: slow swings up to 40 degrees, gyro bias, sensor noise and
+// bursts of linear acceleration
+static std::vector<ImuSample> Synthesize()
+{
+    std::vector<ImuSample> samples;
+    std::mt19937 rng(2137);
+    std::normal_distribution<float> gyroNoise(0.0f, 0.005f);
+    std::normal_distribution<float> accelNoise(0.0f, 0.08f);
+    const float bias[3] = {0.02f, -0.015f, 0.01f};
+    const float dt = 0.001f;
+
+    for (int i = 0; i < 60000; i++)
+    {
+        float t = i * dt;
+        float phi = 0.7f * sinf(0.5f * t) * sinf(0.13f * t);
+        float theta = 0.5f * sinf(0.31f * t + 1.0f);
+        float phiDot = 0.7f * (0.5f * cosf(0.5f * t) * sinf(0.13f * t) + 0.13f * sinf(0.5f * t) * cosf(0.13f * t));
+        float thetaDot = 0.5f * 0.31f * cosf(0.31f * t + 1.0f);
+
+        ImuSample sample{};
+        sample.timeUs = (uint32_t)(i * 1000);
+        sample.gyro[0] = phiDot + bias[0] + gyroNoise(rng);
+        sample.gyro[1] = thetaDot * cosf(phi) + bias[1] + gyroNoise(rng);
+        sample.gyro[2] = -thetaDot * sinf(phi) + bias[2] + gyroNoise(rng);
+
+        float shake = (fmodf(t, 10.0f) < 1.0f) ? 2.0f * sinf(20.0f * t) : 0.0f;
+        sample.accel[0] = -sinf(theta) * GRAVITY + shake + accelNoise(rng);
+        sample.accel[1] = cosf(theta) * sinf(phi) * GRAVITY + accelNoise(rng);
+        sample.accel[2] = cosf(theta) * cosf(phi) * GRAVITY + accelNoise(rng);
+
+        sample.hasReference = true;
+        sample.pitchRef = phi * 57.2957795f;
+        sample.rollRef = theta * 57.2957795f;
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+struct Result
+{
+    double rmsPitch{0}, rmsRoll{0}, maxError{0}, nanosPerUpdate{0};
+    std::vector<float> pitch, roll;
+};
+
+static Result Run(IAttitudeEstimator &estimator, const std::vector<ImuSample> &samples)
+{
+    Result result;
+    result.pitch.reserve(samples.size());
+    result.roll.reserve(samples.size());
+    estimator.Reset(samples[0].accel[0], samples[0].accel[1], samples[0].accel[2]);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 1; i < samples.size(); i++)
+    {
+        const ImuSample &s = samples[i];
+        float dt = (s.timeUs - samples[i - 1].timeUs) * 1e-6f;
+        estimator.Update(s.gyro[0], s.gyro[1], s.gyro[2], s.accel[0], s.accel[1], s.accel[2], dt);
+        result.pitch.push_back(estimator.GetPitch());
+        result.roll.push_back(estimator.GetRoll());
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.nanosPerUpdate = std::chrono::duration<double, std::nano>(end - start).count() / (samples.size() - 1);
+
+    size_t counted = 0;
+    for (size_t i = 1; i < samples.size(); i++)
+    {
+        if (!samples[i].hasReference) continue;
+        double pitchError = result.pitch[i - 1] - samples[i].pitchRef;
+        double rollError = result.roll[i - 1] - samples[i].rollRef;
+        result.rmsPitch += pitchError * pitchError;
+        result.rmsRoll += rollError * rollError;
+        result.maxError = std::fmax(result.maxError, std::fmax(std::fabs(pitchError), std::fabs(rollError)));
+        counted++;
+    }
+    if (counted > 0)
+    {
+        result.rmsPitch = sqrt(result.rmsPitch / counted);
+        result.rmsRoll = sqrt(result.rmsRoll / counted);
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<ImuSample> samples = argc > 1 ? LoadCsv(argv[1]) : Synthesize();
+    if (samples.size() < 2)
+    {
+        fprintf(stderr, "Trace is empty\n");
+        return 1;
+    }
+    bool hasReference = samples[1].hasReference;
+    printf("%zu samples, %.1f s, %s\n", samples.size(), (samples.back().timeUs - samples.front().timeUs) * 1e-6,
+        hasReference ? "with reference" : "no reference, comparing against the complementary filter");
+
+    ComplementaryFilter complementary;
+    MadgwickFilter madgwick;
+    MahonyFilter mahony;
+    struct { const char *name; IAttitudeEstimator *estimator; } estimators[] = {
+        {"complementary", &complementary},
+        {"madgwick", &madgwick},
+        {"mahony", &mahony},
+    };
+
+    Result baseline;
+    printf("%-14s %12s %12s %12s %10s\n", "estimator", "rms pitch", "rms roll", "max err", "ns/update");
+    for (auto &entry : estimators)
+    {
+        Result result = Run(*entry.estimator, samples);
+        if (!hasReference)
+        {
+            if (entry.estimator == &complementary)
+            {
+                baseline = result;
+            }
+            else
+            {
+                // Disagreement with the filter it replaces
+                for (size_t i = 0; i < result.pitch.size(); i++)
+                {
+                    double pitchError = result.pitch[i] - baseline.pitch[i];
+                    double rollError = result.roll[i] - baseline.roll[i];
+                    result.rmsPitch += pitchError * pitchError;
+                    result.rmsRoll += rollError * rollError;
+                    result.maxError = std::fmax(result.maxError, std::fmax(std::fabs(pitchError), std::fabs(rollError)));
+                }
+                result.rmsPitch = sqrt(result.rmsPitch / result.pitch.size());
+                result.rmsRoll = sqrt(result.rmsRoll / result.roll.size());
+            }
+        }
+        printf("%-14s %10.3f d %10.3f d %10.3f d %10.1f\n", entry.name, result.rmsPitch, result.rmsRoll, result.maxError, result.nanosPerUpdate);
+    }
+    return 0;
+}
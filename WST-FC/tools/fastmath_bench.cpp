@@ -0,0 +1,75 @@
+// Accuracy and speed of FastMath.h against libm on the host.
+// The same kernels are timed on the target with USE_BENCHMARK.
+//
+//   g++ -std=c++17 -O2 -I../include fastmath_bench.cpp -o fastmath_bench && ./fastmath_bench
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "FastMath.h"
+
+static volatile float floatSink;
+static volatile int32_t intSink;
+
+template <typename TFunction>
+static double NanosPerCall(size_t count, TFunction fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / count;
+}
+
+int main()
+{
+    const int steps = 200000;
+    std::vector<float> angles(steps), ys(steps), xs(steps);
+    std::vector<int32_t> centidegs(steps), iys(steps), ixs(steps);
+    for (int i = 0; i < steps; i++)
+    {
+        double t = (double)i / steps;
+        angles[i] = (float)(-4.0 * M_PI + 8.0 * M_PI * t);
+        ys[i] = (float)(20.0 * sin(t * 977.0));
+        xs[i] = (float)(20.0 * cos(t * 613.0));
+        centidegs[i] = -72000 + (int32_t)(144000 * t);
+        iys[i] = (int32_t)(32767 * sin(t * 977.0));
+        ixs[i] = (int32_t)(32767 * cos(t * 613.0));
+    }
+
+    double atanErr = 0, sinErr = 0, cosErr = 0, fixedAtanErr = 0, fixedSinErr = 0, fixedCosErr = 0;
+    for (int i = 0; i < steps; i++)
+    {
+        atanErr = std::fmax(atanErr, std::fabs(FastAtan2(ys[i], xs[i]) - atan2((double)ys[i], (double)xs[i])));
+        sinErr = std::fmax(sinErr, std::fabs(FastSin(angles[i]) - sin((double)angles[i])));
+        cosErr = std::fmax(cosErr, std::fabs(FastCos(angles[i]) - cos((double)angles[i])));
+
+        if (iys[i] != 0 || ixs[i] != 0)
+        {
+            double reference = atan2((double)iys[i], (double)ixs[i]) * 18000.0 / M_PI;
+            double error = std::fabs(FixedAtan2(iys[i], ixs[i]) - reference);
+            fixedAtanErr = std::fmax(fixedAtanErr, std::fmin(error, 36000.0 - error));
+        }
+        double rad = centidegs[i] * M_PI / 18000.0;
+        fixedSinErr = std::fmax(fixedSinErr, std::fabs(FixedSin(centidegs[i]) - sin(rad) * Q15_ONE));
+        fixedCosErr = std::fmax(fixedCosErr, std::fabs(FixedCos(centidegs[i]) - cos(rad) * Q15_ONE));
+    }
+
+    printf("%-12s %14s %10s %10s\n", "kernel", "max error", "fast ns", "libm ns");
+    printf("%-12s %10.2e rad %10.2f %10.2f\n", "FastAtan2", atanErr,
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) floatSink = FastAtan2(ys[i], xs[i]); }),
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) floatSink = atan2f(ys[i], xs[i]); }));
+    printf("%-12s %14.2e %10.2f %10.2f\n", "FastSin", sinErr,
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) floatSink = FastSin(angles[i]); }),
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) floatSink = sinf(angles[i]); }));
+    printf("%-12s %14.2e %10.2f %10.2f\n", "FastCos", cosErr,
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) floatSink = FastCos(angles[i]); }),
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) floatSink = cosf(angles[i]); }));
+    printf("%-12s %8.2f cdeg %10.2f %10s\n", "FixedAtan2", fixedAtanErr,
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) intSink = FixedAtan2(iys[i], ixs[i]); }), "-");
+    printf("%-12s %8.2f LSB  %10.2f %10s\n", "FixedSin", fixedSinErr,
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) intSink = FixedSin(centidegs[i]); }), "-");
+    printf("%-12s %8.2f LSB  %10.2f %10s\n", "FixedCos", fixedCosErr,
+        NanosPerCall(steps, [&]() { for (int i = 0; i < steps; i++) intSink = FixedCos(centidegs[i]); }), "-");
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Host round trip of LinkProtocol.h: frames through LinkEncode/LinkDecode,
+// fragmented messages through LinkEncodeFragment/LinkReassembler with
+// repeated, missing and reordered fragments.
+//
+//   g++ -std=c++17 -O2 -I../include link_selftest.cpp -o link_selftest
+//   ./link_selftest
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "LinkProtocol.h"
+
+#define MESSAGE_CAPACITY 1024
+
+typedef std::vector<uint8_t> Frame;
+
+static int failures = 0;
+
+static void Check(bool condition, const char *what)
+{
+    if (condition) return;
+    printf("FAIL: %s\n", what);
+    failures++;
+}
+
+static std::vector<uint8_t> MakeMessage(uint16_t message, uint16_t length)
+{
+    std::vector<uint8_t> data(length);
+    for (uint16_t i = 0; i < length; i++)
+        data[i] = (uint8_t)(message * 17 + i);
+    return data;
+}
+
+static std::vector<Frame> Fragment(uint16_t message, const std::vector<uint8_t> &data, uint16_t chunk, uint16_t &sequence)
+{
+    std::vector<Frame> frames;
+    uint8_t out[LINK_FRAGMENT_FRAME_SIZE(MESSAGE_CAPACITY)];
+    for (uint16_t index = 0;; index++)
+    {
+        size_t size = LinkEncodeFragment(out, sizeof(out), LINK_MSG_TELEMETRY, message, index, chunk, sequence++, 0, data.data(), data.size());
+        if (size == 0) break;
+        frames.emplace_back(out, out + size);
+    }
+    return frames;
+}
+
+// Pushes the frames in the given order, returns the length of the first
+// completed message and counts completions
+static size_t Push(LinkReassembler<MESSAGE_CAPACITY> &reassembler, const std::vector<Frame> &frames, int &completions)
+{
+    size_t completed = 0;
+    completions = 0;
+    for (const Frame &data : frames)
+    {
+        LinkFrame frame;
+        if (LinkDecode(data.data(), data.size(), frame) != LINK_DECODE_OK) continue;
+        size_t length = reassembler.Push(frame);
+        if (length == 0) continue;
+        if (completions++ == 0) completed = length;
+    }
+    return completed;
+}
+
+static bool Matches(const LinkReassembler<MESSAGE_CAPACITY> &reassembler, const std::vector<uint8_t> &data)
+{
+    return memcmp(reassembler.GetMessage(), data.data(), data.size()) == 0;
+}
+
+static void TestFrames()
+{
+    uint8_t payload[20];
+    for (size_t i = 0; i < sizeof(payload); i++)
+        payload[i] = i * 3;
+    uint8_t out[LINK_OVERHEAD + sizeof(payload)];
+    size_t size = LinkEncode(out, sizeof(out), LINK_MSG_CONTROL, 7, 1234, payload, sizeof(payload));
+    LinkFrame frame;
+    Check(size == sizeof(out) && LinkDecode(out, size, frame) == LINK_DECODE_OK, "frame round trip");
+    Check(frame.header.sequence == 7 && frame.header.timestampUs == 1234 && memcmp(frame.payload, payload, sizeof(payload)) == 0, "frame content");
+    out[sizeof(LinkHeader) + 4] ^= 0x10;
+    Check(LinkDecode(out, size, frame) == LINK_DECODE_CRC, "flipped bit fails the CRC");
+    Check(LinkDecode(out, size - 1, frame) == LINK_DECODE_LENGTH, "truncated frame");
+}
+
+static void TestReassembler()
+{
+    uint16_t sequence = 0;
+    int completions;
+
+    // In order
+    {
+        LinkReassembler<MESSAGE_CAPACITY> reassembler;
+        std::vector<uint8_t> data = MakeMessage(1, 250);
+        size_t length = Push(reassembler, Fragment(1, data, 100, sequence), completions);
+        Check(length == data.size() && completions == 1 && Matches(reassembler, data), "in order");
+    }
+
+    // Repeated first fragment of a two fragment message must not complete it
+    {
+        LinkReassembler<MESSAGE_CAPACITY> reassembler;
+        std::vector<uint8_t> data = MakeMessage(2, 200);
+        std::vector<Frame> frames = Fragment(2, data, 100, sequence);
+        std::vector<Frame> repeated = {frames[0], frames[0]};
+        Check(Push(reassembler, repeated, completions) == 0, "repeated fragment does not complete");
+        Check(Push(reassembler, {frames[1]}, completions) == data.size() && Matches(reassembler, data), "completes after the missing one");
+        Check(Push(reassembler, {frames[1], frames[0]}, completions) == 0, "fragments of a completed message are ignored");
+    }
+
+    // Missing fragment, abandoned by the next message
+    {
+        LinkReassembler<MESSAGE_CAPACITY> reassembler;
+        std::vector<uint8_t> data = MakeMessage(3, 350);
+        std::vector<Frame> frames = Fragment(3, data, 100, sequence);
+        frames.erase(frames.begin() + 1);
+        Check(Push(reassembler, frames, completions) == 0, "missing fragment does not complete");
+        std::vector<uint8_t> next = MakeMessage(4, 150);
+        Check(Push(reassembler, Fragment(4, next, 100, sequence), completions) == next.size() && Matches(reassembler, next), "next message completes");
+        Check(reassembler.GetIncomplete() == 1, "abandoned message counted");
+    }
+
+    // Last fragment first, then the rest reversed
+    {
+        LinkReassembler<MESSAGE_CAPACITY> reassembler;
+        std::vector<uint8_t> data = MakeMessage(5, 420);
+        std::vector<Frame> frames = Fragment(5, data, 100, sequence);
+        std::reverse(frames.begin(), frames.end());
+        Check(Push(reassembler, frames, completions) == data.size() && completions == 1 && Matches(reassembler, data), "reversed order");
+    }
+
+    // Random shuffles with repeats and drops against the expected outcome
+    std::mt19937 random(3);
+    int mismatches = 0;
+    for (uint16_t message = 100; message < 2100; message++)
+    {
+        LinkReassembler<MESSAGE_CAPACITY> reassembler;
+        uint16_t chunk = 20 + random() % 200;
+        std::vector<uint8_t> data = MakeMessage(message, 1 + random() % MESSAGE_CAPACITY);
+        std::vector<Frame> frames = Fragment(message, data, chunk, sequence);
+        bool complete = true;
+        std::vector<Frame> sent;
+        for (const Frame &frame : frames)
+        {
+            uint32_t roll = random() % 10;
+            if (roll == 0) complete = false;
+            else sent.push_back(frame);
+            if (roll == 1) sent.push_back(frame);
+        }
+        std::shuffle(sent.begin(), sent.end(), random);
+        size_t length = Push(reassembler, sent, completions);
+        bool ok = complete ? length == data.size() && completions == 1 && Matches(reassembler, data) : completions == 0;
+        if (!ok) mismatches++;
+    }
+    printf("random: 2000 messages, %d mismatches\n", mismatches);
+    Check(mismatches == 0, "random repeats, drops and reorders");
+}
+
+int main()
+{
+    TestFrames();
+    TestReassembler();
+    printf(failures == 0 ? "ok\n" : "%d checks failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+// Decodes the telemetry stream (TelemetryCodec.h) on the host and prints
+// one CSV row per sample.
+//
+//   g++ -std=c++17 -O2 -I../include telemetry_dump.cpp -o telemetry_dump
+//   stty -F /dev/ttyUSB0 921600 raw && ./telemetry_dump /dev/ttyUSB0   # serial link, COBS framed
+//   ./telemetry_dump --udp 192.168.0.39 4210                          # WiFi UDP link
+//   ./telemetry_dump --selftest                                       # encoder -> lossy link -> decoder
+//
+// The UDP mode sends neutral control frames (all zero) at 10 Hz, the vehicle
+// only streams to a ground station it hears from. Do not use it while
+// another ground station is flying the vehicle.
+//
+// Columns: t_us,seq,<SensorsData fields>. Full SensorsData frames
+// (LINK_MSG_TELEMETRY, TELEMETRY_STREAM 0) are printed the same way.
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "Cobs.h"
+#include "LinkProtocol.h"
+#include "TelemetryCodec.h"
+
+// SensorsData.h in declaration order, keep in sync
+static const char *FIELD_NAMES[] = {
+    "pitch", "roll", "gyroX", "gyroY", "gyroZ",
+    "linearAccelX", "linearAccelY", "linearAccelZ",
+    "voltage", "current", "consumedMah",
+    "distance0", "distance1", "distance2", "distance3", "distance4", "distance5",
+    "other0", "other1", "other2", "other3", "other4",
+    "motorRpm0", "motorRpm1", "motorRpm2", "motorRpm3"};
+static const size_t FIELD_COUNT = sizeof(FIELD_NAMES) / sizeof(FIELD_NAMES[0]);
+// Unsigned in SensorsData, the rest are int16_t
+static bool IsUnsigned(size_t field)
+{
+    return field == 10 || (field >= 11 && field <= 16) || field >= 22;
+}
+
+struct Dump
+{
+    TelemetryDecoder decoder;
+    LinkSequencer sequencer;
+    uint32_t rows{0};
+
+    void PrintHeader()
+    {
+        printf("t_us,seq");
+        for (size_t i = 0; i < FIELD_COUNT; i++)
+            printf(",%s", FIELD_NAMES[i]);
+        printf("\n");
+    }
+
+    void PrintRow(const LinkHeader &header, const uint16_t *values, size_t count)
+    {
+        printf("%u,%u", header.timestampUs, header.sequence);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (i < FIELD_COUNT && IsUnsigned(i)) printf(",%u", values[i]);
+            else printf(",%d", (int16_t)values[i]);
+        }
+        printf("\n");
+        rows++;
+    }
+
+    void HandleFrame(const uint8_t *data, size_t length)
+    {
+        LinkFrame frame;
+        if (LinkDecode(data, length, frame) != LINK_DECODE_OK)
+        {
+            sequencer.CountCorrupt();
+            return;
+        }
+        if (frame.header.type == LINK_MSG_TELEMETRY_DELTA)
+        {
+            // Late or repeated frames would roll the sample back
+            if (!sequencer.Accept(frame.header.sequence)) return;
+            if (decoder.Decode(frame.payload, frame.header.length))
+                PrintRow(frame.header, decoder.GetValues(), decoder.GetFieldCount());
+        }
+        else if (frame.header.type == LINK_MSG_TELEMETRY && frame.header.length % 2 == 0)
+        {
+            if (!sequencer.Accept(frame.header.sequence)) return;
+            std::vector<uint16_t> values(frame.header.length / 2);
+            memcpy(values.data(), frame.payload, frame.header.length);
+            PrintRow(frame.header, values.data(), values.size());
+        }
+    }
+
+    void PrintStats()
+    {
+        const LinkStats &stats = sequencer.GetStats();
+        fprintf(stderr, "rows:%u keyframes:%u deltas:%u skipped:%u errors:%u | frames:%u lost:%u reordered:%u corrupt:%u\n",
+            rows, decoder.GetKeyframes(), decoder.GetDeltas(), decoder.GetSkipped(), decoder.GetErrors(),
+            stats.received, stats.lost, stats.reordered, stats.corrupt);
+    }
+};
+
+static int RunSerial(const char *path)
+{
+    FILE *input = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (input == nullptr)
+    {
+        perror(path);
+        return 1;
+    }
+    Dump dump;
+    dump.PrintHeader();
+    CobsDecoder<1024> cobs;
+    int byte;
+    while ((byte = fgetc(input)) != EOF)
+    {
+        size_t length = cobs.Push((uint8_t)byte);
+        if (length > 0) dump.HandleFrame(cobs.GetFrame(), length);
+    }
+    dump.PrintStats();
+    return 0;
+}
+
+static int RunUdp(const char *ip, int port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in vehicle = {};
+    vehicle.sin_family = AF_INET;
+    vehicle.sin_port = htons(port);
+    if (sock < 0 || inet_pton(AF_INET, ip, &vehicle.sin_addr) != 1)
+    {
+        fprintf(stderr, "bad address %s\n", ip);
+        return 1;
+    }
+    timeval timeout = {0, 100000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    Dump dump;
+    dump.PrintHeader();
+    uint16_t sequence = 0;
+    uint8_t buffer[1500];
+    for (;;)
+    {
+        // Neutral sticks, also what tells the vehicle where to send
+        int16_t control[4] = {0, 0, 0, 0};
+        size_t size = LinkEncode(buffer, sizeof(buffer), LINK_MSG_CONTROL, sequence++, 0, control, sizeof(control));
+        sendto(sock, buffer, size, 0, (sockaddr *)&vehicle, sizeof(vehicle));
+
+        ssize_t length;
+        while ((length = recv(sock, buffer, sizeof(buffer), 0)) > 0)
+        {
+            dump.HandleFrame(buffer, length);
+        }
+        fflush(stdout);
+    }
+}
+
+// Random walk sensors through encoder, a link that drops frames and the
+// decoder. Without loss every decoded sample must match the encoded one;
+// with loss, stale fields (returned to the keyframe value in a lost frame)
+// are counted.
+static int RunSelfTest()
+{
+    uint8_t dividers[FIELD_COUNT];
+    for (size_t i = 0; i < FIELD_COUNT; i++)
+        dividers[i] = (i >= 8 && i <= 10) || (i >= 17 && i <= 21) ? 20 : (i >= 11 && i <= 16 ? 4 : 1);
+
+    std::mt19937 random(7);
+    const int frames = 20000;
+    const float lossRates[] = {0.0f, 0.01f, 0.05f, 0.2f};
+    for (float loss : lossRates)
+    {
+        TelemetryEncoder encoder(dividers, FIELD_COUNT, 50);
+        TelemetryDecoder decoder;
+        uint16_t values[FIELD_COUNT] = {};
+        // What the decoder should hold: every field as of the last frame it
+        // was due in that got through, whatever was lost before
+        uint16_t expected[FIELD_COUNT] = {};
+        uint8_t payload[TELEMETRY_PAYLOAD_SIZE(FIELD_COUNT)];
+        size_t bytes = 0;
+        int decoded = 0;
+        int mismatches = 0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            for (size_t i = 0; i < FIELD_COUNT; i++)
+            {
+                // Fast fields wander, slow ones mostly sit still
+                if (dividers[i] == 1 || random() % 50 == 0)
+                    values[i] += (int)(random() % 41) - 20;
+            }
+            size_t length = encoder.Encode(values, payload, sizeof(payload));
+            bytes += length;
+
+            if (std::uniform_real_distribution<float>(0, 1)(random) < loss) continue;
+            if (!decoder.Decode(payload, length)) continue;
+            decoded++;
+            // A keyframe sends all, a delta only due fields
+            uint8_t counter = payload[1];
+            for (size_t i = 0; i < FIELD_COUNT; i++)
+            {
+                if (payload[0] == TELEMETRY_KEYFRAME || counter % dividers[i] == 0) expected[i] = values[i];
+            }
+            if (memcmp(decoder.GetValues(), expected, sizeof(expected)) != 0) mismatches++;
+        }
+        printf("loss %4.1f%%: %5.1f B/frame (raw %zu) decoded %5.1f%% keyframes %u skipped %u stale samples %d\n",
+            100.0f * loss, (float)bytes / frames, FIELD_COUNT * 2, 100.0f * decoded / frames,
+            decoder.GetKeyframes(), decoder.GetSkipped(), mismatches);
+        if (mismatches > 0) return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "--selftest") == 0) return RunSelfTest();
+    if (argc >= 3 && strcmp(argv[1], "--udp") == 0) return RunUdp(argv[2], argc >= 4 ? atoi(argv[3]) : 4210);
+    if (argc >= 2) return RunSerial(argv[1]);
+    fprintf(stderr, "usage: %s <serial device|file|-> | --udp <ip> [port] | --selftest\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Converts a WST-FC trace dump (see include/Trace.h) into Chrome trace JSON.
+
+The result opens in chrome://tracing or https://ui.perfetto.dev.
+Per-span min/avg/p99/max is printed to stdout.
+
+    python3 trace_to_chrome.py dump.txt -o trace.json
+    python3 trace_to_chrome.py --udp 192.168.0.39 -o trace.json
+"""
+import argparse
+import json
+import socket
+import sys
+
+TRACE_REQUEST_BYTE = b"T"
+UDP_CONTROLL_PORT = 4210
+
+
+def request_udp_dump(host, port, timeout):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(timeout)
+    sock.sendto(TRACE_REQUEST_BYTE, (host, port))
+    lines = []
+    while True:
+        try:
+            data, _ = sock.recvfrom(4096)
+        except socket.timeout:
+            break
+        lines.extend(data.decode("ascii", "replace").splitlines())
+    return lines
+
+
+def parse(lines):
+    cpu_mhz = 240
+    events = []
+    for line in lines:
+        line = line.strip()
+        if line.startswith("#TRACE"):
+            for field in line.split()[1:]:
+                key, _, value = field.partition("=")
+                if key == "cpu_mhz":
+                    cpu_mhz = int(value)
+            continue
+        parts = line.split(",")
+        if len(parts) != 4:
+            continue
+        try:
+            events.append((parts[0], int(parts[1]), int(parts[2]), int(parts[3])))
+        except ValueError:
+            continue
+    return cpu_mhz, events
+
+
+def to_chrome(cpu_mhz, events):
+    # Cycle counters are 32 bit and per core, unwrap each core separately
+    last_start = {}
+    wraps = {}
+    trace = []
+    for name, core, start, duration in events:
+        if core in last_start and start < last_start[core] and last_start[core] - start > 0x80000000:
+            wraps[core] = wraps.get(core, 0) + 1
+        last_start[core] = start
+        cycles = start + (wraps.get(core, 0) << 32)
+        trace.append({
+            "name": name,
+            "ph": "X",
+            "pid": 0,
+            "tid": core,
+            "ts": cycles / cpu_mhz,
+            "dur": duration / cpu_mhz,
+        })
+    for core in sorted(last_start):
+        trace.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": core, "args": {"name": "core %d" % core}})
+    return {"traceEvents": trace, "displayTimeUnit": "ns"}
+
+
+def print_stats(cpu_mhz, events):
+    spans = {}
+    for name, _, _, duration in events:
+        spans.setdefault(name, []).append(duration / cpu_mhz)
+    print("%-45s %8s %10s %10s %10s %10s" % ("span", "count", "min_us", "avg_us", "p99_us", "max_us"))
+    for name in sorted(spans):
+        values = sorted(spans[name])
+        p99 = values[min(len(values) - 1, (len(values) * 99) // 100)]
+        print("%-45s %8d %10.2f %10.2f %10.2f %10.2f" % (
+            name, len(values), values[0], sum(values) / len(values), p99, values[-1]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", nargs="?", help="text dump captured from Serial (default: stdin)")
+    parser.add_argument("--udp", metavar="HOST", help="request the dump from a vehicle over UDP")
+    parser.add_argument("--port", type=int, default=UDP_CONTROLL_PORT)
+    parser.add_argument("--timeout", type=float, default=1.0)
+    parser.add_argument("-o", "--output", default="trace.json")
+    args = parser.parse_args()
+
+    if args.udp:
+        lines = request_udp_dump(args.udp, args.port, args.timeout)
+    elif args.dump:
+        with open(args.dump, "r", errors="replace") as f:
+            lines = f.readlines()
+    else:
+        lines = sys.stdin.readlines()
+
+    cpu_mhz, events = parse(lines)
+    if not events:
+        sys.exit("No trace events found")
+
+    with open(args.output, "w") as f:
+        json.dump(to_chrome(cpu_mhz, events), f)
+    print_stats(cpu_mhz, events)
+    print("Wrote %d events to %s" % (len(events), args.output))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,321 @@
+// Reference receiver of the UDP camera stream (VideoProtocol.h). Prints
+// frame rate, frame loss and capture-to-receive latency once a second.
+//
+//   g++ -std=c++17 -O2 -pthread -I../include video_receiver.cpp -o video_receiver
+//   ./video_receiver 192.168.0.39                 # the vehicle, until Ctrl+C
+//   ./video_receiver 192.168.0.39 --save last.jpg # and keep the newest frame
+//   ./video_receiver --loopback 5 10              # stand-in vehicle on 127.0.0.1,
+//                                                 # 5% datagram loss, 10 s
+//
+// Latency is from the end of the capture to the last fragment received, on
+// the receiver's clock: VideoSync round trips give the vehicle clock offset
+// (the sample with the shortest of the last 8 round trips is used), so it
+// is as good as half the round trip asymmetry. Sensor exposure and the
+// viewer's decode and display come on top for glass to glass.
+//
+// The loopback stand-in sends patterned frames of 8 to 60 kB at 20 fps on a
+// clock 7 s off the receiver's and drops datagrams at random. The receiver
+// checks the content of every complete frame and compares the frame loss
+// with what the datagram loss predicts. It exits non-zero on a corrupt
+// frame or when nothing came through.
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "VideoProtocol.h"
+
+#define STANDIN_FPS 20
+#define STANDIN_CLOCK_OFFSET_US 7000000u
+#define SYNC_SAMPLES 8
+
+static uint32_t NowUs()
+{
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static uint8_t PatternByte(uint32_t frameId, uint32_t index)
+{
+    return (uint8_t)(frameId * 31 + index * 7 + (index >> 8));
+}
+
+// Stands in for the vehicle: answers subscribes and streams to the last
+// subscriber like CameraModule does
+static void RunStandIn(int socket, float loss, const std::atomic<bool> &stop, std::atomic<uint32_t> &framesSent, double &expectedComplete)
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::vector<uint8_t> frame(VIDEO_MAX_FRAME_SIZE);
+    uint8_t datagram[VIDEO_DATAGRAM_SIZE];
+    sockaddr_in viewer = {};
+    bool subscribed = false;
+    uint32_t lastSubscribeUs = 0;
+    uint32_t frameId = 0;
+    uint32_t nextFrameUs = NowUs();
+
+    while (!stop)
+    {
+        int32_t wait = (int32_t)(nextFrameUs - NowUs());
+        pollfd poller = {socket, POLLIN, 0};
+        if (wait > 0 && poll(&poller, 1, wait / 1000 + 1) > 0)
+        {
+            VideoSubscribe subscribe;
+            sockaddr_in peer;
+            socklen_t peerLength = sizeof(peer);
+            ssize_t received = recvfrom(socket, &subscribe, sizeof(subscribe), 0, (sockaddr *)&peer, &peerLength);
+            if (received == sizeof(subscribe) && VideoMessageTypeOf((const uint8_t *)&subscribe, received) == VIDEO_MSG_SUBSCRIBE)
+            {
+                VideoSync sync;
+                VideoFillHeader(sync, VIDEO_MSG_SYNC);
+                sync.viewerUs = subscribe.viewerUs;
+                sync.vehicleUs = NowUs() + STANDIN_CLOCK_OFFSET_US;
+                sendto(socket, &sync, sizeof(sync), 0, (sockaddr *)&peer, sizeof(peer));
+                viewer = peer;
+                subscribed = true;
+                lastSubscribeUs = NowUs();
+            }
+            continue;
+        }
+        if ((int32_t)(nextFrameUs - NowUs()) > 0) continue;
+        nextFrameUs += 1000000 / STANDIN_FPS;
+        frameId++;
+        if (!subscribed || NowUs() - lastSubscribeUs > VIDEO_SUBSCRIBE_TIMEOUT_MS * 1000u) continue;
+
+        uint32_t size = 8 * 1024 + random() % (52 * 1024);
+        for (uint32_t i = 0; i < size; i++)
+            frame[i] = PatternByte(frameId, i);
+        uint32_t captureUs = NowUs() + STANDIN_CLOCK_OFFSET_US;
+        // A frame survives only if all of its fragments do
+        expectedComplete += pow(1.0 - loss, (size + VIDEO_CHUNK - 1) / VIDEO_CHUNK);
+        for (uint32_t index = 0;; index++)
+        {
+            size_t length = VideoEncodeFragment(datagram, frameId, captureUs, frame.data(), size, index);
+            if (length == 0) break;
+            if (uniform(random) < loss) continue;
+            sendto(socket, datagram, length, 0, (sockaddr *)&viewer, sizeof(viewer));
+        }
+        framesSent++;
+    }
+}
+
+struct SyncSample
+{
+    uint32_t rttUs;
+    int32_t offsetUs;
+};
+
+int main(int argc, char **argv)
+{
+    const char *host = nullptr;
+    const char *savePath = nullptr;
+    bool loopback = false;
+    float loss = 0.0f;
+    int seconds = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--loopback") == 0)
+        {
+            loopback = true;
+            host = "127.0.0.1";
+            if (i + 1 < argc) loss = atof(argv[++i]) / 100.0f;
+            if (i + 1 < argc) seconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) savePath = argv[++i];
+        else host = argv[i];
+    }
+    if (host == nullptr)
+    {
+        fprintf(stderr, "usage: %s <vehicle ip> [--save frame.jpg] | --loopback [loss %%] [seconds]\n", argv[0]);
+        return 1;
+    }
+    if (loopback && seconds <= 0) seconds = 10;
+
+    int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    int buffer = 4 * 1024 * 1024;
+    setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    sockaddr_in vehicle = {};
+    vehicle.sin_family = AF_INET;
+    vehicle.sin_port = htons(VIDEO_PORT);
+    if (inet_pton(AF_INET, host, &vehicle.sin_addr) != 1)
+    {
+        fprintf(stderr, "bad address %s\n", host);
+        return 1;
+    }
+
+    // The stand-in takes any free port, VIDEO_PORT may be in use
+    std::atomic<bool> stop{false};
+    std::atomic<uint32_t> framesSent{0};
+    // Written by the stand-in, read after it stopped
+    double expectedComplete = 0.0;
+    std::thread standIn;
+    if (loopback)
+    {
+        int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address = vehicle;
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if (bind(sender, (sockaddr *)&address, sizeof(address)) < 0 || getsockname(sender, (sockaddr *)&address, &length) < 0)
+        {
+            perror("stand-in");
+            return 1;
+        }
+        vehicle.sin_port = address.sin_port;
+        standIn = std::thread(RunStandIn, sender, loss, std::cref(stop), std::ref(framesSent), std::ref(expectedComplete));
+    }
+
+    static VideoReassembler<VIDEO_MAX_FRAME_SIZE> reassembler;
+    std::vector<uint8_t> datagram(VIDEO_DATAGRAM_SIZE + 1);
+    SyncSample samples[SYNC_SAMPLES] = {};
+    uint32_t sampleCount = 0;
+    bool synced = false;
+    int32_t offsetUs = 0;
+    uint32_t rttUs = 0;
+
+    uint32_t corrupt = 0;
+    uint32_t lastSubscribeUs = NowUs() - VIDEO_SUBSCRIBE_INTERVAL_MS * 1000u;
+    uint32_t startUs = NowUs();
+    uint32_t intervalStartUs = startUs;
+    uint32_t intervalFrames = 0;
+    uint64_t intervalBytes = 0;
+    double latencySum = 0.0;
+    double latencyTotalSum = 0.0;
+    uint32_t latencyCount = 0;
+    uint32_t latencyTotalCount = 0;
+    int32_t latencyMin = INT32_MAX;
+    int32_t latencyMax = INT32_MIN;
+    VideoReceiverStats lastStats;
+
+    printf("t_s,fps,kB_s,complete,incomplete,skipped,latency_avg_ms,latency_min_ms,latency_max_ms,rtt_ms\n");
+    while (!loopback || NowUs() - startUs < (uint32_t)seconds * 1000000u)
+    {
+        uint32_t now = NowUs();
+        if (now - lastSubscribeUs >= VIDEO_SUBSCRIBE_INTERVAL_MS * 1000u)
+        {
+            const VideoReceiverStats &stats = reassembler.GetStats();
+            VideoSubscribe subscribe;
+            VideoFillHeader(subscribe, VIDEO_MSG_SUBSCRIBE);
+            subscribe.viewerUs = now;
+            subscribe.framesComplete = stats.complete;
+            subscribe.framesIncomplete = stats.incomplete;
+            sendto(receiver, &subscribe, sizeof(subscribe), 0, (sockaddr *)&vehicle, sizeof(vehicle));
+            lastSubscribeUs = now;
+        }
+
+        if (now - intervalStartUs >= 1000000u)
+        {
+            float elapsed = (now - intervalStartUs) * 1e-6f;
+            const VideoReceiverStats &stats = reassembler.GetStats();
+            printf("%.0f,%.1f,%.0f,%u,%u,%u,", (now - startUs) * 1e-6, intervalFrames / elapsed, intervalBytes / 1024.0 / elapsed,
+                stats.complete - lastStats.complete, stats.incomplete - lastStats.incomplete, stats.skipped - lastStats.skipped);
+            if (synced && latencyCount > 0)
+                printf("%.2f,%.2f,%.2f,%.2f\n", latencySum / latencyCount / 1000.0, latencyMin / 1000.0, latencyMax / 1000.0, rttUs / 1000.0);
+            else printf(",,,\n");
+            fflush(stdout);
+            lastStats = stats;
+            intervalStartUs = now;
+            intervalFrames = 0;
+            intervalBytes = 0;
+            latencySum = 0.0;
+            latencyCount = 0;
+            latencyMin = INT32_MAX;
+            latencyMax = INT32_MIN;
+        }
+
+        pollfd poller = {receiver, POLLIN, 0};
+        if (poll(&poller, 1, 50) <= 0) continue;
+        ssize_t size = recv(receiver, datagram.data(), datagram.size(), 0);
+        if (size <= 0) continue;
+        uint32_t receivedUs = NowUs();
+        uint8_t type = VideoMessageTypeOf(datagram.data(), size);
+
+        if (type == VIDEO_MSG_SYNC && size == sizeof(VideoSync))
+        {
+            VideoSync sync;
+            memcpy(&sync, datagram.data(), sizeof(sync));
+            SyncSample &sample = samples[sampleCount++ % SYNC_SAMPLES];
+            sample.rttUs = receivedUs - sync.viewerUs;
+            sample.offsetUs = (int32_t)(sync.vehicleUs - (sync.viewerUs + sample.rttUs / 2));
+            // The shortest round trip had the least queueing on either side
+            const SyncSample *best = &samples[0];
+            for (uint32_t i = 1; i < SYNC_SAMPLES && i < sampleCount; i++)
+                if (samples[i].rttUs < best->rttUs) best = &samples[i];
+            offsetUs = best->offsetUs;
+            rttUs = best->rttUs;
+            synced = true;
+            continue;
+        }
+
+        size_t frameSize = reassembler.Push(datagram.data(), size);
+        if (frameSize == 0) continue;
+        intervalFrames++;
+        intervalBytes += frameSize;
+        if (synced)
+        {
+            int32_t latency = (int32_t)(receivedUs - (reassembler.GetCaptureUs() - offsetUs));
+            latencySum += latency;
+            latencyTotalSum += latency;
+            latencyCount++;
+            latencyTotalCount++;
+            if (latency < latencyMin) latencyMin = latency;
+            if (latency > latencyMax) latencyMax = latency;
+        }
+        if (loopback)
+        {
+            const uint8_t *frame = reassembler.GetFrame();
+            for (size_t i = 0; i < frameSize; i++)
+            {
+                if (frame[i] != PatternByte(reassembler.GetFrameId(), i))
+                {
+                    corrupt++;
+                    break;
+                }
+            }
+        }
+        if (savePath != nullptr)
+        {
+            FILE *output = fopen(savePath, "wb");
+            if (output != nullptr)
+            {
+                fwrite(reassembler.GetFrame(), 1, frameSize, output);
+                fclose(output);
+            }
+        }
+    }
+
+    if (loopback)
+    {
+        // Frames still in flight count as sent, take them in
+        stop = true;
+        standIn.join();
+        pollfd poller = {receiver, POLLIN, 0};
+        while (poll(&poller, 1, 100) > 0)
+        {
+            ssize_t size = recv(receiver, datagram.data(), datagram.size(), 0);
+            if (size > 0 && VideoMessageTypeOf(datagram.data(), size) == VIDEO_MSG_FRAGMENT) reassembler.Push(datagram.data(), size);
+        }
+    }
+
+    const VideoReceiverStats &stats = reassembler.GetStats();
+    uint32_t received = stats.complete + stats.incomplete;
+    fprintf(stderr, "frames complete:%u incomplete:%u skipped:%u late:%u malformed:%u latency avg:%.2fms\n",
+        stats.complete, stats.incomplete, stats.skipped, stats.late, stats.malformed,
+        latencyTotalCount > 0 ? latencyTotalSum / latencyTotalCount / 1000.0 : 0.0);
+    if (!loopback) return 0;
+
+    uint32_t sent = framesSent;
+    double measured = sent > 0 ? 1.0 - (double)stats.complete / sent : 0.0;
+    double expected = sent > 0 ? 1.0 - expectedComplete / sent : 0.0;
+    fprintf(stderr, "loopback: sent:%u received:%u frame loss:%.1f%% (expected %.1f%%) corrupt:%u\n",
+        sent, received, measured * 100.0, expected * 100.0, corrupt);
+    return corrupt == 0 && stats.complete > 0 ? 0 : 1;
+}
@@ -47,7 +47,7 @@ namespace WST.Drone.Modules
             sensor.AddObservation(_drone.sensorsData.linearAccelY);
             sensor.AddObservation(_drone.sensorsData.linearAccelZ);
 
-            sensor.AddObservation(_drone.sensorsData.voltage);
+            sensor.AddObservation(_drone.sensorsData.voltage / 100f);
 
             sensor.AddObservation(_drone.sensorsData.distanceSensors[0]);
             sensor.AddObservation(_drone.sensorsData.distanceSensors[1]);
@@ -1,11 +1,14 @@
 using System;
 using System.Collections;
+using System.Diagnostics;
 using System.Net;
 using System.Net.Sockets;
 using System.Runtime.InteropServices;
 using UnityEngine;
 using UnityEngine.Events;
+using WST.Communication;
 using WST.Drone;
+using Debug = UnityEngine.Debug;
 
 namespace WST.Drone.Modules
 {
@@ -18,6 +21,12 @@ namespace WST.Drone.Modules
         private DroneManager _drone;
         private UdpClient _udpClient;
         private IPEndPoint _remoteEndPoint;
+        private ushort _txSequence;
+        private readonly LinkSequencer _telemetrySequencer = new LinkSequencer();
+        private readonly TelemetryDecoder _telemetryDecoder = new TelemetryDecoder();
+        private readonly Stopwatch _clock = Stopwatch.StartNew();
+
+        public LinkSequencer TelemetryStats => _telemetrySequencer;
 
         [SerializeField] UnityEvent<string> onConnect;
         public void Init(DroneManager drone)
@@ -53,6 +62,8 @@ namespace WST.Drone.Modules
             Debug.Log($"Connecting to {ipAddress}:{port}...");
             Disconnect();
             _udpClient = new UdpClient();
+            _telemetrySequencer.Reset();
+            _telemetryDecoder.Reset();
             _remoteEndPoint = new IPEndPoint(IPAddress.Parse(ipAddress), port);
             onConnect.Invoke($"{ipAddress}");
             StartCoroutine(SendLoop());
@@ -87,7 +98,9 @@ namespace WST.Drone.Modules
                         Marshal.FreeHGlobal(ptr);
                     }
 
-                    _udpClient.Send(bytes, bytes.Length, _remoteEndPoint);
+                    uint timestampUs = (uint)(_clock.ElapsedTicks * 1000000L / Stopwatch.Frequency);
+                    byte[] frame = LinkProtocol.Encode(LinkMessageType.Control, _txSequence++, timestampUs, bytes);
+                    _udpClient.Send(frame, frame.Length, _remoteEndPoint);
                 }
                 yield return new WaitForSeconds(tickRate);
             }
@@ -104,9 +117,22 @@ namespace WST.Drone.Modules
                         IPEndPoint source = new IPEndPoint(IPAddress.Any, 0);
                         byte[] receivedBytes = _udpClient.Receive(ref source);
 
-                        if (_drone != null && receivedBytes.Length == Marshal.SizeOf(typeof(SensorsData)))
+                        if (_drone != null && LinkProtocol.TryDecode(receivedBytes, out LinkFrame frame))
                         {
-                            _drone.sensorsData = Deserialize<SensorsData>(receivedBytes);
+                            int sensorsSize = Marshal.SizeOf(typeof(SensorsData));
+                            if (frame.type == LinkMessageType.Telemetry
+                                && frame.payload.Length == sensorsSize
+                                && _telemetrySequencer.Accept(frame.sequence))
+                            {
+                                _drone.sensorsData = Deserialize<SensorsData>(frame.payload);
+                            }
+                            else if (frame.type == LinkMessageType.TelemetryDelta
+                                && _telemetrySequencer.Accept(frame.sequence)
+                                && _telemetryDecoder.Decode(frame.payload))
+                            {
+                                byte[] bytes = _telemetryDecoder.GetBytes();
+                                if (bytes.Length == sensorsSize) _drone.sensorsData = Deserialize<SensorsData>(bytes);
+                            }
                         }
                     }
                     catch (Exception e)
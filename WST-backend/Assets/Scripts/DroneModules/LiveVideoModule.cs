@@ -1,17 +1,35 @@
 using System;
 using System.IO;
+using System.Net;
 using System.Net.Http;
+using System.Net.Sockets;
 using System.Threading;
 using System.Threading.Tasks;
 using UnityEngine;
 using UnityEngine.UI;
+using WST.Communication;
 
 namespace WST.Drone.Modules
 {
+    public enum VideoTransport
+    {
+        // multipart JPEG over HTTP, TCP retransmits and falls behind on a lossy link
+        Mjpeg,
+        // Frames as datagrams (VideoProtocol.cs), a lost fragment costs one frame
+        Udp,
+    }
+
     public class LiveVideoModule : MonoBehaviour, IDroneModule
     {
         [SerializeField] private RawImage displayImage;
+        [SerializeField] private VideoTransport transport = VideoTransport.Udp;
         [SerializeField] private int videoPort = 80;
+        [SerializeField] private int udpVideoPort = VideoProtocol.Port;
+
+        // UDP only: capture to received on the vehicle clock mapped to ours, and
+        // the share of frames that arrived incomplete
+        public float LatencyMs { get; private set; }
+        public float FrameLoss { get; private set; }
 
         private Texture2D _videoTexture;
         private CancellationTokenSource _cancellationTokenSource;
@@ -59,9 +77,15 @@ namespace WST.Drone.Modules
         {
             Disconnect();
 
-            string fullUrl = $"http://{url}:{videoPort}";
             _cancellationTokenSource = new CancellationTokenSource();
-            Task.Run(() => ReceiveMjpegStream(fullUrl, _cancellationTokenSource.Token));
+            CancellationToken token = _cancellationTokenSource.Token;
+            if (transport == VideoTransport.Udp)
+            {
+                Task.Run(() => ReceiveUdpStream(url, token));
+                return;
+            }
+            string fullUrl = $"http://{url}:{videoPort}";
+            Task.Run(() => ReceiveMjpegStream(fullUrl, token));
         }
 
         public void Disconnect()
@@ -129,6 +153,92 @@ namespace WST.Drone.Modules
             }
         }
 
+        private static uint NowUs()
+        {
+            return (uint)(long)(System.Diagnostics.Stopwatch.GetTimestamp() * (1000000.0 / System.Diagnostics.Stopwatch.Frequency));
+        }
+
+        private void ReceiveUdpStream(string host, CancellationToken token)
+        {
+            try
+            {
+                using (var udpClient = new UdpClient())
+                {
+                    udpClient.Client.ReceiveBufferSize = 1 << 20;
+                    udpClient.Client.ReceiveTimeout = 100;
+                    udpClient.Connect(host, udpVideoPort);
+
+                    var reassembler = new VideoReassembler();
+                    // Vehicle clock offset from the subscribe round trip with the least queueing
+                    uint bestRttUs = uint.MaxValue;
+                    int offsetUs = 0;
+                    bool synced = false;
+                    uint lastSubscribeUs = NowUs() - VideoProtocol.SubscribeIntervalMs * 1000u;
+                    uint lastComplete = 0;
+                    uint lastIncomplete = 0;
+
+                    while (!token.IsCancellationRequested)
+                    {
+                        uint now = NowUs();
+                        if (now - lastSubscribeUs >= VideoProtocol.SubscribeIntervalMs * 1000u)
+                        {
+                            byte[] subscribe = VideoProtocol.EncodeSubscribe(now, reassembler.Complete, reassembler.Incomplete);
+                            udpClient.Send(subscribe, subscribe.Length);
+                            lastSubscribeUs = now;
+
+                            uint complete = reassembler.Complete - lastComplete;
+                            uint incomplete = reassembler.Incomplete - lastIncomplete;
+                            if (complete + incomplete > 0) FrameLoss = (float)incomplete / (complete + incomplete);
+                            lastComplete = reassembler.Complete;
+                            lastIncomplete = reassembler.Incomplete;
+                            // Lets a drifting clock or a changed route move the offset
+                            if (bestRttUs != uint.MaxValue) bestRttUs += bestRttUs / 8;
+                        }
+
+                        byte[] data;
+                        try
+                        {
+                            IPEndPoint source = null;
+                            data = udpClient.Receive(ref source);
+                        }
+                        catch (SocketException ex) when (ex.SocketErrorCode == SocketError.TimedOut || ex.SocketErrorCode == SocketError.ConnectionReset)
+                        {
+                            continue;
+                        }
+                        uint receivedUs = NowUs();
+
+                        byte type = VideoProtocol.TypeOf(data, data.Length);
+                        if (type == VideoProtocol.Sync && data.Length == 12)
+                        {
+                            uint viewerUs = VideoProtocol.ReadUInt32(data, 4);
+                            uint vehicleUs = VideoProtocol.ReadUInt32(data, 8);
+                            uint rttUs = receivedUs - viewerUs;
+                            if (rttUs <= bestRttUs)
+                            {
+                                bestRttUs = rttUs;
+                                offsetUs = (int)(vehicleUs - (viewerUs + rttUs / 2));
+                                synced = true;
+                            }
+                            continue;
+                        }
+
+                        byte[] frame = reassembler.Push(data, data.Length);
+                        if (frame == null) continue;
+                        if (synced) LatencyMs = (int)(receivedUs - (reassembler.CaptureUs - (uint)offsetUs)) / 1000.0f;
+                        lock (_frameLock)
+                        {
+                            _currentFrame = frame;
+                            _newFrameReady = true;
+                        }
+                    }
+                }
+            }
+            catch (Exception ex)
+            {
+                Debug.LogError($"[LiveVideoModule] UDP stream error: {ex.Message}");
+            }
+        }
+
         private void OnDestroy()
         {
             Disconnect();
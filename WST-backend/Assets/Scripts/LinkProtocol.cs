@@ -0,0 +1,121 @@
+using System;
+
+namespace WST.Communication
+{
+    // Mirror of WST-FC/include/LinkProtocol.h, keep both in sync.
+    //   | magic u8 | version u8 | type u8 | length u16 | sequence u16 | timestampUs u32 | payload | crc u16 |
+    // Little endian, CRC-16/CCITT-FALSE over header and payload.
+    public enum LinkMessageType : byte
+    {
+        Control = 1,
+        Telemetry = 2,
+        // Keyframe or delta of the telemetry stream, see TelemetryCodec.cs
+        TelemetryDelta = 4,
+    }
+
+    public struct LinkFrame
+    {
+        public LinkMessageType type;
+        public ushort sequence;
+        public uint timestampUs;
+        public byte[] payload;
+    }
+
+    public static class LinkProtocol
+    {
+        public const byte Magic = 0xA5;
+        public const byte Version = 1;
+        public const int HeaderSize = 11;
+        public const int Overhead = HeaderSize + 2;
+
+        public static ushort Crc16(byte[] data, int offset, int length)
+        {
+            ushort crc = 0xFFFF;
+            for (int i = offset; i < offset + length; i++)
+            {
+                crc ^= (ushort)(data[i] << 8);
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc & 0x8000) != 0 ? (ushort)((crc << 1) ^ 0x1021) : (ushort)(crc << 1);
+                }
+            }
+            return crc;
+        }
+
+        public static byte[] Encode(LinkMessageType type, ushort sequence, uint timestampUs, byte[] payload)
+        {
+            byte[] frame = new byte[Overhead + payload.Length];
+            frame[0] = Magic;
+            frame[1] = Version;
+            frame[2] = (byte)type;
+            WriteUInt16(frame, 3, (ushort)payload.Length);
+            WriteUInt16(frame, 5, sequence);
+            frame[7] = (byte)timestampUs;
+            frame[8] = (byte)(timestampUs >> 8);
+            frame[9] = (byte)(timestampUs >> 16);
+            frame[10] = (byte)(timestampUs >> 24);
+            Buffer.BlockCopy(payload, 0, frame, HeaderSize, payload.Length);
+            WriteUInt16(frame, frame.Length - 2, Crc16(frame, 0, frame.Length - 2));
+            return frame;
+        }
+
+        // False for anything that is not exactly one valid frame
+        public static bool TryDecode(byte[] data, out LinkFrame frame)
+        {
+            frame = new LinkFrame();
+            if (data.Length < Overhead || data[0] != Magic || data[1] != Version) return false;
+            int length = ReadUInt16(data, 3);
+            if (Overhead + length != data.Length) return false;
+            if (ReadUInt16(data, data.Length - 2) != Crc16(data, 0, data.Length - 2)) return false;
+
+            frame.type = (LinkMessageType)data[2];
+            frame.sequence = ReadUInt16(data, 5);
+            frame.timestampUs = BitConverter.ToUInt32(data, 7);
+            frame.payload = new byte[length];
+            Buffer.BlockCopy(data, HeaderSize, frame.payload, 0, length);
+            return true;
+        }
+
+        private static void WriteUInt16(byte[] data, int offset, ushort value)
+        {
+            data[offset] = (byte)value;
+            data[offset + 1] = (byte)(value >> 8);
+        }
+
+        private static ushort ReadUInt16(byte[] data, int offset)
+        {
+            return (ushort)(data[offset] | (data[offset + 1] << 8));
+        }
+    }
+
+    // Drops telemetry older than the newest frame, counts gaps and late frames
+    public class LinkSequencer
+    {
+        public uint Received { get; private set; }
+        public uint Lost { get; private set; }
+        public uint Reordered { get; private set; }
+
+        private ushort _newest;
+        private bool _started;
+
+        public bool Accept(ushort sequence)
+        {
+            short delta = (short)(sequence - _newest);
+            if (!_started || delta > 0 || delta <= -1024)
+            {
+                if (_started && delta > 0) Lost += (uint)(delta - 1);
+                _started = true;
+                _newest = sequence;
+                Received++;
+                return true;
+            }
+            Reordered++;
+            return false;
+        }
+
+        public void Reset()
+        {
+            _started = false;
+        }
+    }
+}
@@ -7,15 +7,27 @@ public struct SensorsData
     public short pitch;
     public short roll;
 
+    // Body rates, decidegrees/s
+    public short gyroX;
+    public short gyroY;
+    public short gyroZ;
+
     public short linearAccelX;
     public short linearAccelY;
     public short linearAccelZ;
 
+    // Battery, centivolts / centiamps
     public short voltage;
+    public short current;
+    public ushort consumedMah;
 
     [MarshalAs(UnmanagedType.ByValArray, SizeConst = 6)]
     public ushort[] distanceSensors;
 
     [MarshalAs(UnmanagedType.ByValArray, SizeConst = 5)]
     public short[] other;
+
+    // Bidirectional DShot, 0 when not reported
+    [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)]
+    public ushort[] motorRpm;
 }
@@ -0,0 +1,113 @@
+using System;
+
+namespace WST.Communication
+{
+    // Decoder for LinkMessageType.TelemetryDelta payloads, mirror of
+    // WST-FC/include/TelemetryCodec.h, keep both in sync.
+    //   keyframe: | kind=0 | counter | fields | value u16 x fields |
+    //   delta:    | kind=1 | counter | fields | keyframe counter | changed bitmap | zigzag varint x changed |
+    // Delta values are relative to the keyframe named in the frame.
+    public class TelemetryDecoder
+    {
+        private const byte Keyframe = 0;
+        private const byte Delta = 1;
+
+        public uint Keyframes { get; private set; }
+        public uint Deltas { get; private set; }
+        public uint Skipped { get; private set; }
+        public uint Errors { get; private set; }
+        public bool Synced { get; private set; }
+
+        private ushort[] _keyframe = new ushort[0];
+        private ushort[] _values = new ushort[0];
+        private byte _keyframeCounter;
+
+        // True when Values holds the sample of this frame. Drop late frames first.
+        public bool Decode(byte[] payload)
+        {
+            if (payload.Length < 3)
+            {
+                Errors++;
+                return false;
+            }
+            byte kind = payload[0];
+            int fields = payload[2];
+
+            if (kind == Keyframe)
+            {
+                if (payload.Length != 3 + 2 * fields)
+                {
+                    Errors++;
+                    return false;
+                }
+                _keyframe = new ushort[fields];
+                for (int i = 0; i < fields; i++)
+                {
+                    _keyframe[i] = (ushort)(payload[3 + 2 * i] | (payload[4 + 2 * i] << 8));
+                }
+                _values = (ushort[])_keyframe.Clone();
+                _keyframeCounter = payload[1];
+                Synced = true;
+                Keyframes++;
+                return true;
+            }
+            if (kind != Delta || payload.Length < 4)
+            {
+                Errors++;
+                return false;
+            }
+            if (!Synced || fields != _keyframe.Length || payload[3] != _keyframeCounter)
+            {
+                Skipped++;
+                return false;
+            }
+
+            ushort[] values = (ushort[])_values.Clone();
+            int offset = 4 + (fields + 7) / 8;
+            for (int i = 0; i < fields && offset <= payload.Length; i++)
+            {
+                if ((payload[4 + i / 8] & (1 << (i % 8))) == 0) continue;
+                if (!ReadVarint(payload, ref offset, out uint encoded))
+                {
+                    Errors++;
+                    return false;
+                }
+                int delta = (int)(encoded >> 1) ^ -(int)(encoded & 1);
+                values[i] = (ushort)(_keyframe[i] + delta);
+            }
+            if (offset != payload.Length)
+            {
+                Errors++;
+                return false;
+            }
+            _values = values;
+            Deltas++;
+            return true;
+        }
+
+        // Current sample as little endian bytes, the layout of the C struct
+        public byte[] GetBytes()
+        {
+            byte[] bytes = new byte[_values.Length * 2];
+            Buffer.BlockCopy(_values, 0, bytes, 0, bytes.Length);
+            return bytes;
+        }
+
+        public void Reset()
+        {
+            Synced = false;
+        }
+
+        private static bool ReadVarint(byte[] data, ref int offset, out uint value)
+        {
+            value = 0;
+            for (int i = 0; i < 5 && offset < data.Length; i++)
+            {
+                byte b = data[offset++];
+                value |= (uint)(b & 0x7F) << (7 * i);
+                if ((b & 0x80) == 0) return true;
+            }
+            return false;
+        }
+    }
+}
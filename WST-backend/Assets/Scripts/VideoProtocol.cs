@@ -0,0 +1,124 @@
+using System;
+
+namespace WST.Communication
+{
+    // Camera frames over UDP, mirror of WST-FC/include/VideoProtocol.h, keep both in sync.
+    //   fragment:  | magic | version | type=1 | 0 | frameId u32 | captureUs u32 | frameSize u32 | offset u32 | chunk |
+    //   subscribe: | magic | version | type=2 | 0 | viewerUs u32 | framesComplete u32 | framesIncomplete u32 |
+    //   sync:      | magic | version | type=3 | 0 | viewerUs u32 | vehicleUs u32 |
+    // Little endian. Nothing is retransmitted, a frame with a missing fragment is dropped.
+    public static class VideoProtocol
+    {
+        public const byte Magic = 0x56;
+        public const byte Version = 1;
+        public const int Port = 4211;
+        public const int DatagramSize = 1400;
+        public const int FragmentHeaderSize = 20;
+        public const int Chunk = DatagramSize - FragmentHeaderSize;
+        public const int MaxFrameSize = 128 * 1024;
+        public const int SubscribeIntervalMs = 1000;
+
+        public const byte Fragment = 1;
+        public const byte Subscribe = 2;
+        public const byte Sync = 3;
+
+        // Message type, 0 for anything that is not ours
+        public static byte TypeOf(byte[] data, int length)
+        {
+            if (length < 4 || data[0] != Magic || data[1] != Version) return 0;
+            return data[2];
+        }
+
+        public static byte[] EncodeSubscribe(uint viewerUs, uint framesComplete, uint framesIncomplete)
+        {
+            byte[] message = new byte[16];
+            message[0] = Magic;
+            message[1] = Version;
+            message[2] = Subscribe;
+            WriteUInt32(message, 4, viewerUs);
+            WriteUInt32(message, 8, framesComplete);
+            WriteUInt32(message, 12, framesIncomplete);
+            return message;
+        }
+
+        public static uint ReadUInt32(byte[] data, int offset)
+        {
+            return (uint)(data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | (data[offset + 3] << 24));
+        }
+
+        private static void WriteUInt32(byte[] data, int offset, uint value)
+        {
+            data[offset] = (byte)value;
+            data[offset + 1] = (byte)(value >> 8);
+            data[offset + 2] = (byte)(value >> 16);
+            data[offset + 3] = (byte)(value >> 24);
+        }
+    }
+
+    // Rebuilds one frame at a time. A fragment of a newer frame abandons the
+    // frame in progress, fragments are never waited for.
+    public class VideoReassembler
+    {
+        public uint Complete { get; private set; }
+        // Dropped with fragments missing
+        public uint Incomplete { get; private set; }
+        // Frame ids never seen, dropped by the vehicle or lost whole
+        public uint Skipped { get; private set; }
+        public uint FrameId { get; private set; }
+        public uint CaptureUs { get; private set; }
+
+        private readonly byte[] _buffer = new byte[VideoProtocol.MaxFrameSize];
+        private readonly bool[] _received = new bool[(VideoProtocol.MaxFrameSize + VideoProtocol.Chunk - 1) / VideoProtocol.Chunk];
+        private int _size;
+        private int _missing;
+        private bool _active;
+        private bool _started;
+
+        // The frame once its last fragment arrived, null otherwise
+        public byte[] Push(byte[] data, int length)
+        {
+            const int header = VideoProtocol.FragmentHeaderSize;
+            if (VideoProtocol.TypeOf(data, length) != VideoProtocol.Fragment || length <= header) return null;
+            uint frameId = VideoProtocol.ReadUInt32(data, 4);
+            uint captureUs = VideoProtocol.ReadUInt32(data, 8);
+            uint frameSize = VideoProtocol.ReadUInt32(data, 12);
+            uint offset = VideoProtocol.ReadUInt32(data, 16);
+            int chunk = length - header;
+            if (frameSize > VideoProtocol.MaxFrameSize || offset % VideoProtocol.Chunk != 0 || offset + chunk > frameSize ||
+                (chunk != VideoProtocol.Chunk && offset + chunk != frameSize))
+            {
+                return null;
+            }
+
+            int age = (int)(frameId - FrameId);
+            if (_started && (age < 0 || (age == 0 && !_active))) return null;
+            if (!_started || age > 0)
+            {
+                if (_active) Incomplete++;
+                if (_started && age > 1) Skipped += (uint)(age - 1);
+                _started = true;
+                _active = true;
+                FrameId = frameId;
+                CaptureUs = captureUs;
+                _size = (int)frameSize;
+                _missing = (_size + VideoProtocol.Chunk - 1) / VideoProtocol.Chunk;
+                Array.Clear(_received, 0, _received.Length);
+            }
+            else if (frameSize != _size)
+            {
+                return null;
+            }
+
+            int index = (int)offset / VideoProtocol.Chunk;
+            if (_received[index]) return null;
+            _received[index] = true;
+            Buffer.BlockCopy(data, header, _buffer, (int)offset, chunk);
+            if (--_missing > 0) return null;
+            _active = false;
+            Complete++;
+            byte[] frame = new byte[_size];
+            Buffer.BlockCopy(_buffer, 0, frame, 0, _size);
+            return frame;
+        }
+    }
+}